@@ -0,0 +1,206 @@
+/*
+* Benchmark runner
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+namespace vks
+{
+    void Benchmark::run(std::function<void()> renderFunc, const vk::PhysicalDeviceProperties& deviceProps, std::function<void()> measurementStarted)
+    {
+        this->deviceProps = deviceProps;
+        frameTimes.clear();
+        gpuFrameTimes.clear();
+        latencies.clear();
+        submitLatencies.clear();
+        presentLatencies.clear();
+        results.clear();
+        runtime = 0.0;
+
+        // Warm up phase to get more stable frame rates (e.g. caches, clocks and pipeline creation settle during this time)
+        std::cout << "Benchmark: Warming up for " << warmup << " seconds\n";
+        auto tWarmupStart = std::chrono::high_resolution_clock::now();
+        while (std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tWarmupStart).count() < (double)warmup) {
+            renderFunc();
+        }
+
+        if (outputFrames > 0) {
+            std::cout << "Benchmark: Rendering " << outputFrames << " frames\n";
+            frameTimes.reserve(outputFrames);
+        }
+        else {
+            std::cout << "Benchmark: Running for " << duration << " seconds\n";
+        }
+
+        if (measurementStarted) {
+            measurementStarted();
+        }
+
+        // Measurement phase
+        const double durationMs = duration * 1000.0;
+        measuring = true;
+        while (true) {
+            auto tStart = std::chrono::high_resolution_clock::now();
+            renderFunc();
+            auto tEnd = std::chrono::high_resolution_clock::now();
+            double frameTime = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+            frameTimes.push_back(frameTime);
+            runtime += frameTime;
+
+            if (outputFrames > 0) {
+                if (frameTimes.size() >= (size_t)outputFrames) {
+                    break;
+                }
+            }
+            else if (runtime >= durationMs) {
+                break;
+            }
+        }
+        measuring = false;
+    }
+
+    void Benchmark::addGpuFrameTime(double frameTime)
+    {
+        if (measuring) {
+            gpuFrameTimes.push_back(frameTime);
+        }
+    }
+
+    void Benchmark::addLatency(double latency)
+    {
+        if (measuring) {
+            latencies.push_back(latency);
+        }
+    }
+
+    void Benchmark::addSubmitLatency(double latency)
+    {
+        if (measuring) {
+            submitLatencies.push_back(latency);
+        }
+    }
+
+    void Benchmark::addPresentLatency(double latency)
+    {
+        if (measuring) {
+            presentLatencies.push_back(latency);
+        }
+    }
+
+    void Benchmark::saveResults()
+    {
+        if (frameTimes.empty()) {
+            std::cerr << "Benchmark: No frames have been rendered, no results are written\n";
+            return;
+        }
+
+        const size_t frames = frameTimes.size();
+        const double fps = (double)frames / (runtime / 1000.0);
+
+        std::ofstream result(filename, std::ios::out);
+        if (!result.is_open()) {
+            std::cerr << "Benchmark: Could not open \"" << filename << "\" for writing\n";
+            return;
+        }
+
+        result << std::fixed << std::setprecision(3);
+        result << "device," << deviceProps.deviceName.data() << "\n";
+        result << "driver version," << deviceProps.driverVersion << "\n";
+        result << "api version," << VK_API_VERSION_MAJOR(deviceProps.apiVersion) << "." << VK_API_VERSION_MINOR(deviceProps.apiVersion) << "." << VK_API_VERSION_PATCH(deviceProps.apiVersion) << "\n";
+        result << "duration (ms)," << runtime << "\n";
+        result << "frames," << frames << "\n";
+        result << "fps," << fps << "\n";
+        writeStatistics(result, "frame time", frameTimes);
+
+        const double avgFrameTime = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / (double)frames;
+        double avgGpuFrameTime = 0.0;
+        if (!gpuFrameTimes.empty()) {
+            writeStatistics(result, "gpu frame time", gpuFrameTimes);
+            avgGpuFrameTime = std::accumulate(gpuFrameTimes.begin(), gpuFrameTimes.end(), 0.0) / (double)gpuFrameTimes.size();
+            // If the GPU is busy for (almost) the whole frame, it's the limiting factor, otherwise the CPU can't feed it fast enough
+            result << "bound," << ((avgGpuFrameTime >= avgFrameTime * 0.9) ? "gpu" : "cpu") << "\n";
+        }
+        double avgLatency = 0.0;
+        if (!latencies.empty()) {
+            writeStatistics(result, "latency", latencies);
+            avgLatency = std::accumulate(latencies.begin(), latencies.end(), 0.0) / (double)latencies.size();
+        }
+        if (!submitLatencies.empty()) {
+            writeStatistics(result, "submit latency", submitLatencies);
+        }
+        double avgPresentLatency = 0.0;
+        if (!presentLatencies.empty()) {
+            writeStatistics(result, "present latency", presentLatencies);
+            avgPresentLatency = std::accumulate(presentLatencies.begin(), presentLatencies.end(), 0.0) / (double)presentLatencies.size();
+        }
+
+        for (auto& [name, value] : results) {
+            result << name << "," << value << "\n";
+        }
+
+        if (outputFrameTimes) {
+            result << "\n" << "frame,ms" << "\n";
+            for (size_t i = 0; i < frames; ++i) {
+                result << i << "," << frameTimes[i] << "\n";
+            }
+            if (!gpuFrameTimes.empty()) {
+                // GPU times are read back frames later, so they are listed separately from the CPU frame times
+                result << "\n" << "gpu frame,ms" << "\n";
+                for (size_t i = 0; i < gpuFrameTimes.size(); ++i) {
+                    result << i << "," << gpuFrameTimes[i] << "\n";
+                }
+            }
+        }
+
+        result.flush();
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Benchmark: " << frames << " frames in " << runtime << " ms (" << fps << " fps)\n";
+        std::cout << "Benchmark: Average frame time " << avgFrameTime << " ms";
+        if (!gpuFrameTimes.empty()) {
+            std::cout << ", average GPU frame time " << avgGpuFrameTime << " ms";
+        }
+        if (!latencies.empty()) {
+            std::cout << ", average latency " << avgLatency << " ms";
+        }
+        if (!presentLatencies.empty()) {
+            std::cout << ", average input to present latency " << avgPresentLatency << " ms";
+        }
+        std::cout << "\n";
+        std::cout << "Benchmark: Results written to \"" << filename << "\"\n";
+    }
+
+    double Benchmark::percentile(const std::vector<double>& sortedFrameTimes, double p)
+    {
+        assert(!sortedFrameTimes.empty());
+        size_t rank = (size_t)std::ceil(p / 100.0 * (double)sortedFrameTimes.size());
+        rank = std::clamp(rank, (size_t)1, sortedFrameTimes.size());
+        return sortedFrameTimes[rank - 1];
+    }
+
+    void Benchmark::writeStatistics(std::ostream& stream, const std::string& name, const std::vector<double>& samples)
+    {
+        std::vector<double> sorted(samples);
+        std::sort(sorted.begin(), sorted.end());
+        const double avg = std::accumulate(sorted.begin(), sorted.end(), 0.0) / (double)sorted.size();
+        stream << name << " min (ms)," << sorted.front() << "\n";
+        stream << name << " avg (ms)," << avg << "\n";
+        stream << name << " max (ms)," << sorted.back() << "\n";
+        stream << name << " p50 (ms)," << percentile(sorted, 50.0) << "\n";
+        stream << name << " p90 (ms)," << percentile(sorted, 90.0) << "\n";
+        stream << name << " p95 (ms)," << percentile(sorted, 95.0) << "\n";
+        stream << name << " p99 (ms)," << percentile(sorted, 99.0) << "\n";
+        stream << name << " p99.9 (ms)," << percentile(sorted, 99.9) << "\n";
+    }
+}
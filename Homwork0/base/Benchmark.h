@@ -0,0 +1,99 @@
+/*
+* Benchmark runner
+*
+* Renders frames for a fixed duration (or frame count) after a warmup phase and stores frame time statistics
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vks
+{
+    class Benchmark
+    {
+    public:
+        /** @brief Set to true if the example should run in benchmark mode */
+        bool active = false;
+        /** @brief Write all per-frame samples to the result file in addition to the summary */
+        bool outputFrameTimes = false;
+        /** @brief If > 0, the benchmark renders exactly this number of frames instead of running for a fixed duration */
+        int32_t outputFrames = -1;
+        /** @brief Warmup time in seconds, frames rendered during warmup are not part of the results */
+        uint32_t warmup = 1;
+        /** @brief Duration of the measurement in seconds */
+        uint32_t duration = 10;
+        /** @brief Name of the file the results are written to */
+        std::string filename = "benchmarkresults.csv";
+
+        /** @brief Frame times in milliseconds for all frames of the measurement */
+        std::vector<double> frameTimes;
+
+        /** @brief GPU frame times in milliseconds collected during the measurement (from timestamp queries) */
+        std::vector<double> gpuFrameTimes;
+
+        /** @brief Frame latencies in milliseconds (CPU frame start to observed GPU completion) collected during the measurement */
+        std::vector<double> latencies;
+
+        /** @brief Latencies in milliseconds from CPU frame start to queue submission collected during the measurement */
+        std::vector<double> submitLatencies;
+
+        /** @brief Latencies in milliseconds from CPU frame start (input) to the return of the present call collected during the measurement */
+        std::vector<double> presentLatencies;
+
+        /**
+        * Run the benchmark
+        *
+        * @param renderFunc Function that renders a single frame
+        * @param deviceProps Properties of the device the benchmark runs on (written to the result file)
+        * @param measurementStarted (Optional) Called once the warmup has finished, e.g. to reset statistics gathered during warmup
+        */
+        void run(std::function<void()> renderFunc, const vk::PhysicalDeviceProperties& deviceProps, std::function<void()> measurementStarted = nullptr);
+
+        /** @brief Write the results of the last run to the result file and print a summary to stdout */
+        void saveResults();
+
+        /** @brief Add a GPU frame time sample, samples are only stored while the measurement is running */
+        void addGpuFrameTime(double frameTime);
+
+        /** @brief Add a frame latency sample, samples are only stored while the measurement is running */
+        void addLatency(double latency);
+
+        /** @brief Add a frame start to submit latency sample, samples are only stored while the measurement is running */
+        void addSubmitLatency(double latency);
+
+        /** @brief Add a frame start to present latency sample, samples are only stored while the measurement is running */
+        void addPresentLatency(double latency);
+
+        /** @brief Add an additional named result that is written to the result file after the frame time statistics */
+        template<typename T>
+        void addResult(const std::string& name, const T& value)
+        {
+            std::ostringstream stream;
+            stream << std::fixed << std::setprecision(3) << value;
+            results.emplace_back(name, stream.str());
+        }
+
+    private:
+        vk::PhysicalDeviceProperties deviceProps{};
+        bool measuring = false;
+        std::vector<std::pair<std::string, std::string>> results;
+        /** @brief Total measured time in milliseconds */
+        double runtime = 0.0;
+
+        /** @brief Returns the frame time at the given percentile (0..100) using the nearest rank of the sorted samples */
+        static double percentile(const std::vector<double>& sortedFrameTimes, double p);
+
+        /** @brief Writes min/avg/max and percentiles of the given samples */
+        static void writeStatistics(std::ostream& stream, const std::string& name, const std::vector<double>& samples);
+    };
+}
@@ -0,0 +1,59 @@
+/*
+* Command pools per thread and frame slot
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "CommandPoolSet.h"
+
+namespace vks
+{
+    void CommandPoolSet::create(vk::Device device, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t frameCount)
+    {
+        this->device = device;
+        this->threadCount = threadCount;
+        this->frameCount = frameCount;
+
+        pools.resize(threadCount * frameCount);
+        for (auto& pool : pools) {
+            // Command buffers are only reset all at once with their pool, so individual reset isn't required
+            vk::CommandPoolCreateInfo cmdPoolInfo = {};
+            cmdPoolInfo.queueFamilyIndex = queueFamilyIndex;
+            cmdPoolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+            VK_CHECK_RESULT(device.createCommandPool(&cmdPoolInfo, nullptr, &pool.commandPool));
+        }
+    }
+
+    void CommandPoolSet::destroy()
+    {
+        for (auto& pool : pools) {
+            device.destroyCommandPool(pool.commandPool);
+        }
+        pools.clear();
+    }
+
+    void CommandPoolSet::reset(uint32_t frameIndex)
+    {
+        for (uint32_t i = 0; i < threadCount; ++i) {
+            Pool& pool = pools[i * frameCount + frameIndex];
+            // Resetting the pool is cheaper than resetting each of its command buffers
+            device.resetCommandPool(pool.commandPool);
+            pool.used = 0;
+        }
+    }
+
+    vk::CommandBuffer CommandPoolSet::getSecondaryCommandBuffer(uint32_t threadIndex, uint32_t frameIndex)
+    {
+        Pool& pool = pools[threadIndex * frameCount + frameIndex];
+        if (pool.used == pool.secondaryCommandBuffers.size()) {
+            vk::CommandBufferAllocateInfo cmdBufAllocateInfo = {};
+            cmdBufAllocateInfo.commandPool = pool.commandPool;
+            cmdBufAllocateInfo.level = vk::CommandBufferLevel::eSecondary;
+            cmdBufAllocateInfo.commandBufferCount = 1;
+            vk::CommandBuffer commandBuffer;
+            VK_CHECK_RESULT(device.allocateCommandBuffers(&cmdBufAllocateInfo, &commandBuffer));
+            pool.secondaryCommandBuffers.push_back(commandBuffer);
+        }
+        return pool.secondaryCommandBuffers[pool.used++];
+    }
+}
@@ -0,0 +1,62 @@
+/*
+* Command pools per thread and frame slot
+*
+* Command pools must only be used by one thread at a time. Giving every worker thread its own pool for every frame in
+* flight allows recording command buffers in parallel without locking, and all buffers of a frame slot can be recycled
+* at once by resetting its pools
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+    class CommandPoolSet
+    {
+    public:
+        /**
+        * Create the command pools
+        *
+        * @param device Logical device to create the pools on
+        * @param queueFamilyIndex Queue family the recorded command buffers are submitted to
+        * @param threadCount Number of threads recording command buffers
+        * @param frameCount Number of frame slots (frames that can be in flight at once)
+        */
+        void create(vk::Device device, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t frameCount);
+
+        /* Free all command pools (and with them all command buffers) */
+        void destroy();
+
+        /** @brief Resets the pools of all threads for the given frame slot, the fence of the frame slot must have signaled */
+        void reset(uint32_t frameIndex);
+
+        /**
+        * Get an unused secondary command buffer for the given thread and frame slot
+        *
+        * @note Must only be called from the thread with the given index, command buffers are allocated on first use and reused after the frame slot has been reset
+        */
+        vk::CommandBuffer getSecondaryCommandBuffer(uint32_t threadIndex, uint32_t frameIndex);
+
+        uint32_t getThreadCount() const { return threadCount; }
+
+    private:
+        // Pools are written to by different threads, keep them on separate cache lines
+        struct alignas(64) Pool
+        {
+            vk::CommandPool commandPool{ nullptr };
+            std::vector<vk::CommandBuffer> secondaryCommandBuffers;
+            uint32_t used = 0;
+        };
+
+        vk::Device device{ nullptr };
+        uint32_t threadCount = 0;
+        uint32_t frameCount = 0;
+        // Indexed by threadIndex * frameCount + frameIndex
+        std::vector<Pool> pools;
+    };
+}
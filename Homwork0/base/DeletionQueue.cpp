@@ -0,0 +1,113 @@
+/*
+* Deferred destruction of Vulkan resources
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "DeletionQueue.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace vks
+{
+    void DeletionQueue::create(vk::Device device, MemoryAllocator* memoryAllocator)
+    {
+        this->device = device;
+        this->memoryAllocator = memoryAllocator;
+    }
+
+    void DeletionQueue::setSubmittedValue(uint64_t value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        submittedValue = value;
+    }
+
+    uint64_t DeletionQueue::getSubmittedValue() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return submittedValue;
+    }
+
+    void DeletionQueue::push(std::function<void()> destroy, uint64_t lastUse)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (lastUse == nextSubmission) {
+            lastUse = submittedValue + 1;
+        }
+        entries.push_back({ lastUse, std::move(destroy) });
+    }
+
+    void DeletionQueue::push(vk::Buffer buffer, uint64_t lastUse)
+    {
+        push([device = device, buffer]() { device.destroyBuffer(buffer); }, lastUse);
+    }
+
+    void DeletionQueue::push(vk::Image image, uint64_t lastUse)
+    {
+        push([device = device, image]() { device.destroyImage(image); }, lastUse);
+    }
+
+    void DeletionQueue::push(vk::ImageView imageView, uint64_t lastUse)
+    {
+        push([device = device, imageView]() { device.destroyImageView(imageView); }, lastUse);
+    }
+
+    void DeletionQueue::push(vk::Framebuffer framebuffer, uint64_t lastUse)
+    {
+        push([device = device, framebuffer]() { device.destroyFramebuffer(framebuffer); }, lastUse);
+    }
+
+    void DeletionQueue::push(vk::Pipeline pipeline, uint64_t lastUse)
+    {
+        push([device = device, pipeline]() { device.destroyPipeline(pipeline); }, lastUse);
+    }
+
+    void DeletionQueue::push(const Allocation& allocation, uint64_t lastUse)
+    {
+        push([memoryAllocator = memoryAllocator, allocation]() mutable { memoryAllocator->free(allocation); }, lastUse);
+    }
+
+    void DeletionQueue::push(vk::CommandPool commandPool, const std::vector<vk::CommandBuffer>& commandBuffers, uint64_t lastUse)
+    {
+        push([device = device, commandPool, commandBuffers]() { device.freeCommandBuffers(commandPool, commandBuffers); }, lastUse);
+    }
+
+    void DeletionQueue::collect(uint64_t completedValue)
+    {
+        std::vector<Entry> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // Entries are mostly queued in increasing order, but explicit tags may be older than the ones queued before them
+            auto firstPending = std::stable_partition(entries.begin(), entries.end(), [completedValue](const Entry& entry) { return entry.lastUse <= completedValue; });
+            std::move(entries.begin(), firstPending, std::back_inserter(ready));
+            entries.erase(entries.begin(), firstPending);
+        }
+        // Destroyed outside of the lock, so destroy functions may queue further entries
+        destroyEntries(ready);
+    }
+
+    void DeletionQueue::flush()
+    {
+        std::vector<Entry> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::move(entries.begin(), entries.end(), std::back_inserter(ready));
+            entries.clear();
+        }
+        destroyEntries(ready);
+    }
+
+    size_t DeletionQueue::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    void DeletionQueue::destroyEntries(std::vector<Entry>& ready)
+    {
+        for (auto& entry : ready) {
+            entry.destroy();
+        }
+    }
+}
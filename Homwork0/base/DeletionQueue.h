@@ -0,0 +1,78 @@
+/*
+* Deferred destruction of Vulkan resources
+*
+* Resources that submitted work may still use are queued together with the value of the last submission that may use
+* them (e.g. a frame number). They are destroyed once the owner reports that value as completed, so resources can be
+* replaced at runtime (resize, hot reload, streaming) without waiting for the device to become idle
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "VulkanTools.h"
+#include "VulkanMemoryAllocator.h"
+
+namespace vks
+{
+    class DeletionQueue
+    {
+    public:
+        /** @brief Tags an entry with the submission after the most recent one, i.e. the first one that can no longer use the resource */
+        static constexpr uint64_t nextSubmission = UINT64_MAX;
+
+        /* Set the device (and memory allocator) the resources belong to */
+        void create(vk::Device device, MemoryAllocator* memoryAllocator);
+
+        /** @brief Value of the most recent submission, entries tagged with nextSubmission wait for the one after it */
+        void setSubmittedValue(uint64_t value);
+        uint64_t getSubmittedValue() const;
+
+        /**
+        * Queue a function destroying resources
+        *
+        * @param destroy Called once lastUse has completed (from collect or flush)
+        * @param lastUse (Optional) Value of the last submission that may use the resources
+        */
+        void push(std::function<void()> destroy, uint64_t lastUse = nextSubmission);
+
+        void push(vk::Buffer buffer, uint64_t lastUse = nextSubmission);
+        void push(vk::Image image, uint64_t lastUse = nextSubmission);
+        void push(vk::ImageView imageView, uint64_t lastUse = nextSubmission);
+        void push(vk::Framebuffer framebuffer, uint64_t lastUse = nextSubmission);
+        void push(vk::Pipeline pipeline, uint64_t lastUse = nextSubmission);
+        void push(const Allocation& allocation, uint64_t lastUse = nextSubmission);
+        void push(vk::CommandPool commandPool, const std::vector<vk::CommandBuffer>& commandBuffers, uint64_t lastUse = nextSubmission);
+
+        /** @brief Destroys all entries whose last use is less than or equal to the given completed value */
+        void collect(uint64_t completedValue);
+
+        /** @brief Destroys all entries, the device must be idle */
+        void flush();
+
+        /** @brief Number of entries waiting to be destroyed */
+        size_t size() const;
+
+    private:
+        struct Entry
+        {
+            uint64_t lastUse;
+            std::function<void()> destroy;
+        };
+
+        vk::Device device{ nullptr };
+        MemoryAllocator* memoryAllocator{ nullptr };
+        // Resources may be retired from worker threads (e.g. asset streaming)
+        mutable std::mutex mutex;
+        std::deque<Entry> entries;
+        uint64_t submittedValue = 0;
+
+        void destroyEntries(std::vector<Entry>& ready);
+    };
+}
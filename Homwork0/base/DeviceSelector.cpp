@@ -0,0 +1,184 @@
+/*
+* Physical device (GPU) selection
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "DeviceSelector.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+
+namespace vks
+{
+    namespace
+    {
+        std::string toLower(std::string text)
+        {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            return text;
+        }
+
+        std::string versionString(uint32_t version)
+        {
+            return std::to_string(VK_API_VERSION_MAJOR(version)) + "." + std::to_string(VK_API_VERSION_MINOR(version)) + "." + std::to_string(VK_API_VERSION_PATCH(version));
+        }
+    }
+
+    void DeviceSelector::create(const std::vector<vk::PhysicalDevice>& physicalDevices, uint32_t requiredApiVersion, bool requireSwapchain)
+    {
+        scores.clear();
+        for (uint32_t i = 0; i < static_cast<uint32_t>(physicalDevices.size()); ++i) {
+            scores.push_back(scoreDevice(physicalDevices[i], i, requiredApiVersion, requireSwapchain));
+        }
+    }
+
+    DeviceSelector::Score DeviceSelector::scoreDevice(vk::PhysicalDevice physicalDevice, uint32_t index, uint32_t requiredApiVersion, bool requireSwapchain)
+    {
+        const vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+        const vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+        const std::vector<vk::QueueFamilyProperties> queueFamilies = physicalDevice.getQueueFamilyProperties();
+
+        Score score{};
+        score.physicalDevice = physicalDevice;
+        score.index = index;
+        score.name = properties.deviceName.data();
+        score.type = properties.deviceType;
+        score.apiVersion = properties.apiVersion;
+
+        // Software rasterizers (CPU devices) are only used if there is nothing else
+        switch (properties.deviceType) {
+        case vk::PhysicalDeviceType::eDiscreteGpu:
+            score.typeScore = 1000;
+            break;
+        case vk::PhysicalDeviceType::eIntegratedGpu:
+            score.typeScore = 500;
+            break;
+        case vk::PhysicalDeviceType::eVirtualGpu:
+            score.typeScore = 200;
+            break;
+        case vk::PhysicalDeviceType::eCpu:
+            score.typeScore = 0;
+            break;
+        default:
+            score.typeScore = 100;
+            break;
+        }
+
+        // One point per 128 MiB of the largest device local heap (capped), integrated GPUs report shared system memory here
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+            if (memoryProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+                score.deviceLocalMemory = std::max(score.deviceLocalMemory, memoryProperties.memoryHeaps[i].size);
+            }
+        }
+        score.memoryScore = (int32_t)std::min<vk::DeviceSize>(score.deviceLocalMemory / (128ull * 1024 * 1024), 200);
+
+        // Dedicated queue families let compute and uploads run asynchronously to rendering
+        bool hasGraphics = false;
+        for (auto& queueFamily : queueFamilies) {
+            const vk::QueueFlags flags = queueFamily.queueFlags;
+            hasGraphics |= (bool)(flags & vk::QueueFlagBits::eGraphics);
+            if ((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+                score.dedicatedCompute = true;
+            }
+            if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+                score.dedicatedTransfer = true;
+            }
+        }
+        score.queueScore = (score.dedicatedCompute ? 100 : 0) + (score.dedicatedTransfer ? 100 : 0);
+
+        // Newer API versions are preferred slightly, older ones than required can't be used
+        const int32_t minorVersions = (int32_t)VK_API_VERSION_MINOR(properties.apiVersion) - (int32_t)VK_API_VERSION_MINOR(requiredApiVersion);
+        score.apiScore = std::max(minorVersions, 0) * 25;
+
+        if (VK_API_VERSION_MAJOR(properties.apiVersion) != VK_API_VERSION_MAJOR(requiredApiVersion) || minorVersions < 0) {
+            score.suitable = false;
+            score.unsuitableReason = "requires Vulkan " + versionString(requiredApiVersion);
+        }
+        else if (!hasGraphics) {
+            score.suitable = false;
+            score.unsuitableReason = "no graphics queue";
+        }
+        else if (requireSwapchain) {
+            const std::vector<vk::ExtensionProperties> extensions = physicalDevice.enumerateDeviceExtensionProperties();
+            const bool hasSwapchain = std::any_of(extensions.begin(), extensions.end(), [](const vk::ExtensionProperties& extension) {
+                return strcmp(extension.extensionName.data(), VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0;
+            });
+            if (!hasSwapchain) {
+                score.suitable = false;
+                score.unsuitableReason = "no swapchain support";
+            }
+        }
+        return score;
+    }
+
+    const DeviceSelector::Score* DeviceSelector::select(const std::string& selection, bool& explicitSelection) const
+    {
+        explicitSelection = false;
+        if (!selection.empty()) {
+            const Score* selected = nullptr;
+            if (std::all_of(selection.begin(), selection.end(), [](unsigned char c) { return std::isdigit(c); })) {
+                // Out of range values (ERANGE) fall through to the "no device matches" message, like any other index without a device
+                errno = 0;
+                const unsigned long long index = std::strtoull(selection.c_str(), nullptr, 10);
+                if ((errno == 0) && (index < scores.size())) {
+                    selected = &scores[(size_t)index];
+                }
+            }
+            else {
+                const std::string name = toLower(selection);
+                for (auto& score : scores) {
+                    if (toLower(score.name).find(name) != std::string::npos) {
+                        selected = &score;
+                        break;
+                    }
+                }
+            }
+            if (selected) {
+                // An explicitly selected device is used even if it isn't suitable, the example may still check the requirements it knows about
+                if (!selected->suitable) {
+                    std::cerr << "Selected device \"" << selected->name << "\" may not work (" << selected->unsuitableReason << ")\n";
+                }
+                explicitSelection = true;
+                return selected;
+            }
+            std::cerr << "No device matches \"" << selection << "\", selecting the device with the highest score instead (use --listgpus to show available Vulkan devices)\n";
+        }
+        return selectBest();
+    }
+
+    const DeviceSelector::Score* DeviceSelector::selectBest() const
+    {
+        const Score* best = nullptr;
+        for (auto& score : scores) {
+            // Ties are resolved in favor of the device enumerated first
+            if (score.suitable && (!best || score.total() > best->total())) {
+                best = &score;
+            }
+        }
+        // Without a suitable device, the first device is used and the example reports what's missing
+        if (!best && !scores.empty()) {
+            best = &scores[0];
+        }
+        return best;
+    }
+
+    void DeviceSelector::print(std::ostream& stream) const
+    {
+        stream << "Available Vulkan devices\n";
+        for (auto& score : scores) {
+            stream << "Device [" << score.index << "] : " << score.name << "\n";
+            stream << " Type: " << vk::to_string(score.type) << "\n";
+            stream << " API: " << versionString(score.apiVersion) << "\n";
+            stream << " Device local memory: " << (score.deviceLocalMemory / (1024 * 1024)) << " MiB\n";
+            stream << " Dedicated compute queue: " << (score.dedicatedCompute ? "yes" : "no") << ", dedicated transfer queue: " << (score.dedicatedTransfer ? "yes" : "no") << "\n";
+            stream << " Score: " << score.total() << " (type " << score.typeScore << ", memory " << score.memoryScore << ", queues " << score.queueScore << ", api " << score.apiScore << ")";
+            if (!score.suitable) {
+                stream << ", not suitable: " << score.unsuitableReason;
+            }
+            stream << "\n";
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+* Physical device (GPU) selection
+*
+* Every physical device is scored by its type, the size of its largest device local heap, whether it has dedicated
+* compute and transfer queue families and how far its API version exceeds the required one. Devices that don't
+* support the required API version, graphics or (unless headless) the swapchain extension are not suitable. The device
+* with the highest score is selected unless a device is requested explicitly by index or by a part of its name
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+    class DeviceSelector
+    {
+    public:
+        /** @brief Score of a physical device, broken down into its components */
+        struct Score
+        {
+            vk::PhysicalDevice physicalDevice{ nullptr };
+            uint32_t index = 0;
+            std::string name;
+            vk::PhysicalDeviceType type = vk::PhysicalDeviceType::eOther;
+            uint32_t apiVersion = 0;
+            vk::DeviceSize deviceLocalMemory = 0;
+            bool dedicatedCompute = false;
+            bool dedicatedTransfer = false;
+            /** @brief Devices that are not suitable are only used if selected explicitly */
+            bool suitable = true;
+            std::string unsuitableReason;
+
+            int32_t typeScore = 0;
+            int32_t memoryScore = 0;
+            int32_t queueScore = 0;
+            int32_t apiScore = 0;
+
+            int32_t total() const { return typeScore + memoryScore + queueScore + apiScore; }
+        };
+
+        /**
+        * Score all physical devices
+        *
+        * @param physicalDevices Devices as enumerated by the instance
+        * @param requiredApiVersion Minimum Vulkan version the device has to support
+        * @param requireSwapchain Devices not supporting the swapchain extension are not suitable (not required for headless rendering)
+        */
+        void create(const std::vector<vk::PhysicalDevice>& physicalDevices, uint32_t requiredApiVersion, bool requireSwapchain);
+
+        /**
+        * Select a device
+        *
+        * @param selection Empty to select the suitable device with the highest score, otherwise a device index or a (case insensitive) part of the device name
+        * @param explicitSelection Set to true if the device has been selected by the given selection, false if it was selected by score
+        *
+        * @return Score of the selected device, nullptr if no device can be used
+        */
+        const Score* select(const std::string& selection, bool& explicitSelection) const;
+
+        const std::vector<Score>& getScores() const { return scores; }
+
+        /** @brief Writes all devices with their properties and scores */
+        void print(std::ostream& stream) const;
+
+    private:
+        std::vector<Score> scores;
+
+        static Score scoreDevice(vk::PhysicalDevice physicalDevice, uint32_t index, uint32_t requiredApiVersion, bool requireSwapchain);
+        const Score* selectBest() const;
+    };
+}
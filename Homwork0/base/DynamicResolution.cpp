@@ -0,0 +1,69 @@
+/*
+* Frame time driven render resolution controller
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vks
+{
+    void DynamicResolution::create(float targetFrameTime, uint32_t frameLatency, uint32_t adjustInterval)
+    {
+        this->targetFrameTime = targetFrameTime;
+        this->frameLatency = frameLatency;
+        this->adjustInterval = std::max(adjustInterval, 1u);
+        scale = maxScale;
+        samplesToSkip = 0;
+        frameTimeSum = 0.0f;
+        sampleCount = 0;
+        resetStatistics();
+    }
+
+    bool DynamicResolution::update(float gpuFrameTime)
+    {
+        if (samplesToSkip > 0) {
+            samplesToSkip--;
+            return false;
+        }
+        frameTimeSum += gpuFrameTime;
+        if (++sampleCount < adjustInterval) {
+            return false;
+        }
+        const float averageFrameTime = frameTimeSum / (float)sampleCount;
+        frameTimeSum = 0.0f;
+        sampleCount = 0;
+
+        // Fragment cost grows with the number of pixels, i.e. with the square of the scale
+        // Scaling up is only done with some headroom left, otherwise the scale would oscillate around the budget
+        float newScale = scale;
+        if (averageFrameTime > targetFrameTime) {
+            newScale = scale * std::sqrt(targetFrameTime / averageFrameTime);
+            newScale = std::floor(newScale / scaleStep) * scaleStep;
+        }
+        else if (averageFrameTime < targetFrameTime * 0.8f) {
+            newScale = scale * std::sqrt(targetFrameTime * 0.9f / std::max(averageFrameTime, 0.001f));
+            // Raising the scale is done gradually, as the last samples may not have been representative
+            newScale = std::min(std::floor(newScale / scaleStep) * scaleStep, scale + scaleStep * 2.0f);
+        }
+        newScale = std::clamp(newScale, minScale, maxScale);
+        if (std::fabs(newScale - scale) < scaleStep * 0.5f) {
+            return false;
+        }
+
+        scale = newScale;
+        samplesToSkip = frameLatency;
+        lowestScale = std::min(lowestScale, scale);
+        changeCount++;
+        return true;
+    }
+
+    void DynamicResolution::resetStatistics()
+    {
+        lowestScale = scale;
+        changeCount = 0;
+    }
+}
@@ -0,0 +1,65 @@
+/*
+* Frame time driven render resolution controller
+*
+* The scene is rendered at a fraction of the output resolution and scaled up when presenting. Every few frames the
+* average GPU frame time is compared against a target frame budget and the scale is lowered (or raised again) to hold it.
+* GPU frame times are read back frames after submission, so samples of frames recorded before a scale change are skipped
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace vks
+{
+    class DynamicResolution
+    {
+    public:
+        /** @brief Scale is never lowered below this (per axis), as the upscaled image would become unusable */
+        static constexpr float minScale = 0.25f;
+        static constexpr float maxScale = 1.0f;
+        /** @brief Scale changes are rounded to this step, so small frame time fluctuations don't cause constant changes (and re-recording) */
+        static constexpr float scaleStep = 0.05f;
+
+        /**
+        * Set up the controller
+        *
+        * @param targetFrameTime GPU frame time in milliseconds to hold
+        * @param frameLatency Number of frames between recording a frame and reading back its GPU frame time (i.e. the number of frames in flight)
+        * @param adjustInterval (Optional) Number of GPU frame time samples averaged before the scale is adjusted
+        */
+        void create(float targetFrameTime, uint32_t frameLatency, uint32_t adjustInterval = 8);
+
+        /**
+        * Add a GPU frame time sample
+        *
+        * @return True if the scale has changed, the render resolution needs to be updated before recording the next frame
+        */
+        bool update(float gpuFrameTime);
+
+        /** @brief Current scale applied to both width and height of the output resolution */
+        float getScale() const { return scale; }
+        float getTargetFrameTime() const { return targetFrameTime; }
+
+        /** @brief Lowest scale used and number of scale changes since the last reset */
+        float getLowestScale() const { return lowestScale; }
+        uint32_t getChangeCount() const { return changeCount; }
+        void resetStatistics();
+
+    private:
+        float targetFrameTime = 16.6f;
+        uint32_t frameLatency = 0;
+        uint32_t adjustInterval = 8;
+
+        float scale = maxScale;
+        // Samples of frames recorded before the last change that are still to be read back
+        uint32_t samplesToSkip = 0;
+        float frameTimeSum = 0.0f;
+        uint32_t sampleCount = 0;
+
+        float lowestScale = maxScale;
+        uint32_t changeCount = 0;
+    };
+}
@@ -0,0 +1,460 @@
+/*
+* View frustum culling of bounding volumes on the CPU
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULLING_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows using intrinsics of any instruction set, GCC and Clang need the functions using them to be compiled for it
+#if defined(FRUSTUM_CULLING_X86) && (defined(__GNUC__) || defined(__clang__))
+#define FRUSTUM_CULLING_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FRUSTUM_CULLING_TARGET(isa)
+#endif
+
+// The kernels only return identical results if a * b + c isn't contracted into a fused multiply-add in some of them
+// GCC doesn't support the standard pragma in C++, the file is compiled with -ffp-contract=off instead (see CMakeLists.txt)
+#if defined(_MSC_VER) && !defined(__clang__)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+namespace vks
+{
+    namespace
+    {
+        // Expands the bits of a SIMD compare mask to one byte per object, so a batch's visibility is stored with a single write
+        struct MaskTable
+        {
+            std::array<uint64_t, 256> bytes{};
+
+            MaskTable()
+            {
+                for (uint32_t mask = 0; mask < 256; ++mask) {
+                    for (uint32_t bit = 0; bit < 8; ++bit) {
+                        if (mask & (1u << bit)) {
+                            bytes[mask] |= 1ull << (bit * 8);
+                        }
+                    }
+                }
+            }
+        };
+        const MaskTable maskTable;
+
+        // Stores the visibility of up to 8 objects and returns the number of visible ones
+        inline uint32_t storeMask(uint32_t mask, uint32_t objectCount, uint8_t* visibility)
+        {
+            const uint64_t bytes = maskTable.bytes[mask];
+            std::memcpy(visibility, &bytes, objectCount);
+            // Every byte is 0 or 1, so the multiplication sums them up in the top byte
+            return static_cast<uint32_t>((bytes * 0x0101010101010101ull) >> 56);
+        }
+
+        // Plane normals and their absolute values (for the box extents), split into components
+        struct Planes
+        {
+            float x[6], y[6], z[6], w[6];
+            float absX[6], absY[6], absZ[6];
+
+            explicit Planes(const Frustum& frustum)
+            {
+                for (uint32_t i = 0; i < 6; ++i) {
+                    x[i] = frustum.planes[i].x;
+                    y[i] = frustum.planes[i].y;
+                    z[i] = frustum.planes[i].z;
+                    w[i] = frustum.planes[i].w;
+                    absX[i] = std::fabs(x[i]);
+                    absY[i] = std::fabs(y[i]);
+                    absZ[i] = std::fabs(z[i]);
+                }
+            }
+        };
+
+        // All kernels evaluate the same expressions in the same order and contraction into fused multiply-adds is disabled (see above), so they return identical results
+        // A sphere is culled if its center is further than its radius behind any plane
+        // A box is culled if its center is further than its extents projected onto the plane normal behind any plane
+        uint32_t cullSpheresScalar(const Planes& planes, const BoundingSpheres& volumes, uint32_t begin, uint32_t end, uint8_t* visibility)
+        {
+            uint32_t visibleCount = 0;
+            for (uint32_t i = begin; i < end; ++i) {
+                bool visible = true;
+                for (uint32_t p = 0; p < 6; ++p) {
+                    const float distance = ((planes.x[p] * volumes.centerX[i] + planes.y[p] * volumes.centerY[i]) + planes.z[p] * volumes.centerZ[i]) + planes.w[p];
+                    visible &= !(distance < -volumes.radius[i]);
+                }
+                visibility[i] = visible ? 1 : 0;
+                visibleCount += visible ? 1 : 0;
+            }
+            return visibleCount;
+        }
+
+        uint32_t cullBoxesScalar(const Planes& planes, const BoundingBoxes& volumes, uint32_t begin, uint32_t end, uint8_t* visibility)
+        {
+            uint32_t visibleCount = 0;
+            for (uint32_t i = begin; i < end; ++i) {
+                bool visible = true;
+                for (uint32_t p = 0; p < 6; ++p) {
+                    const float distance = ((planes.x[p] * volumes.centerX[i] + planes.y[p] * volumes.centerY[i]) + planes.z[p] * volumes.centerZ[i]) + planes.w[p];
+                    const float radius = (planes.absX[p] * volumes.extentX[i] + planes.absY[p] * volumes.extentY[i]) + planes.absZ[p] * volumes.extentZ[i];
+                    visible &= !(distance < -radius);
+                }
+                visibility[i] = visible ? 1 : 0;
+                visibleCount += visible ? 1 : 0;
+            }
+            return visibleCount;
+        }
+
+#if defined(FRUSTUM_CULLING_X86)
+        FRUSTUM_CULLING_TARGET("sse2")
+        uint32_t cullSpheresSSE(const Planes& planes, const BoundingSpheres& volumes, uint32_t begin, uint32_t end, uint8_t* visibility)
+        {
+            uint32_t visibleCount = 0;
+            uint32_t i = begin;
+            for (; i + 4 <= end; i += 4) {
+                const __m128 cx = _mm_loadu_ps(&volumes.centerX[i]);
+                const __m128 cy = _mm_loadu_ps(&volumes.centerY[i]);
+                const __m128 cz = _mm_loadu_ps(&volumes.centerZ[i]);
+                const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&volumes.radius[i]));
+                __m128 outside = _mm_setzero_ps();
+                for (uint32_t p = 0; p < 6; ++p) {
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), cx), _mm_mul_ps(_mm_set1_ps(planes.y[p]), cy));
+                    distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.z[p]), cz)), _mm_set1_ps(planes.w[p]));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negRadius));
+                }
+                visibleCount += storeMask(~_mm_movemask_ps(outside) & 0xF, 4, &visibility[i]);
+            }
+            return visibleCount + cullSpheresScalar(planes, volumes, i, end, visibility);
+        }
+
+        FRUSTUM_CULLING_TARGET("sse2")
+        uint32_t cullBoxesSSE(const Planes& planes, const BoundingBoxes& volumes, uint32_t begin, uint32_t end, uint8_t* visibility)
+        {
+            uint32_t visibleCount = 0;
+            uint32_t i = begin;
+            for (; i + 4 <= end; i += 4) {
+                const __m128 cx = _mm_loadu_ps(&volumes.centerX[i]);
+                const __m128 cy = _mm_loadu_ps(&volumes.centerY[i]);
+                const __m128 cz = _mm_loadu_ps(&volumes.centerZ[i]);
+                const __m128 ex = _mm_loadu_ps(&volumes.extentX[i]);
+                const __m128 ey = _mm_loadu_ps(&volumes.extentY[i]);
+                const __m128 ez = _mm_loadu_ps(&volumes.extentZ[i]);
+                __m128 outside = _mm_setzero_ps();
+                for (uint32_t p = 0; p < 6; ++p) {
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), cx), _mm_mul_ps(_mm_set1_ps(planes.y[p]), cy));
+                    distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.z[p]), cz)), _mm_set1_ps(planes.w[p]));
+                    __m128 radius = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.absX[p]), ex), _mm_mul_ps(_mm_set1_ps(planes.absY[p]), ey));
+                    radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(planes.absZ[p]), ez));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+                }
+                visibleCount += storeMask(~_mm_movemask_ps(outside) & 0xF, 4, &visibility[i]);
+            }
+            return visibleCount + cullBoxesScalar(planes, volumes, i, end, visibility);
+        }
+
+        FRUSTUM_CULLING_TARGET("avx2")
+        uint32_t cullSpheresAVX2(const Planes& planes, const BoundingSpheres& volumes, uint32_t begin, uint32_t end, uint8_t* visibility)
+        {
+            uint32_t visibleCount = 0;
+            uint32_t i = begin;
+            for (; i + 8 <= end; i += 8) {
+                const __m256 cx = _mm256_loadu_ps(&volumes.centerX[i]);
+                const __m256 cy = _mm256_loadu_ps(&volumes.centerY[i]);
+                const __m256 cz = _mm256_loadu_ps(&volumes.centerZ[i]);
+                const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&volumes.radius[i]));
+                __m256 outside = _mm256_setzero_ps();
+                for (uint32_t p = 0; p < 6; ++p) {
+                    __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.x[p]), cx), _mm256_mul_ps(_mm256_set1_ps(planes.y[p]), cy));
+                    distance = _mm256_add_ps(_mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes.z[p]), cz)), _mm256_set1_ps(planes.w[p]));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negRadius, _CMP_LT_OQ));
+                }
+                visibleCount += storeMask(~_mm256_movemask_ps(outside) & 0xFF, 8, &visibility[i]);
+            }
+            return visibleCount + cullSpheresScalar(planes, volumes, i, end, visibility);
+        }
+
+        FRUSTUM_CULLING_TARGET("avx2")
+        uint32_t cullBoxesAVX2(const Planes& planes, const BoundingBoxes& volumes, uint32_t begin, uint32_t end, uint8_t* visibility)
+        {
+            uint32_t visibleCount = 0;
+            uint32_t i = begin;
+            for (; i + 8 <= end; i += 8) {
+                const __m256 cx = _mm256_loadu_ps(&volumes.centerX[i]);
+                const __m256 cy = _mm256_loadu_ps(&volumes.centerY[i]);
+                const __m256 cz = _mm256_loadu_ps(&volumes.centerZ[i]);
+                const __m256 ex = _mm256_loadu_ps(&volumes.extentX[i]);
+                const __m256 ey = _mm256_loadu_ps(&volumes.extentY[i]);
+                const __m256 ez = _mm256_loadu_ps(&volumes.extentZ[i]);
+                __m256 outside = _mm256_setzero_ps();
+                for (uint32_t p = 0; p < 6; ++p) {
+                    __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.x[p]), cx), _mm256_mul_ps(_mm256_set1_ps(planes.y[p]), cy));
+                    distance = _mm256_add_ps(_mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes.z[p]), cz)), _mm256_set1_ps(planes.w[p]));
+                    __m256 radius = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.absX[p]), ex), _mm256_mul_ps(_mm256_set1_ps(planes.absY[p]), ey));
+                    radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(planes.absZ[p]), ez));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_sub_ps(_mm256_setzero_ps(), radius), _CMP_LT_OQ));
+                }
+                visibleCount += storeMask(~_mm256_movemask_ps(outside) & 0xFF, 8, &visibility[i]);
+            }
+            return visibleCount + cullBoxesScalar(planes, volumes, i, end, visibility);
+        }
+#endif
+
+        template <typename Volumes>
+        uint32_t cullParallel(TaskScheduler& scheduler, const Frustum& frustum, const Volumes& volumes, uint8_t* visibility, FrustumCulling::Kernel kernel, uint32_t grainSize)
+        {
+            std::atomic<uint32_t> visibleCount{ 0 };
+            scheduler.parallelFor(volumes.size(), grainSize, [&](uint32_t begin, uint32_t end) {
+                visibleCount.fetch_add(FrustumCulling::cull(frustum, volumes, begin, end, visibility, kernel), std::memory_order_relaxed);
+            });
+            return visibleCount.load();
+        }
+    }
+
+    Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+    {
+        // glm matrices are column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+        auto row = [&viewProjection](uint32_t i) {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        };
+        Frustum frustum;
+        frustum.planes[left] = row(3) + row(0);
+        frustum.planes[right] = row(3) - row(0);
+        frustum.planes[bottom] = row(3) + row(1);
+        frustum.planes[top] = row(3) - row(1);
+        // With a [0, 1] depth range the near plane is z >= 0 instead of z >= -w
+        frustum.planes[nearPlane] = row(2);
+        frustum.planes[farPlane] = row(3) - row(2);
+        // Normalized planes give actual distances, which are compared against bounding volume sizes
+        for (auto& plane : frustum.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    void BoundingSpheres::resize(uint32_t count)
+    {
+        this->count = count;
+        for (auto* values : { &centerX, &centerY, &centerZ, &radius }) {
+            values->resize(count);
+        }
+    }
+
+    void BoundingSpheres::set(uint32_t index, const glm::vec3& center, float radius)
+    {
+        assert(index < count);
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        this->radius[index] = radius;
+    }
+
+    void BoundingBoxes::resize(uint32_t count)
+    {
+        this->count = count;
+        for (auto* values : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+            values->resize(count);
+        }
+    }
+
+    void BoundingBoxes::set(uint32_t index, const glm::vec3& min, const glm::vec3& max)
+    {
+        assert(index < count);
+        const glm::vec3 center = (min + max) * 0.5f;
+        const glm::vec3 extent = (max - min) * 0.5f;
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        extentX[index] = extent.x;
+        extentY[index] = extent.y;
+        extentZ[index] = extent.z;
+    }
+
+    bool FrustumCulling::isSupported(Kernel kernel)
+    {
+        if (kernel == Kernel::scalar) {
+            return true;
+        }
+#if defined(FRUSTUM_CULLING_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4]{};
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        const bool sse2 = (info[3] & (1 << 26)) != 0;
+        // AVX registers also need to be saved by the operating system on context switches
+        const bool avx = ((info[2] & (1 << 27)) != 0) && ((info[2] & (1 << 28)) != 0) && ((_xgetbv(0) & 0x6) == 0x6);
+        bool avx2 = false;
+        if (avx && (maxLeaf >= 7)) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        const bool sse2 = __builtin_cpu_supports("sse2");
+        const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        switch (kernel) {
+        case Kernel::sse:
+            return sse2;
+        case Kernel::avx2:
+            return avx2;
+        default:
+            return false;
+        }
+#else
+        return false;
+#endif
+    }
+
+    FrustumCulling::Kernel FrustumCulling::getBestKernel()
+    {
+        static const Kernel bestKernel = isSupported(Kernel::avx2) ? Kernel::avx2 : (isSupported(Kernel::sse) ? Kernel::sse : Kernel::scalar);
+        return bestKernel;
+    }
+
+    const char* FrustumCulling::getKernelName(Kernel kernel)
+    {
+        switch (kernel) {
+        case Kernel::sse:
+            return "sse";
+        case Kernel::avx2:
+            return "avx2";
+        default:
+            return "scalar";
+        }
+    }
+
+    uint32_t FrustumCulling::cull(const Frustum& frustum, const BoundingSpheres& volumes, uint32_t begin, uint32_t end, uint8_t* visibility, Kernel kernel)
+    {
+        assert(end <= volumes.size());
+        const Planes planes(frustum);
+        switch (kernel) {
+#if defined(FRUSTUM_CULLING_X86)
+        case Kernel::sse:
+            return cullSpheresSSE(planes, volumes, begin, end, visibility);
+        case Kernel::avx2:
+            return cullSpheresAVX2(planes, volumes, begin, end, visibility);
+#endif
+        default:
+            return cullSpheresScalar(planes, volumes, begin, end, visibility);
+        }
+    }
+
+    uint32_t FrustumCulling::cull(const Frustum& frustum, const BoundingBoxes& volumes, uint32_t begin, uint32_t end, uint8_t* visibility, Kernel kernel)
+    {
+        assert(end <= volumes.size());
+        const Planes planes(frustum);
+        switch (kernel) {
+#if defined(FRUSTUM_CULLING_X86)
+        case Kernel::sse:
+            return cullBoxesSSE(planes, volumes, begin, end, visibility);
+        case Kernel::avx2:
+            return cullBoxesAVX2(planes, volumes, begin, end, visibility);
+#endif
+        default:
+            return cullBoxesScalar(planes, volumes, begin, end, visibility);
+        }
+    }
+
+    uint32_t FrustumCulling::cull(TaskScheduler& scheduler, const Frustum& frustum, const BoundingSpheres& volumes, uint8_t* visibility, Kernel kernel, uint32_t grainSize)
+    {
+        return cullParallel(scheduler, frustum, volumes, visibility, kernel, grainSize);
+    }
+
+    uint32_t FrustumCulling::cull(TaskScheduler& scheduler, const Frustum& frustum, const BoundingBoxes& volumes, uint8_t* visibility, Kernel kernel, uint32_t grainSize)
+    {
+        return cullParallel(scheduler, frustum, volumes, visibility, kernel, grainSize);
+    }
+
+    void FrustumCulling::runBenchmark(uint32_t objectCount, uint32_t maxThreads, std::ostream& stream)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+        const uint32_t repetitions = 10;
+
+        // Objects are scattered around a camera at the origin looking down the negative z axis, so only part of them is visible
+        BoundingSpheres spheres;
+        BoundingBoxes boxes;
+        spheres.resize(objectCount);
+        boxes.resize(objectCount);
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> sizeDistribution(0.1f, 2.0f);
+        for (uint32_t i = 0; i < objectCount; ++i) {
+            const glm::vec3 center(positionDistribution(random), positionDistribution(random), positionDistribution(random));
+            const glm::vec3 extent(sizeDistribution(random), sizeDistribution(random), sizeDistribution(random));
+            spheres.set(i, center, glm::length(extent));
+            boxes.set(i, center - extent, center + extent);
+        }
+        const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 256.0f);
+        const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const Frustum frustum = Frustum::fromMatrix(projection * view);
+
+        std::vector<uint8_t> visibility(objectCount);
+        const uint32_t visibleSpheres = cull(frustum, spheres, 0, objectCount, visibility.data(), Kernel::scalar);
+        const uint32_t visibleBoxes = cull(frustum, boxes, 0, objectCount, visibility.data(), Kernel::scalar);
+
+        stream << "Frustum culling benchmark (" << objectCount << " bounding spheres and boxes, " << visibleSpheres << " spheres and " << visibleBoxes << " boxes visible)\n";
+        stream << std::setw(8) << "kernel" << std::setw(8) << "volume" << std::setw(9) << "threads" << std::setw(12) << "time (ms)" << std::setw(18) << "Mobjects/s" << std::setw(22) << "Mobjects/s per core" << "\n";
+
+        // Best time of all repetitions, the visible count is checked against the scalar kernel
+        auto measure = [&](const char* volume, uint32_t expectedCount, auto&& function) {
+            double time = 1e300;
+            bool matching = true;
+            for (uint32_t r = 0; r < repetitions; r++) {
+                auto tStart = Clock::now();
+                const uint32_t visibleCount = function();
+                auto tEnd = Clock::now();
+                time = std::min(time, std::chrono::duration<double, std::milli>(tEnd - tStart).count());
+                matching &= (visibleCount == expectedCount);
+            }
+            if (!matching) {
+                stream << "Warning: " << volume << " visible count does not match the scalar kernel\n";
+            }
+            return time;
+        };
+        auto printRow = [&](Kernel kernel, const char* volume, uint32_t threadCount, double time) {
+            const double throughput = (double)objectCount / (time * 1000.0);
+            stream << std::fixed << std::setw(8) << getKernelName(kernel) << std::setw(8) << volume << std::setw(9) << threadCount << std::setw(12) << std::setprecision(3) << time
+                << std::setw(18) << std::setprecision(1) << throughput << std::setw(22) << throughput / (double)threadCount << "\n";
+        };
+
+        // Single threaded throughput of every kernel
+        for (Kernel kernel : { Kernel::scalar, Kernel::sse, Kernel::avx2 }) {
+            if (!isSupported(kernel)) {
+                stream << std::setw(8) << getKernelName(kernel) << "  not supported by this CPU\n";
+                continue;
+            }
+            printRow(kernel, "sphere", 1, measure("sphere", visibleSpheres, [&]() { return cull(frustum, spheres, 0, objectCount, visibility.data(), kernel); }));
+            printRow(kernel, "box", 1, measure("box", visibleBoxes, [&]() { return cull(frustum, boxes, 0, objectCount, visibility.data(), kernel); }));
+        }
+
+        // Scaling of the best kernel over the task scheduler
+        const Kernel kernel = getBestKernel();
+        for (uint32_t threadCount = 2; threadCount <= std::max(maxThreads, 1u); threadCount++) {
+            TaskScheduler scheduler;
+            scheduler.create(threadCount - 1);
+            printRow(kernel, "sphere", threadCount, measure("sphere", visibleSpheres, [&]() { return cull(scheduler, frustum, spheres, visibility.data(), kernel); }));
+            printRow(kernel, "box", threadCount, measure("box", visibleBoxes, [&]() { return cull(scheduler, frustum, boxes, visibility.data(), kernel); }));
+            scheduler.destroy();
+        }
+    }
+}
@@ -0,0 +1,107 @@
+/*
+* View frustum culling of bounding volumes on the CPU
+*
+* Bounding spheres and axis aligned boxes are stored as structure of arrays, so SIMD kernels can test 4 (SSE) or 8 (AVX2)
+* objects against a frustum plane at once with plain loads. The kernel is selected at runtime based on the CPU,
+* with a scalar fallback for CPUs (or architectures) without SIMD support. Large sets are split over the task scheduler
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "TaskScheduler.h"
+
+namespace vks
+{
+    /** @brief Six normalized planes (xyz = normal pointing inwards, w = distance), a point p is inside a plane if dot(normal, p) + w >= 0 */
+    struct Frustum
+    {
+        enum Side { left = 0, right = 1, bottom = 2, top = 3, nearPlane = 4, farPlane = 5 };
+        std::array<glm::vec4, 6> planes{};
+
+        /** @brief Extract the planes from a combined (model-)view-projection matrix with a [0, 1] depth range (Gribb/Hartmann) */
+        static Frustum fromMatrix(const glm::mat4& viewProjection);
+    };
+
+    /** @brief Bounding spheres as structure of arrays */
+    struct BoundingSpheres
+    {
+        std::vector<float> centerX, centerY, centerZ, radius;
+
+        void resize(uint32_t count);
+        uint32_t size() const { return count; }
+        void set(uint32_t index, const glm::vec3& center, float radius);
+
+    private:
+        uint32_t count{ 0 };
+    };
+
+    /** @brief Axis aligned bounding boxes as structure of arrays (center and half extents) */
+    struct BoundingBoxes
+    {
+        std::vector<float> centerX, centerY, centerZ, extentX, extentY, extentZ;
+
+        void resize(uint32_t count);
+        uint32_t size() const { return count; }
+        void set(uint32_t index, const glm::vec3& min, const glm::vec3& max);
+
+    private:
+        uint32_t count{ 0 };
+    };
+
+    class FrustumCulling
+    {
+    public:
+        enum class Kernel { scalar, sse, avx2 };
+
+        /** @brief Widest kernel supported by the CPU (and the operating system) this is running on */
+        static Kernel getBestKernel();
+        static bool isSupported(Kernel kernel);
+        static const char* getKernelName(Kernel kernel);
+
+        /**
+        * Cull a range of bounding volumes
+        * Objects not filling a whole SIMD batch at the end of the range are tested with the scalar kernel
+        *
+        * @param frustum Frustum to test against
+        * @param volumes Bounding volumes
+        * @param begin First object to test
+        * @param end One past the last object to test
+        * @param visibility Receives 1 for every object intersecting the frustum and 0 for every culled object, must hold at least end elements
+        * @param kernel Kernel to use, must be supported
+        *
+        * @return Number of visible objects in the range
+        */
+        static uint32_t cull(const Frustum& frustum, const BoundingSpheres& volumes, uint32_t begin, uint32_t end, uint8_t* visibility, Kernel kernel);
+        static uint32_t cull(const Frustum& frustum, const BoundingBoxes& volumes, uint32_t begin, uint32_t end, uint8_t* visibility, Kernel kernel);
+
+        /**
+        * Cull all bounding volumes, split over the threads of the task scheduler
+        *
+        * @param grainSize (Optional) Maximum number of objects per task
+        *
+        * @return Number of visible objects
+        */
+        static uint32_t cull(TaskScheduler& scheduler, const Frustum& frustum, const BoundingSpheres& volumes, uint8_t* visibility, Kernel kernel, uint32_t grainSize = 65536);
+        static uint32_t cull(TaskScheduler& scheduler, const Frustum& frustum, const BoundingBoxes& volumes, uint8_t* visibility, Kernel kernel, uint32_t grainSize = 65536);
+
+        /**
+        * Measure the culling throughput of all supported kernels, single threaded and with 1 to maxThreads threads
+        *
+        * @param objectCount Number of bounding spheres and boxes to cull
+        * @param maxThreads Maximum number of threads (including the calling thread)
+        * @param stream Stream the results are written to
+        */
+        static void runBenchmark(uint32_t objectCount, uint32_t maxThreads, std::ostream& stream);
+    };
+}
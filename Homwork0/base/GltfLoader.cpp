@@ -0,0 +1,901 @@
+/*
+* Memory mapped glTF 2.0 binary (GLB) mesh loader
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "GltfLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+
+#include "Profiler.h"
+
+namespace vks
+{
+    namespace
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        double millisecondsSince(Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        constexpr uint32_t glbMagic = 0x46546C67;
+        constexpr uint32_t chunkTypeJson = 0x4E4F534A;
+        constexpr uint32_t chunkTypeBin = 0x004E4942;
+
+        // Accessor component types
+        constexpr uint32_t componentByte = 5120;
+        constexpr uint32_t componentUnsignedByte = 5121;
+        constexpr uint32_t componentShort = 5122;
+        constexpr uint32_t componentUnsignedShort = 5123;
+        constexpr uint32_t componentUnsignedInt = 5125;
+        constexpr uint32_t componentFloat = 5126;
+
+        constexpr uint32_t modeTriangles = 4;
+
+        // Minimal JSON document, only as much as is needed to read the glTF JSON chunk
+        struct JsonValue
+        {
+            enum class Type { null, boolean, number, string, array, object };
+            Type type{ Type::null };
+            bool boolean{ false };
+            double number{ 0.0 };
+            std::string string;
+            // Array elements or object member values, object member names are stored in keys with the same index
+            std::vector<JsonValue> elements;
+            std::vector<std::string> keys;
+
+            static const JsonValue& none()
+            {
+                static const JsonValue value;
+                return value;
+            }
+
+            const JsonValue& operator[](const char* key) const
+            {
+                if (type == Type::object) {
+                    for (size_t i = 0; i < keys.size(); ++i) {
+                        if (keys[i] == key) {
+                            return elements[i];
+                        }
+                    }
+                }
+                return none();
+            }
+
+            const JsonValue& operator[](size_t index) const
+            {
+                return ((type == Type::array) && (index < elements.size())) ? elements[index] : none();
+            }
+
+            // Integer literals would otherwise be ambiguous between the index and the (null pointer) key overload
+            const JsonValue& operator[](int index) const
+            {
+                return (index >= 0) ? (*this)[(size_t)index] : none();
+            }
+
+            bool isNull() const { return type == Type::null; }
+            size_t size() const { return (type == Type::array) ? elements.size() : 0; }
+            double asNumber(double defaultValue = 0.0) const { return (type == Type::number) ? number : defaultValue; }
+            bool asBool(bool defaultValue = false) const { return (type == Type::boolean) ? boolean : defaultValue; }
+            /** @brief Non-negative integer (e.g. an index or count), or the default value if this isn't one */
+            uint64_t asUint(uint64_t defaultValue = 0) const
+            {
+                return ((type == Type::number) && (number >= 0.0) && (number <= 9007199254740992.0) && (number == (double)(uint64_t)number)) ? (uint64_t)number : defaultValue;
+            }
+        };
+
+        class JsonParser
+        {
+        public:
+            JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+            bool parse(JsonValue& value)
+            {
+                if (!parseValue(value, 0)) {
+                    return false;
+                }
+                skipWhitespace();
+                return p == end;
+            }
+
+        private:
+            // Nesting limit, so malformed files can't overflow the stack
+            static constexpr uint32_t maxDepth = 256;
+            const char* p;
+            const char* end;
+
+            void skipWhitespace()
+            {
+                while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r'))) {
+                    p++;
+                }
+            }
+
+            bool parseValue(JsonValue& value, uint32_t depth)
+            {
+                skipWhitespace();
+                if ((p >= end) || (depth > maxDepth)) {
+                    return false;
+                }
+                switch (*p) {
+                case '{':
+                    return parseObject(value, depth);
+                case '[':
+                    return parseArray(value, depth);
+                case '"':
+                    value.type = JsonValue::Type::string;
+                    return parseString(value.string);
+                case 't':
+                    value.type = JsonValue::Type::boolean;
+                    value.boolean = true;
+                    return parseLiteral("true");
+                case 'f':
+                    value.type = JsonValue::Type::boolean;
+                    value.boolean = false;
+                    return parseLiteral("false");
+                case 'n':
+                    value.type = JsonValue::Type::null;
+                    return parseLiteral("null");
+                default:
+                    value.type = JsonValue::Type::number;
+                    return parseNumber(value.number);
+                }
+            }
+
+            bool parseObject(JsonValue& value, uint32_t depth)
+            {
+                value.type = JsonValue::Type::object;
+                p++;
+                skipWhitespace();
+                if ((p < end) && (*p == '}')) {
+                    p++;
+                    return true;
+                }
+                for (;;) {
+                    skipWhitespace();
+                    value.keys.emplace_back();
+                    if ((p >= end) || (*p != '"') || !parseString(value.keys.back())) {
+                        return false;
+                    }
+                    skipWhitespace();
+                    if ((p >= end) || (*p != ':')) {
+                        return false;
+                    }
+                    p++;
+                    value.elements.emplace_back();
+                    if (!parseValue(value.elements.back(), depth + 1)) {
+                        return false;
+                    }
+                    skipWhitespace();
+                    if ((p < end) && (*p == ',')) {
+                        p++;
+                        continue;
+                    }
+                    if ((p < end) && (*p == '}')) {
+                        p++;
+                        return true;
+                    }
+                    return false;
+                }
+            }
+
+            bool parseArray(JsonValue& value, uint32_t depth)
+            {
+                value.type = JsonValue::Type::array;
+                p++;
+                skipWhitespace();
+                if ((p < end) && (*p == ']')) {
+                    p++;
+                    return true;
+                }
+                for (;;) {
+                    value.elements.emplace_back();
+                    if (!parseValue(value.elements.back(), depth + 1)) {
+                        return false;
+                    }
+                    skipWhitespace();
+                    if ((p < end) && (*p == ',')) {
+                        p++;
+                        continue;
+                    }
+                    if ((p < end) && (*p == ']')) {
+                        p++;
+                        return true;
+                    }
+                    return false;
+                }
+            }
+
+            bool parseLiteral(const char* literal)
+            {
+                const size_t length = strlen(literal);
+                if (((size_t)(end - p) < length) || (memcmp(p, literal, length) != 0)) {
+                    return false;
+                }
+                p += length;
+                return true;
+            }
+
+            bool parseHex(uint32_t& codePoint)
+            {
+                if (end - p < 4) {
+                    return false;
+                }
+                codePoint = 0;
+                for (uint32_t i = 0; i < 4; ++i) {
+                    const char c = *p++;
+                    codePoint <<= 4;
+                    if ((c >= '0') && (c <= '9')) {
+                        codePoint |= (uint32_t)(c - '0');
+                    }
+                    else if ((c >= 'a') && (c <= 'f')) {
+                        codePoint |= (uint32_t)(c - 'a' + 10);
+                    }
+                    else if ((c >= 'A') && (c <= 'F')) {
+                        codePoint |= (uint32_t)(c - 'A' + 10);
+                    }
+                    else {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            bool parseString(std::string& string)
+            {
+                p++;
+                while (p < end) {
+                    const char c = *p++;
+                    if (c == '"') {
+                        return true;
+                    }
+                    if ((uint8_t)c < 0x20) {
+                        return false;
+                    }
+                    if (c != '\\') {
+                        string.push_back(c);
+                        continue;
+                    }
+                    if (p >= end) {
+                        return false;
+                    }
+                    const char escaped = *p++;
+                    switch (escaped) {
+                    case '"': string.push_back('"'); break;
+                    case '\\': string.push_back('\\'); break;
+                    case '/': string.push_back('/'); break;
+                    case 'b': string.push_back('\b'); break;
+                    case 'f': string.push_back('\f'); break;
+                    case 'n': string.push_back('\n'); break;
+                    case 'r': string.push_back('\r'); break;
+                    case 't': string.push_back('\t'); break;
+                    case 'u': {
+                        uint32_t codePoint = 0;
+                        if (!parseHex(codePoint)) {
+                            return false;
+                        }
+                        // Characters outside of the basic multilingual plane are encoded as surrogate pairs
+                        if ((codePoint >= 0xD800) && (codePoint <= 0xDBFF)) {
+                            uint32_t low = 0;
+                            if ((end - p < 2) || (p[0] != '\\') || (p[1] != 'u')) {
+                                return false;
+                            }
+                            p += 2;
+                            if (!parseHex(low) || (low < 0xDC00) || (low > 0xDFFF)) {
+                                return false;
+                            }
+                            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        // UTF-8 encode
+                        if (codePoint < 0x80) {
+                            string.push_back((char)codePoint);
+                        }
+                        else if (codePoint < 0x800) {
+                            string.push_back((char)(0xC0 | (codePoint >> 6)));
+                            string.push_back((char)(0x80 | (codePoint & 0x3F)));
+                        }
+                        else if (codePoint < 0x10000) {
+                            string.push_back((char)(0xE0 | (codePoint >> 12)));
+                            string.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+                            string.push_back((char)(0x80 | (codePoint & 0x3F)));
+                        }
+                        else {
+                            string.push_back((char)(0xF0 | (codePoint >> 18)));
+                            string.push_back((char)(0x80 | ((codePoint >> 12) & 0x3F)));
+                            string.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+                            string.push_back((char)(0x80 | (codePoint & 0x3F)));
+                        }
+                        break;
+                    }
+                    default:
+                        return false;
+                    }
+                }
+                return false;
+            }
+
+            bool parseNumber(double& number)
+            {
+                // The chunk isn't null terminated, so the number is copied before converting it
+                const char* start = p;
+                while ((p < end) && (((*p >= '0') && (*p <= '9')) || (*p == '-') || (*p == '+') || (*p == '.') || (*p == 'e') || (*p == 'E'))) {
+                    p++;
+                }
+                if ((p == start) || (p - start > 63)) {
+                    return false;
+                }
+                char buffer[64];
+                memcpy(buffer, start, p - start);
+                buffer[p - start] = '\0';
+                char* parsedEnd = nullptr;
+                number = strtod(buffer, &parsedEnd);
+                return parsedEnd == buffer + (p - start);
+            }
+        };
+
+        uint32_t getComponentSize(uint32_t componentType)
+        {
+            switch (componentType) {
+            case componentByte:
+            case componentUnsignedByte:
+                return 1;
+            case componentShort:
+            case componentUnsignedShort:
+                return 2;
+            case componentUnsignedInt:
+            case componentFloat:
+                return 4;
+            default:
+                return 0;
+            }
+        }
+
+        uint32_t getComponentCount(const std::string& type)
+        {
+            if (type == "SCALAR") return 1;
+            if (type == "VEC2") return 2;
+            if (type == "VEC3") return 3;
+            if (type == "VEC4") return 4;
+            if (type == "MAT2") return 4;
+            if (type == "MAT3") return 9;
+            if (type == "MAT4") return 16;
+            return 0;
+        }
+
+        // Reads one component of an accessor element as float, normalized integers are mapped to [0, 1] or [-1, 1]
+        float readComponent(const uint8_t* data, uint32_t componentType, bool normalized)
+        {
+            switch (componentType) {
+            case componentFloat: {
+                float value;
+                memcpy(&value, data, sizeof(float));
+                return value;
+            }
+            case componentUnsignedByte:
+                return normalized ? (float)data[0] / 255.0f : (float)data[0];
+            case componentByte:
+                return normalized ? std::max((float)(int8_t)data[0] / 127.0f, -1.0f) : (float)(int8_t)data[0];
+            case componentUnsignedShort: {
+                uint16_t value;
+                memcpy(&value, data, sizeof(value));
+                return normalized ? (float)value / 65535.0f : (float)value;
+            }
+            case componentShort: {
+                int16_t value;
+                memcpy(&value, data, sizeof(value));
+                return normalized ? std::max((float)value / 32767.0f, -1.0f) : (float)value;
+            }
+            case componentUnsignedInt: {
+                uint32_t value;
+                memcpy(&value, data, sizeof(value));
+                return (float)value;
+            }
+            default:
+                return 0.0f;
+            }
+        }
+
+        glm::vec3 readVec3(const uint8_t* element, uint32_t componentType, bool normalized)
+        {
+            const uint32_t componentSize = getComponentSize(componentType);
+            return glm::vec3(readComponent(element, componentType, normalized), readComponent(element + componentSize, componentType, normalized),
+                readComponent(element + componentSize * 2, componentType, normalized));
+        }
+
+        // Reads an index of an unsigned byte, short or int index accessor
+        uint32_t readIndex(const uint8_t* data, uint32_t componentType)
+        {
+            switch (componentType) {
+            case componentUnsignedByte:
+                return data[0];
+            case componentUnsignedShort: {
+                uint16_t value;
+                memcpy(&value, data, sizeof(value));
+                return value;
+            }
+            default: {
+                uint32_t value;
+                memcpy(&value, data, sizeof(value));
+                return value;
+            }
+            }
+        }
+
+        // Local transform of a node, either given as matrix or as translation, rotation (quaternion) and scale
+        glm::mat4 getNodeTransform(const JsonValue& node)
+        {
+            glm::mat4 transform(1.0f);
+            const JsonValue& matrix = node["matrix"];
+            if (matrix.size() == 16) {
+                // Column major, like glm
+                for (uint32_t i = 0; i < 16; ++i) {
+                    transform[i / 4][i % 4] = (float)matrix[(size_t)i].asNumber();
+                }
+                return transform;
+            }
+            const JsonValue& t = node["translation"];
+            const JsonValue& r = node["rotation"];
+            const JsonValue& s = node["scale"];
+            const glm::vec3 translation = (t.size() == 3) ? glm::vec3((float)t[0].asNumber(), (float)t[1].asNumber(), (float)t[2].asNumber()) : glm::vec3(0.0f);
+            const glm::vec3 scale = (s.size() == 3) ? glm::vec3((float)s[0].asNumber(1.0), (float)s[1].asNumber(1.0), (float)s[2].asNumber(1.0)) : glm::vec3(1.0f);
+            float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+            if (r.size() == 4) {
+                x = (float)r[0].asNumber();
+                y = (float)r[1].asNumber();
+                z = (float)r[2].asNumber();
+                w = (float)r[3].asNumber(1.0);
+            }
+            // T * R * S, with the rotation matrix of the unit quaternion (x, y, z, w)
+            transform[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f) * scale.x;
+            transform[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f) * scale.y;
+            transform[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f) * scale.z;
+            transform[3] = glm::vec4(translation, 1.0f);
+            return transform;
+        }
+    }
+
+    bool GltfLoader::load(const std::string& filename, TaskScheduler& scheduler)
+    {
+        PROFILE_FUNCTION();
+        clear();
+        this->scheduler = &scheduler;
+
+        auto fail = [this, &filename](const std::string& reason) {
+            std::cerr << "Could not load glTF file \"" << filename << "\": " << reason << "\n";
+            clear();
+            return false;
+        };
+
+        auto tStart = Clock::now();
+        if (!file.open(filename)) {
+            return fail("file could not be opened");
+        }
+        statistics.fileSize = file.size();
+        statistics.mapTime = millisecondsSince(tStart);
+
+        // Header (magic, version, length) followed by the JSON chunk and an optional BIN chunk, each with length and type
+        tStart = Clock::now();
+        const uint8_t* data = file.data();
+        auto readUint32 = [data](uint64_t offset) {
+            uint32_t value;
+            memcpy(&value, data + offset, sizeof(value));
+            return value;
+        };
+        if ((file.size() < 20) || (readUint32(0) != glbMagic)) {
+            return fail("not a binary glTF file");
+        }
+        if (readUint32(4) != 2) {
+            return fail("unsupported glTF version " + std::to_string(readUint32(4)));
+        }
+        const uint64_t glbLength = std::min<uint64_t>(readUint32(8), file.size());
+        const uint64_t jsonLength = readUint32(12);
+        if ((readUint32(16) != chunkTypeJson) || (20 + jsonLength > glbLength)) {
+            return fail("missing JSON chunk");
+        }
+        const char* json = reinterpret_cast<const char*>(data + 20);
+        const uint8_t* bin = nullptr;
+        uint64_t binLength = 0;
+        const uint64_t binChunkOffset = 20 + jsonLength;
+        if ((binChunkOffset + 8 <= glbLength) && (readUint32(binChunkOffset + 4) == chunkTypeBin)) {
+            binLength = std::min<uint64_t>(readUint32(binChunkOffset), glbLength - binChunkOffset - 8);
+            bin = data + binChunkOffset + 8;
+        }
+        statistics.jsonSize = jsonLength;
+        statistics.binSize = binLength;
+
+        JsonValue document;
+        if (!JsonParser(json, json + jsonLength).parse(document)) {
+            return fail("malformed JSON chunk");
+        }
+
+        const JsonValue& buffers = document["buffers"];
+        const JsonValue& bufferViews = document["bufferViews"];
+        const JsonValue& accessors = document["accessors"];
+        const JsonValue& meshes = document["meshes"];
+        const JsonValue& nodes = document["nodes"];
+        statistics.meshCount = static_cast<uint32_t>(meshes.size());
+
+        // Resolves an accessor to its location in the BIN chunk, checking that all of its elements are inside of it
+        std::string accessorError;
+        auto resolveAccessor = [&](const JsonValue& index, Accessor& accessor) {
+            const JsonValue& source = accessors[(size_t)index.asUint(std::numeric_limits<uint64_t>::max())];
+            if (source.isNull()) {
+                accessorError = "invalid accessor index";
+                return false;
+            }
+            if (!source["sparse"].isNull()) {
+                accessorError = "sparse accessors are not supported";
+                return false;
+            }
+            accessor.componentType = (uint32_t)source["componentType"].asUint();
+            accessor.componentCount = getComponentCount(source["type"].string);
+            accessor.normalized = source["normalized"].asBool();
+            const uint64_t count = source["count"].asUint(std::numeric_limits<uint64_t>::max());
+            const uint32_t elementSize = getComponentSize(accessor.componentType) * accessor.componentCount;
+            if ((elementSize == 0) || (count > std::numeric_limits<uint32_t>::max())) {
+                accessorError = "invalid accessor";
+                return false;
+            }
+            accessor.count = (uint32_t)count;
+            accessor.stride = elementSize;
+            // Accessors without buffer view are all zeros
+            if (source["bufferView"].isNull()) {
+                accessor.data = nullptr;
+                return true;
+            }
+            const JsonValue& view = bufferViews[(size_t)source["bufferView"].asUint(std::numeric_limits<uint64_t>::max())];
+            const uint64_t bufferIndex = view["buffer"].asUint(std::numeric_limits<uint64_t>::max());
+            if (view.isNull() || (bufferIndex != 0) || !buffers[0]["uri"].isNull() || !bin) {
+                accessorError = "only data in the GLB BIN chunk is supported";
+                return false;
+            }
+            const uint64_t viewOffset = view["byteOffset"].asUint(0);
+            const uint64_t viewLength = view["byteLength"].asUint(0);
+            const uint64_t accessorOffset = source["byteOffset"].asUint(0);
+            // The spec limits strides to multiples of four up to 252 bytes
+            const uint64_t byteStride = view["byteStride"].asUint(0);
+            if ((byteStride > 252) || (byteStride % 4 != 0)) {
+                accessorError = "invalid buffer view stride";
+                return false;
+            }
+            accessor.stride = (uint32_t)std::max<uint64_t>(byteStride, elementSize);
+            // All checks are done as subtractions of values known to be in range, as the sums of values from the file could overflow
+            if ((viewLength > binLength) || (viewOffset > binLength - viewLength)) {
+                accessorError = "buffer view exceeds the BIN chunk";
+                return false;
+            }
+            if ((count > 0) && ((accessorOffset > viewLength) || (elementSize > viewLength - accessorOffset) ||
+                (count - 1 > (viewLength - accessorOffset - elementSize) / accessor.stride))) {
+                accessorError = "accessor exceeds its buffer view";
+                return false;
+            }
+            accessor.data = bin + viewOffset + accessorOffset;
+            return true;
+        };
+
+        // Every primitive of every mesh instance in the scene becomes one merged primitive
+        uint64_t vertexCount = 0;
+        uint64_t indexCount = 0;
+        boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        auto addMesh = [&](const JsonValue& mesh, const glm::mat4& transform) {
+            const JsonValue& meshPrimitives = mesh["primitives"];
+            for (size_t i = 0; i < meshPrimitives.size(); ++i) {
+                const JsonValue& primitive = meshPrimitives[i];
+                if (primitive["mode"].asUint(modeTriangles) != modeTriangles) {
+                    continue;
+                }
+                const JsonValue& attributes = primitive["attributes"];
+                Source source{};
+                source.transform = transform;
+                source.identity = (transform == glm::mat4(1.0f));
+                if (!resolveAccessor(attributes["POSITION"], source.position)) {
+                    return false;
+                }
+                if (source.position.componentCount != 3) {
+                    accessorError = "positions must be three component vectors";
+                    return false;
+                }
+                if (source.position.count == 0) {
+                    continue;
+                }
+                if (!attributes["NORMAL"].isNull()) {
+                    source.hasNormals = resolveAccessor(attributes["NORMAL"], source.normal) && (source.normal.componentCount == 3) && (source.normal.count >= source.position.count);
+                }
+                if (!attributes["COLOR_0"].isNull()) {
+                    source.hasColors = resolveAccessor(attributes["COLOR_0"], source.color) && (source.color.componentCount >= 3) && (source.color.count >= source.position.count);
+                }
+                if (!primitive["indices"].isNull()) {
+                    if (!resolveAccessor(primitive["indices"], source.indices)) {
+                        return false;
+                    }
+                    if ((source.indices.componentCount != 1) || (source.indices.componentType == componentFloat) || (source.indices.componentType == componentByte) || (source.indices.componentType == componentShort)) {
+                        accessorError = "invalid index accessor";
+                        return false;
+                    }
+                    source.hasIndices = true;
+                }
+
+                Primitive merged{};
+                merged.firstIndex = (uint32_t)indexCount;
+                merged.vertexOffset = (int32_t)vertexCount;
+                merged.vertexCount = source.position.count;
+                merged.indexCount = source.hasIndices ? source.indices.count : source.position.count;
+                vertexCount += merged.vertexCount;
+                indexCount += merged.indexCount;
+                if ((vertexCount > (uint64_t)std::numeric_limits<int32_t>::max()) || (indexCount > std::numeric_limits<uint32_t>::max())) {
+                    accessorError = "scene is too large";
+                    return false;
+                }
+                primitives.push_back(merged);
+                sources.push_back(source);
+
+                // Position accessors are required to have bounds, these are transformed into scene space
+                const JsonValue& minimum = accessors[(size_t)attributes["POSITION"].asUint()]["min"];
+                const JsonValue& maximum = accessors[(size_t)attributes["POSITION"].asUint()]["max"];
+                if ((minimum.size() == 3) && (maximum.size() == 3)) {
+                    for (uint32_t corner = 0; corner < 8; ++corner) {
+                        const glm::vec4 position((float)((corner & 1) ? maximum : minimum)[0].asNumber(), (float)((corner & 2) ? maximum : minimum)[1].asNumber(),
+                            (float)((corner & 4) ? maximum : minimum)[2].asNumber(), 1.0f);
+                        const glm::vec3 transformed = glm::vec3(transform * position);
+                        boundsMin = glm::min(boundsMin, transformed);
+                        boundsMax = glm::max(boundsMax, transformed);
+                    }
+                }
+            }
+            return true;
+        };
+
+        // Walk the node hierarchy of the default scene, files without scenes have their meshes added untransformed
+        const JsonValue& scenes = document["scenes"];
+        if (scenes.size() > 0) {
+            const JsonValue& scene = scenes[(size_t)document["scene"].asUint(0)];
+            std::function<bool(const JsonValue&, const glm::mat4&, uint32_t)> addNode = [&](const JsonValue& index, const glm::mat4& parentTransform, uint32_t depth) {
+                const JsonValue& node = nodes[(size_t)index.asUint(std::numeric_limits<uint64_t>::max())];
+                // The depth limit also stops cycles in malformed files
+                if (node.isNull() || (depth > 64)) {
+                    accessorError = "invalid node hierarchy";
+                    return false;
+                }
+                const glm::mat4 transform = parentTransform * getNodeTransform(node);
+                if (!node["mesh"].isNull()) {
+                    const JsonValue& mesh = meshes[(size_t)node["mesh"].asUint(std::numeric_limits<uint64_t>::max())];
+                    if (mesh.isNull() || !addMesh(mesh, transform)) {
+                        accessorError = accessorError.empty() ? "invalid mesh index" : accessorError;
+                        return false;
+                    }
+                }
+                const JsonValue& children = node["children"];
+                for (size_t i = 0; i < children.size(); ++i) {
+                    if (!addNode(children[i], transform, depth + 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            const JsonValue& rootNodes = scene["nodes"];
+            for (size_t i = 0; i < rootNodes.size(); ++i) {
+                if (!addNode(rootNodes[i], glm::mat4(1.0f), 0)) {
+                    return fail(accessorError);
+                }
+            }
+        }
+        else {
+            for (size_t i = 0; i < meshes.size(); ++i) {
+                if (!addMesh(meshes[i], glm::mat4(1.0f))) {
+                    return fail(accessorError);
+                }
+            }
+        }
+        if (primitives.empty()) {
+            return fail("no triangle primitives");
+        }
+
+        // Indices are checked against the vertex count of their primitive, so draws can't fetch vertices of other primitives or outside of the vertex buffer
+        for (size_t p = 0; p < primitives.size(); ++p) {
+            const Accessor& indices = sources[p].indices;
+            if (!sources[p].hasIndices || !indices.data) {
+                continue;
+            }
+            std::atomic<uint32_t> maxIndex{ 0 };
+            scheduler.parallelFor(indices.count, 262144, [&](uint32_t begin, uint32_t end) {
+                uint32_t localMax = 0;
+                for (uint32_t i = begin; i < end; ++i) {
+                    localMax = std::max(localMax, readIndex(indices.data + (size_t)i * indices.stride, indices.componentType));
+                }
+                uint32_t current = maxIndex.load(std::memory_order_relaxed);
+                while ((localMax > current) && !maxIndex.compare_exchange_weak(current, localMax, std::memory_order_relaxed)) {
+                }
+            });
+            if (maxIndex.load() >= primitives[p].vertexCount) {
+                return fail("indices reference vertices that don't exist");
+            }
+        }
+        if (boundsMin.x > boundsMax.x) {
+            boundsMin = glm::vec3(-1.0f);
+            boundsMax = glm::vec3(1.0f);
+        }
+        statistics.primitiveCount = static_cast<uint32_t>(primitives.size());
+        statistics.vertexCount = static_cast<uint32_t>(vertexCount);
+        statistics.indexCount = static_cast<uint32_t>(indexCount);
+        statistics.parseTime = millisecondsSince(tStart);
+        return true;
+    }
+
+    void GltfLoader::writeVertices(void* dst, uint32_t firstVertex, uint32_t vertexCount, const VertexFormat& format)
+    {
+        PROFILE_FUNCTION();
+        assert(scheduler);
+        assert(firstVertex + vertexCount <= statistics.vertexCount);
+        auto tStart = Clock::now();
+        std::atomic<uint64_t> copiedBytes{ 0 };
+        std::atomic<uint64_t> convertedBytes{ 0 };
+        uint8_t* destination = static_cast<uint8_t*>(dst);
+        const uint32_t positionSize = format.getPositionSize();
+        const uint32_t normalSize = format.getNormalSize();
+        const uint32_t colorSize = format.getColorSize();
+        scheduler->parallelFor(vertexCount, 65536, [&](uint32_t begin, uint32_t end) {
+            uint64_t copied = 0;
+            uint64_t converted = 0;
+            const uint32_t last = firstVertex + end;
+            uint32_t vertex = firstVertex + begin;
+            // Primitive containing the first vertex of this part
+            size_t p = std::upper_bound(primitives.begin(), primitives.end(), vertex, [](uint32_t v, const Primitive& primitive) { return v < (uint32_t)primitive.vertexOffset; }) - primitives.begin() - 1;
+            for (; vertex < last; ++p) {
+                const Primitive& primitive = primitives[p];
+                const Source& source = sources[p];
+                const uint32_t runBegin = vertex - (uint32_t)primitive.vertexOffset;
+                const uint32_t runEnd = std::min(last - (uint32_t)primitive.vertexOffset, primitive.vertexCount);
+                const uint32_t runLength = runEnd - runBegin;
+                uint8_t* out = destination + (size_t)(vertex - firstVertex) * format.stride;
+
+                // Float positions are copied as they are if no transform has to be applied, with a single copy if source and destination are tightly packed
+                const Accessor& position = source.position;
+                if ((format.positionEncoding == VertexFormat::PositionEncoding::eFloat) && source.identity && position.data && (position.componentType == componentFloat)) {
+                    if ((position.stride == 12) && (format.stride == 12) && (format.positionOffset == 0)) {
+                        memcpy(out, position.data + (size_t)runBegin * 12, (size_t)runLength * 12);
+                    }
+                    else {
+                        for (uint32_t i = 0; i < runLength; ++i) {
+                            memcpy(out + (size_t)i * format.stride + format.positionOffset, position.data + (size_t)(runBegin + i) * position.stride, 12);
+                        }
+                    }
+                    copied += (uint64_t)runLength * 12;
+                }
+                else {
+                    for (uint32_t i = 0; i < runLength; ++i) {
+                        const glm::vec3 value = position.data ? readVec3(position.data + (size_t)(runBegin + i) * position.stride, position.componentType, position.normalized) : glm::vec3(0.0f);
+                        format.writePosition(out + (size_t)i * format.stride, source.identity ? value : glm::vec3(source.transform * glm::vec4(value, 1.0f)));
+                    }
+                    converted += (uint64_t)runLength * positionSize;
+                }
+
+                // Normals are rotated into scene space with the upper 3x3 of the transform, which is only exact without non-uniform scaling (good enough for visualization)
+                // They are needed for the normal attribute and as color if there is no COLOR_0
+                const Accessor& normal = source.normal;
+                const bool normalsAvailable = source.hasNormals && normal.data;
+                const glm::mat3 normalTransform(source.transform);
+                auto readNormal = [&](uint32_t index) {
+                    glm::vec3 value = readVec3(normal.data + (size_t)index * normal.stride, normal.componentType, normal.normalized);
+                    if (!source.identity) {
+                        value = normalTransform * value;
+                        const float length = glm::length(value);
+                        value = (length > 0.0f) ? value / length : value;
+                    }
+                    return value;
+                };
+                if (format.hasNormals()) {
+                    if ((format.normalEncoding == VertexFormat::NormalEncoding::eFloat) && source.identity && normalsAvailable && (normal.componentType == componentFloat)) {
+                        for (uint32_t i = 0; i < runLength; ++i) {
+                            memcpy(out + (size_t)i * format.stride + format.normalOffset, normal.data + (size_t)(runBegin + i) * normal.stride, 12);
+                        }
+                        copied += (uint64_t)runLength * 12;
+                    }
+                    else {
+                        for (uint32_t i = 0; i < runLength; ++i) {
+                            format.writeNormal(out + (size_t)i * format.stride, normalsAvailable ? readNormal(runBegin + i) : glm::vec3(0.0f));
+                        }
+                        converted += (uint64_t)runLength * normalSize;
+                    }
+                }
+
+                // Colors come from COLOR_0 (copied if stored as three floats and the format has float colors), otherwise they visualize the normals
+                const Accessor& color = source.color;
+                if ((format.colorEncoding == VertexFormat::ColorEncoding::eFloat) && source.hasColors && color.data && (color.componentType == componentFloat) && (color.componentCount == 3)) {
+                    for (uint32_t i = 0; i < runLength; ++i) {
+                        memcpy(out + (size_t)i * format.stride + format.colorOffset, color.data + (size_t)(runBegin + i) * color.stride, 12);
+                    }
+                    copied += (uint64_t)runLength * 12;
+                }
+                else {
+                    for (uint32_t i = 0; i < runLength; ++i) {
+                        glm::vec3 value(1.0f);
+                        if (source.hasColors) {
+                            value = color.data ? readVec3(color.data + (size_t)(runBegin + i) * color.stride, color.componentType, color.normalized) : glm::vec3(0.0f);
+                        }
+                        else if (normalsAvailable) {
+                            value = readNormal(runBegin + i) * 0.5f + 0.5f;
+                        }
+                        format.writeColor(out + (size_t)i * format.stride, value);
+                    }
+                    converted += (uint64_t)runLength * colorSize;
+                }
+                vertex += runLength;
+            }
+            copiedBytes.fetch_add(copied, std::memory_order_relaxed);
+            convertedBytes.fetch_add(converted, std::memory_order_relaxed);
+        });
+        statistics.copiedBytes += copiedBytes.load();
+        statistics.convertedBytes += convertedBytes.load();
+        statistics.writeTime += millisecondsSince(tStart);
+    }
+
+    void GltfLoader::writeIndices(void* dst, uint32_t firstIndex, uint32_t indexCount)
+    {
+        PROFILE_FUNCTION();
+        assert(scheduler);
+        assert(firstIndex + indexCount <= statistics.indexCount);
+        auto tStart = Clock::now();
+        std::atomic<uint64_t> copiedBytes{ 0 };
+        std::atomic<uint64_t> convertedBytes{ 0 };
+        uint32_t* destination = static_cast<uint32_t*>(dst);
+        scheduler->parallelFor(indexCount, 262144, [&](uint32_t begin, uint32_t end) {
+            uint64_t copied = 0;
+            uint64_t converted = 0;
+            const uint32_t last = firstIndex + end;
+            uint32_t index = firstIndex + begin;
+            size_t p = std::upper_bound(primitives.begin(), primitives.end(), index, [](uint32_t i, const Primitive& primitive) { return i < primitive.firstIndex; }) - primitives.begin() - 1;
+            for (; index < last; ++p) {
+                const Primitive& primitive = primitives[p];
+                const Accessor& indices = sources[p].indices;
+                const uint32_t runBegin = index - primitive.firstIndex;
+                const uint32_t runEnd = std::min(last - primitive.firstIndex, primitive.indexCount);
+                const uint32_t runLength = runEnd - runBegin;
+                uint32_t* out = destination + (index - firstIndex);
+                // Indices are relative to the primitive's first vertex (applied as vertex offset when drawing), so 32 bit indices are copied as they are
+                if (!sources[p].hasIndices) {
+                    for (uint32_t i = 0; i < runLength; ++i) {
+                        out[i] = runBegin + i;
+                    }
+                    converted += (uint64_t)runLength * 4;
+                }
+                else if (indices.data && (indices.componentType == componentUnsignedInt) && (indices.stride == 4)) {
+                    memcpy(out, indices.data + (size_t)runBegin * 4, (size_t)runLength * 4);
+                    copied += (uint64_t)runLength * 4;
+                }
+                else {
+                    for (uint32_t i = 0; i < runLength; ++i) {
+                        out[i] = indices.data ? readIndex(indices.data + (size_t)(runBegin + i) * indices.stride, indices.componentType) : 0;
+                    }
+                    converted += (uint64_t)runLength * 4;
+                }
+                index += runLength;
+            }
+            copiedBytes.fetch_add(copied, std::memory_order_relaxed);
+            convertedBytes.fetch_add(converted, std::memory_order_relaxed);
+        });
+        statistics.copiedBytes += copiedBytes.load();
+        statistics.convertedBytes += convertedBytes.load();
+        statistics.writeTime += millisecondsSince(tStart);
+    }
+
+    void GltfLoader::clear()
+    {
+        primitives = {};
+        sources = {};
+        file.close();
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        statistics = {};
+    }
+}
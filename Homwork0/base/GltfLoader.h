@@ -0,0 +1,136 @@
+/*
+* Memory mapped glTF 2.0 binary (GLB) mesh loader
+*
+* The file is mapped and only its JSON chunk is parsed, vertex and index data is read in place from the mapped BIN chunk.
+* All triangle primitives of the default scene are merged into one vertex and one index range (one primitive per mesh
+* instance, indices stay relative to the primitive's first vertex), which are written straight into the destination
+* (e.g. the staging ring of the upload manager):
+* - Data whose layout already matches the destination is copied as is, tightly packed buffer views with a single memcpy
+* - Everything else (e.g. 16 bit indices, integer colors, node transforms, packed vertex formats) is converted element by element while writing
+* There are no intermediate copies of the BIN chunk
+*
+* Supported are positions, normals, vertex colors (COLOR_0) and indices of triangle list primitives, with node transforms
+* applied. External buffers, sparse accessors and other primitive modes are not supported
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+#include "TaskScheduler.h"
+#include "VertexFormat.h"
+
+namespace vks
+{
+    class GltfLoader
+    {
+    public:
+        /** @brief Range of a primitive in the merged vertex and index data, indices are relative to vertexOffset */
+        struct Primitive
+        {
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+            int32_t vertexOffset = 0;
+            uint32_t vertexCount = 0;
+        };
+
+        /** @brief Sizes and timings of the last load, times are in milliseconds */
+        struct Statistics
+        {
+            uint64_t fileSize = 0;
+            uint64_t jsonSize = 0;
+            uint64_t binSize = 0;
+            uint32_t meshCount = 0;
+            uint32_t primitiveCount = 0;
+            uint32_t vertexCount = 0;
+            uint32_t indexCount = 0;
+            // Bytes written to the destination as they are stored in the file (memcpy) and bytes that had to be converted
+            uint64_t copiedBytes = 0;
+            uint64_t convertedBytes = 0;
+            double mapTime = 0.0;
+            double parseTime = 0.0;
+            double writeTime = 0.0;
+
+            double getTotalTime() const { return mapTime + parseTime + writeTime; }
+        };
+
+        GltfLoader() = default;
+        GltfLoader(const GltfLoader&) = delete;
+        GltfLoader& operator=(const GltfLoader&) = delete;
+
+        /**
+        * Load a GLB file and parse its JSON chunk, releases any previously loaded file
+        * The file stays mapped until clear is called (or the loader is destroyed), as the data is read from it by writeVertices and writeIndices
+        *
+        * @param filename Path of the GLB file
+        * @param scheduler Task scheduler used by writeVertices and writeIndices
+        *
+        * @return False if the file could not be opened, is malformed or uses unsupported features (the reason is written to std::cerr)
+        */
+        bool load(const std::string& filename, TaskScheduler& scheduler);
+
+        /**
+        * Write a range of the merged vertices in the given vertex format, in parallel
+        * Colors are taken from COLOR_0 if a primitive has it, otherwise they visualize the normals (or are white without normals)
+        */
+        void writeVertices(void* dst, uint32_t firstVertex, uint32_t vertexCount, const VertexFormat& format);
+
+        /* Write a range of the merged indices as 32 bit indices, in parallel */
+        void writeIndices(void* dst, uint32_t firstIndex, uint32_t indexCount);
+
+        uint32_t getVertexCount() const { return statistics.vertexCount; }
+        uint32_t getIndexCount() const { return statistics.indexCount; }
+        const std::vector<Primitive>& getPrimitives() const { return primitives; }
+        /** @brief Bounding box of all primitives (in scene space), from the accessor bounds */
+        glm::vec3 getBoundsMin() const { return boundsMin; }
+        glm::vec3 getBoundsMax() const { return boundsMax; }
+        const Statistics& getStatistics() const { return statistics; }
+
+        /* Release all data and unmap the file */
+        void clear();
+
+    private:
+        // Accessor data resolved to a location in the mapped BIN chunk (data is nullptr for accessors without buffer view, which are all zeros)
+        struct Accessor
+        {
+            const uint8_t* data{ nullptr };
+            uint32_t count{ 0 };
+            uint32_t stride{ 0 };
+            uint32_t componentType{ 0 };
+            uint32_t componentCount{ 0 };
+            bool normalized{ false };
+        };
+
+        // Where a merged primitive's data is read from
+        struct Source
+        {
+            Accessor position;
+            Accessor normal;
+            Accessor color;
+            Accessor indices;
+            bool hasNormals{ false };
+            bool hasColors{ false };
+            bool hasIndices{ false };
+            // Scene space transform of the mesh instance
+            glm::mat4 transform{ 1.0f };
+            bool identity{ true };
+        };
+
+        TaskScheduler* scheduler{ nullptr };
+        MappedFile file;
+        std::vector<Primitive> primitives;
+        std::vector<Source> sources;
+        glm::vec3 boundsMin{ 0.0f };
+        glm::vec3 boundsMax{ 0.0f };
+        Statistics statistics{};
+    };
+}
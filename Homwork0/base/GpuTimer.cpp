@@ -0,0 +1,115 @@
+/*
+* GPU timer based on timestamp queries
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "GpuTimer.h"
+
+namespace vks
+{
+    void GpuTimer::create(vks::VulkanDevice* vulkanDevice, uint32_t frameCount)
+    {
+        device = vulkanDevice->logicalDevice;
+
+        // Timestamps are only supported if the queue family reports valid bits for them
+        const uint32_t validBits = vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.graphics].timestampValidBits;
+        supported = (validBits > 0) && (vulkanDevice->properties.limits.timestampPeriod > 0.0f);
+        if (!supported) {
+            std::cerr << "GPU timestamps are not supported on the graphics queue, GPU frame times will not be available\n";
+            return;
+        }
+
+        timestampPeriod = vulkanDevice->properties.limits.timestampPeriod;
+        timestampMask = (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1ull);
+        pending.assign(frameCount, false);
+
+        vk::QueryPoolCreateInfo queryPoolCI{};
+        queryPoolCI.queryType = vk::QueryType::eTimestamp;
+        queryPoolCI.queryCount = frameCount * TimestampCount;
+        VK_CHECK_RESULT(device.createQueryPool(&queryPoolCI, nullptr, &queryPool));
+    }
+
+    void GpuTimer::destroy()
+    {
+        if (queryPool) {
+            device.destroyQueryPool(queryPool);
+            queryPool = nullptr;
+        }
+    }
+
+    void GpuTimer::beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        if (!supported) {
+            return;
+        }
+        // Queries need to be reset before they can be written again, this has to happen outside of a render pass
+        commandBuffer.resetQueryPool(queryPool, frameIndex * TimestampCount, TimestampCount);
+        writeTimestamp(commandBuffer, vk::PipelineStageFlagBits::eTopOfPipe, frameIndex, FrameBegin);
+        pending[frameIndex] = true;
+    }
+
+    void GpuTimer::replayFrame(uint32_t frameIndex)
+    {
+        if (supported) {
+            pending[frameIndex] = true;
+        }
+    }
+
+    void GpuTimer::beginRenderPass(vk::CommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        writeTimestamp(commandBuffer, vk::PipelineStageFlagBits::eTopOfPipe, frameIndex, RenderPassBegin);
+    }
+
+    void GpuTimer::endRenderPass(vk::CommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        writeTimestamp(commandBuffer, vk::PipelineStageFlagBits::eBottomOfPipe, frameIndex, RenderPassEnd);
+    }
+
+    void GpuTimer::endFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        writeTimestamp(commandBuffer, vk::PipelineStageFlagBits::eBottomOfPipe, frameIndex, FrameEnd);
+    }
+
+    bool GpuTimer::collect(uint32_t frameIndex)
+    {
+        if (!supported || !pending[frameIndex]) {
+            return false;
+        }
+
+        // Each query returns its value followed by its availability, so results are never waited for
+        std::array<uint64_t, TimestampCount * 2> results{};
+        vk::Result result = device.getQueryPoolResults(queryPool, frameIndex * TimestampCount, TimestampCount, sizeof(results), results.data(), sizeof(uint64_t) * 2, vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+        if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+            VK_CHECK_RESULT(result);
+            return false;
+        }
+
+        for (uint32_t i = 0; i < TimestampCount; ++i) {
+            if (results[i * 2 + 1] == 0) {
+                // Not all timestamps are available (yet), keep the slot pending
+                return false;
+            }
+        }
+
+        pending[frameIndex] = false;
+        frameTime = toMilliseconds(results[FrameBegin * 2], results[FrameEnd * 2]);
+        renderPassTime = toMilliseconds(results[RenderPassBegin * 2], results[RenderPassEnd * 2]);
+        return true;
+    }
+
+    void GpuTimer::writeTimestamp(vk::CommandBuffer commandBuffer, vk::PipelineStageFlagBits stage, uint32_t frameIndex, Timestamp timestamp)
+    {
+        if (!supported) {
+            return;
+        }
+        commandBuffer.writeTimestamp(stage, queryPool, frameIndex * TimestampCount + timestamp);
+    }
+
+    float GpuTimer::toMilliseconds(uint64_t begin, uint64_t end) const
+    {
+        // Only the valid bits of a timestamp are meaningful, masking the difference also handles wrap-around
+        const uint64_t ticks = (end - begin) & timestampMask;
+        return (float)((double)ticks * (double)timestampPeriod / 1000000.0);
+    }
+}
@@ -0,0 +1,96 @@
+/*
+* GPU timer based on timestamp queries
+*
+* Every frame slot owns a fixed range of timestamp queries in a shared query pool. Results of a slot are read back
+* once the slot's fence has signaled (i.e. when the slot is reused frames later), so reading never waits on the GPU
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "VulkanTools.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+    class GpuTimer
+    {
+    public:
+        /** @brief Timestamps written per frame */
+        enum Timestamp : uint32_t
+        {
+            FrameBegin = 0,
+            RenderPassBegin,
+            RenderPassEnd,
+            FrameEnd,
+            TimestampCount
+        };
+
+        /**
+        * Create the query pool
+        *
+        * @param vulkanDevice Device to create the queries on, timestamps are written on the graphics queue
+        * @param frameCount Number of frame slots (frames that can be in flight at once)
+        */
+        void create(vks::VulkanDevice* vulkanDevice, uint32_t frameCount);
+
+        /* Free the query pool */
+        void destroy();
+
+        /** @brief Returns true if the graphics queue supports timestamps */
+        bool isSupported() const { return supported; }
+
+        /** @brief Resets the queries of the frame slot and writes the frame begin timestamp, must be called right after beginning the command buffer */
+        void beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+        /** @brief Marks the timestamps of the frame slot as written when submitting a prerecorded command buffer that contains the timer commands */
+        void replayFrame(uint32_t frameIndex);
+
+        /** @brief Writes the timestamp before the render pass begins */
+        void beginRenderPass(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+        /** @brief Writes the timestamp after the render pass has ended */
+        void endRenderPass(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+        /** @brief Writes the frame end timestamp, must be called right before ending the command buffer */
+        void endFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+        /**
+        * Read back the timestamps of the last submission that used the given frame slot
+        *
+        * @param frameIndex Frame slot to read, the fence of that slot must have signaled
+        *
+        * @note Does not wait for results, returns false if no results were available (e.g. the slot has not been used yet)
+        *
+        * @return True if new GPU times have been read
+        */
+        bool collect(uint32_t frameIndex);
+
+        /** @brief GPU time in milliseconds between frame begin and frame end of the last collected frame */
+        float getFrameTime() const { return frameTime; }
+
+        /** @brief GPU time in milliseconds spent in the render pass of the last collected frame */
+        float getRenderPassTime() const { return renderPassTime; }
+
+    private:
+        vk::Device device{ nullptr };
+        vk::QueryPool queryPool{ nullptr };
+        bool supported = false;
+        // Nanoseconds per timestamp tick
+        float timestampPeriod = 1.0f;
+        // Mask of the valid timestamp bits of the graphics queue family
+        uint64_t timestampMask = ~0ull;
+        // Set for slots that had timestamps written since they were last collected
+        std::vector<bool> pending;
+
+        float frameTime = 0.0f;
+        float renderPassTime = 0.0f;
+
+        void writeTimestamp(vk::CommandBuffer commandBuffer, vk::PipelineStageFlagBits stage, uint32_t frameIndex, Timestamp timestamp);
+        float toMilliseconds(uint64_t begin, uint64_t end) const;
+    };
+}
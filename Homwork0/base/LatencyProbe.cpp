@@ -0,0 +1,71 @@
+/*
+* CPU-to-completion frame latency probe
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "LatencyProbe.h"
+
+namespace vks
+{
+    void LatencyProbe::create(vk::Device device, uint32_t frameCount)
+    {
+        this->device = device;
+        slots.assign(frameCount, Slot{});
+    }
+
+    void LatencyProbe::frameStarted(uint32_t frameIndex)
+    {
+        slots[frameIndex].started = Clock::now();
+        slots[frameIndex].hasPresented = false;
+        slots[frameIndex].pending = false;
+    }
+
+    void LatencyProbe::frameSubmitted(uint32_t frameIndex, vk::Fence fence)
+    {
+        slots[frameIndex].submitted = Clock::now();
+        slots[frameIndex].fence = fence;
+        slots[frameIndex].timeline = nullptr;
+        slots[frameIndex].pending = true;
+    }
+
+    void LatencyProbe::frameSubmitted(uint32_t frameIndex, vk::Semaphore timeline, uint64_t value)
+    {
+        slots[frameIndex].submitted = Clock::now();
+        slots[frameIndex].fence = nullptr;
+        slots[frameIndex].timeline = timeline;
+        slots[frameIndex].timelineValue = value;
+        slots[frameIndex].pending = true;
+    }
+
+    void LatencyProbe::framePresented(uint32_t frameIndex)
+    {
+        slots[frameIndex].presented = Clock::now();
+        slots[frameIndex].hasPresented = true;
+    }
+
+    bool LatencyProbe::collect(uint32_t frameIndex)
+    {
+        Slot& slot = slots[frameIndex];
+        if (!slot.pending) {
+            return false;
+        }
+        if (slot.timeline) {
+            uint64_t value = 0;
+            VK_CHECK_RESULT(device.getSemaphoreCounterValue(slot.timeline, &value));
+            if (value < slot.timelineValue) {
+                return false;
+            }
+        }
+        else if (device.getFenceStatus(slot.fence) != vk::Result::eSuccess) {
+            return false;
+        }
+        using Milliseconds = std::chrono::duration<float, std::milli>;
+        sample.completion = Milliseconds(Clock::now() - slot.started).count();
+        sample.submit = Milliseconds(slot.submitted - slot.started).count();
+        sample.presented = slot.hasPresented;
+        sample.present = slot.hasPresented ? Milliseconds(slot.presented - slot.started).count() : 0.0f;
+        slot.pending = false;
+        return true;
+    }
+}
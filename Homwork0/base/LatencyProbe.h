@@ -0,0 +1,86 @@
+/*
+* CPU-to-completion frame latency probe
+*
+* Stamps the time the CPU starts building a frame (which is when input is sampled), the time it is submitted, the time
+* the present call returns and the time the frame's fence (or timeline semaphore value) is first observed as signaled.
+* All frames in flight are polled without blocking, so the measured latency includes the time a frame waits in the queue
+* behind the other frames in flight, which is what trading throughput against latency changes. How long present blocks
+* (and thus the input-to-present latency) depends on the present mode and the number of swapchain images
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+    class LatencyProbe
+    {
+    public:
+        /** @brief Latencies in milliseconds of a frame, measured from the start of the frame */
+        struct Sample
+        {
+            float submit = 0.0f;
+            /** @brief Time until the present call returned, only valid if presented is true (not the case in headless mode) */
+            float present = 0.0f;
+            float completion = 0.0f;
+            bool presented = false;
+        };
+
+        /**
+        * Set up the per-slot timestamps
+        *
+        * @param device Device the frame fences belong to
+        * @param frameCount Number of frame slots (frames that can be in flight at once)
+        */
+        void create(vk::Device device, uint32_t frameCount);
+
+        /** @brief Stamps the start of the frame in the given slot, call once the slot's previous frame has finished and the CPU starts working on the new one */
+        void frameStarted(uint32_t frameIndex);
+
+        /** @brief Marks the frame in the given slot as submitted, its fence is polled from now on */
+        void frameSubmitted(uint32_t frameIndex, vk::Fence fence);
+
+        /** @brief Marks the frame in the given slot as submitted, the frame has finished once the timeline semaphore reaches the given value */
+        void frameSubmitted(uint32_t frameIndex, vk::Semaphore timeline, uint64_t value);
+
+        /** @brief Stamps the return of the present call for the frame in the given slot, call after frameSubmitted */
+        void framePresented(uint32_t frameIndex);
+
+        /**
+        * Check if the submitted frame in the given slot has finished
+        *
+        * @note Never waits, returns false if the slot has no submitted frame or its fence has not signaled yet
+        *
+        * @return True if the frame has finished since the last call, its latencies are then available via getSample
+        */
+        bool collect(uint32_t frameIndex);
+
+        /** @brief Latencies of the last collected frame */
+        const Sample& getSample() const { return sample; }
+
+    private:
+        using Clock = std::chrono::high_resolution_clock;
+
+        struct Slot
+        {
+            Clock::time_point started;
+            Clock::time_point submitted;
+            Clock::time_point presented;
+            bool hasPresented = false;
+            vk::Fence fence{ nullptr };
+            vk::Semaphore timeline{ nullptr };
+            uint64_t timelineValue = 0;
+            bool pending = false;
+        };
+
+        vk::Device device{ nullptr };
+        std::vector<Slot> slots;
+        Sample sample;
+    };
+}
@@ -0,0 +1,103 @@
+/*
+* Read-only memory mapped file
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vks
+{
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const std::string& filename)
+    {
+        close();
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            return false;
+        }
+        fileHandle = file;
+        fileSize = static_cast<uint64_t>(size.QuadPart);
+        // Files of size 0 can't be mapped
+        if (fileSize > 0) {
+            mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mappingHandle) {
+                mapped = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            }
+            if (!mapped) {
+                close();
+                return false;
+            }
+        }
+#else
+        const int file = ::open(filename.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+        struct stat fileStat {};
+        if (fstat(file, &fileStat) != 0) {
+            ::close(file);
+            return false;
+        }
+        fileSize = static_cast<uint64_t>(fileStat.st_size);
+        // The mapping stays valid after the descriptor has been closed
+        if (fileSize > 0) {
+            void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+            if (view == MAP_FAILED) {
+                ::close(file);
+                fileSize = 0;
+                return false;
+            }
+            // Loaders parse the file front to back
+            madvise(view, fileSize, MADV_SEQUENTIAL);
+            mapped = static_cast<const uint8_t*>(view);
+        }
+        ::close(file);
+#endif
+        opened = true;
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+#if defined(_WIN32)
+        if (mapped) {
+            UnmapViewOfFile(mapped);
+        }
+        if (mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+        if (fileHandle) {
+            CloseHandle(fileHandle);
+        }
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        if (mapped) {
+            munmap(const_cast<uint8_t*>(mapped), fileSize);
+        }
+#endif
+        mapped = nullptr;
+        fileSize = 0;
+        opened = false;
+    }
+}
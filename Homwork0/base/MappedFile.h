@@ -0,0 +1,51 @@
+/*
+* Read-only memory mapped file
+*
+* Maps a whole file into the address space, so loaders can parse it in place (and from multiple threads) without reading
+* it into an intermediate buffer first. Pages are loaded by the operating system on first access
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace vks
+{
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+        * Map a file, replacing any previously mapped file
+        *
+        * @return False if the file could not be opened or mapped
+        *
+        * @note Empty files are opened successfully but have no data
+        */
+        bool open(const std::string& filename);
+
+        /* Unmap the file, all pointers into it become invalid */
+        void close();
+
+        const uint8_t* data() const { return mapped; }
+        uint64_t size() const { return fileSize; }
+        bool isOpen() const { return opened; }
+
+    private:
+        const uint8_t* mapped{ nullptr };
+        uint64_t fileSize{ 0 };
+        bool opened{ false };
+#if defined(_WIN32)
+        void* fileHandle{ nullptr };
+        void* mappingHandle{ nullptr };
+#endif
+    };
+}
@@ -0,0 +1,529 @@
+/*
+* Memory mapped Wavefront OBJ mesh loader
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "MappedFile.h"
+#include "Profiler.h"
+
+namespace vks
+{
+    namespace
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        double millisecondsSince(Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // Chunks are at least this large, so small files are parsed by a single task
+        constexpr uint64_t minChunkSize = 1024 * 1024;
+        constexpr int32_t noNormal = std::numeric_limits<int32_t>::min();
+
+        // Face corner as written in the file, relative (negative) indices are stored relative to the start of the chunk and resolved once
+        // the number of elements in all previous chunks is known
+        struct Corner
+        {
+            int32_t position;
+            int32_t normal;
+            bool positionRelative;
+            bool normalRelative;
+        };
+
+        struct Chunk
+        {
+            const char* begin{ nullptr };
+            const char* end{ nullptr };
+            std::vector<float> positions;
+            std::vector<float> colors;
+            std::vector<float> normals;
+            std::vector<Corner> corners;
+            glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+            glm::vec3 boundsMax{ -std::numeric_limits<float>::max() };
+            // Number of elements in all previous chunks
+            uint32_t positionOffset{ 0 };
+            uint32_t normalOffset{ 0 };
+            // Line (within the chunk) of the first error, 0 if there was none
+            uint32_t errorLine{ 0 };
+        };
+
+        inline bool isSpace(char c)
+        {
+            return (c == ' ') || (c == '\t');
+        }
+
+        inline const char* skipSpaces(const char* p, const char* end)
+        {
+            while ((p < end) && isSpace(*p)) {
+                p++;
+            }
+            return p;
+        }
+
+        inline const char* skipLine(const char* p, const char* end)
+        {
+            const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+            return newline ? newline + 1 : end;
+        }
+
+        // Exact powers of ten, larger exponents fall back to std::pow
+        constexpr double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        // Parses a decimal floating point number with optional sign, fraction and exponent, returns nullptr if there is no number
+        // Digits are accumulated in an integer and scaled once, which is exact for the up to 9 significant digits OBJ exporters usually write
+        const char* parseFloat(const char* p, const char* end, float& value)
+        {
+            p = skipSpaces(p, end);
+            bool negative = false;
+            if ((p < end) && ((*p == '-') || (*p == '+'))) {
+                negative = (*p == '-');
+                p++;
+            }
+            uint64_t mantissa = 0;
+            int32_t exponent = 0;
+            bool hasDigits = false;
+            while ((p < end) && (*p >= '0') && (*p <= '9')) {
+                if (mantissa < 100000000000000000ull) {
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                }
+                else {
+                    exponent++;
+                }
+                hasDigits = true;
+                p++;
+            }
+            if ((p < end) && (*p == '.')) {
+                p++;
+                while ((p < end) && (*p >= '0') && (*p <= '9')) {
+                    if (mantissa < 100000000000000000ull) {
+                        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                        exponent--;
+                    }
+                    hasDigits = true;
+                    p++;
+                }
+            }
+            if (!hasDigits) {
+                return nullptr;
+            }
+            if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+                const char* exponentStart = p++;
+                bool negativeExponent = false;
+                if ((p < end) && ((*p == '-') || (*p == '+'))) {
+                    negativeExponent = (*p == '-');
+                    p++;
+                }
+                if ((p < end) && (*p >= '0') && (*p <= '9')) {
+                    int32_t explicitExponent = 0;
+                    while ((p < end) && (*p >= '0') && (*p <= '9')) {
+                        explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 10000);
+                        p++;
+                    }
+                    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                }
+                else {
+                    // Not an exponent (e.g. a following token), leave it unparsed
+                    p = exponentStart;
+                }
+            }
+            double result = static_cast<double>(mantissa);
+            if (exponent < 0) {
+                result = (exponent >= -22) ? result / powersOfTen[-exponent] : result * std::pow(10.0, exponent);
+            }
+            else if (exponent > 0) {
+                result = (exponent <= 22) ? result * powersOfTen[exponent] : result * std::pow(10.0, exponent);
+            }
+            value = static_cast<float>(negative ? -result : result);
+            return p;
+        }
+
+        // Parses a (possibly negative) integer, returns nullptr if there is none
+        const char* parseInt(const char* p, const char* end, int32_t& value)
+        {
+            bool negative = false;
+            if ((p < end) && ((*p == '-') || (*p == '+'))) {
+                negative = (*p == '-');
+                p++;
+            }
+            if ((p >= end) || (*p < '0') || (*p > '9')) {
+                return nullptr;
+            }
+            int64_t result = 0;
+            while ((p < end) && (*p >= '0') && (*p <= '9')) {
+                result = std::min<int64_t>(result * 10 + (*p - '0'), std::numeric_limits<int32_t>::max());
+                p++;
+            }
+            value = static_cast<int32_t>(negative ? -result : result);
+            return p;
+        }
+
+        // Parses a face vertex (v, v/vt, v//vn or v/vt/vn), OBJ indices start at 1 and negative indices count back from the last element
+        const char* parseCorner(const char* p, const char* end, const Chunk& chunk, Corner& corner)
+        {
+            int32_t position = 0;
+            p = parseInt(p, end, position);
+            if (!p || (position == 0)) {
+                return nullptr;
+            }
+            corner.positionRelative = position < 0;
+            corner.position = (position < 0) ? static_cast<int32_t>(chunk.positions.size() / 3) + position : position - 1;
+            corner.normal = noNormal;
+            corner.normalRelative = false;
+            if ((p < end) && (*p == '/')) {
+                p++;
+                // Texture coordinate, skipped
+                int32_t texCoord = 0;
+                const char* next = parseInt(p, end, texCoord);
+                if (next) {
+                    p = next;
+                }
+                if ((p < end) && (*p == '/')) {
+                    p++;
+                    int32_t normal = 0;
+                    p = parseInt(p, end, normal);
+                    if (!p || (normal == 0)) {
+                        return nullptr;
+                    }
+                    corner.normalRelative = normal < 0;
+                    corner.normal = (normal < 0) ? static_cast<int32_t>(chunk.normals.size() / 3) + normal : normal - 1;
+                }
+            }
+            return p;
+        }
+
+        void parseChunk(Chunk& chunk)
+        {
+            const char* p = chunk.begin;
+            const char* end = chunk.end;
+            uint32_t line = 0;
+            Corner face[3]{};
+            while (p < end) {
+                line++;
+                p = skipSpaces(p, end);
+                if ((p + 1 < end) && (p[0] == 'v') && isSpace(p[1])) {
+                    float values[6]{};
+                    uint32_t valueCount = 0;
+                    const char* next = p + 1;
+                    while (valueCount < 6) {
+                        const char* parsed = parseFloat(next, end, values[valueCount]);
+                        if (!parsed) {
+                            break;
+                        }
+                        next = parsed;
+                        valueCount++;
+                    }
+                    if (valueCount < 3) {
+                        chunk.errorLine = chunk.errorLine ? chunk.errorLine : line;
+                    }
+                    const glm::vec3 position(values[0], values[1], values[2]);
+                    chunk.positions.insert(chunk.positions.end(), { position.x, position.y, position.z });
+                    chunk.boundsMin = glm::min(chunk.boundsMin, position);
+                    chunk.boundsMax = glm::max(chunk.boundsMax, position);
+                    // Vertex colors are an extension written as three additional values, positions before the first colored one are white
+                    if (valueCount == 6) {
+                        chunk.colors.resize(chunk.positions.size() - 3, 1.0f);
+                        chunk.colors.insert(chunk.colors.end(), { values[3], values[4], values[5] });
+                    }
+                    else if (!chunk.colors.empty()) {
+                        chunk.colors.insert(chunk.colors.end(), { 1.0f, 1.0f, 1.0f });
+                    }
+                }
+                else if ((p + 2 < end) && (p[0] == 'v') && (p[1] == 'n') && isSpace(p[2])) {
+                    float values[3]{};
+                    const char* next = p + 2;
+                    for (uint32_t i = 0; (i < 3) && next; ++i) {
+                        next = parseFloat(next, end, values[i]);
+                    }
+                    if (!next) {
+                        chunk.errorLine = chunk.errorLine ? chunk.errorLine : line;
+                    }
+                    chunk.normals.insert(chunk.normals.end(), { values[0], values[1], values[2] });
+                }
+                else if ((p + 1 < end) && (p[0] == 'f') && isSpace(p[1])) {
+                    // Polygons are triangulated as fans around their first vertex
+                    const char* next = p + 1;
+                    uint32_t cornerCount = 0;
+                    for (;;) {
+                        next = skipSpaces(next, end);
+                        if ((next >= end) || (*next == '\r') || (*next == '\n') || (*next == '#')) {
+                            break;
+                        }
+                        Corner corner{};
+                        next = parseCorner(next, end, chunk, corner);
+                        if (!next) {
+                            chunk.errorLine = chunk.errorLine ? chunk.errorLine : line;
+                            break;
+                        }
+                        face[std::min(cornerCount, 2u)] = corner;
+                        cornerCount++;
+                        if (cornerCount >= 3) {
+                            chunk.corners.insert(chunk.corners.end(), { face[0], face[1], face[2] });
+                            face[1] = face[2];
+                        }
+                    }
+                }
+                p = skipLine(p, end);
+            }
+        }
+
+        // Open addressing hash table mapping vertex keys to vertex indices, grown at a load factor of 1/2
+        class VertexTable
+        {
+        public:
+            explicit VertexTable(size_t expectedCount)
+            {
+                size_t capacity = 1024;
+                while (capacity < expectedCount * 2) {
+                    capacity *= 2;
+                }
+                resize(capacity);
+            }
+
+            // Returns the index of the key, inserting it with the given index if it's not in the table yet
+            uint32_t insert(uint64_t key, uint32_t index)
+            {
+                if ((count + 1) * 2 > keys.size()) {
+                    resize(keys.size() * 2);
+                }
+                size_t slot = hash(key);
+                while (keys[slot] != emptyKey) {
+                    if (keys[slot] == key) {
+                        return values[slot];
+                    }
+                    slot = (slot + 1) & mask;
+                }
+                keys[slot] = key;
+                values[slot] = index;
+                count++;
+                return index;
+            }
+
+        private:
+            // Keys are never all ones, as position indices are below 2^31
+            static constexpr uint64_t emptyKey = ~0ull;
+            std::vector<uint64_t> keys;
+            std::vector<uint32_t> values;
+            size_t mask = 0;
+            size_t count = 0;
+
+            size_t hash(uint64_t key) const
+            {
+                key ^= key >> 33;
+                key *= 0xFF51AFD7ED558CCDull;
+                key ^= key >> 33;
+                return static_cast<size_t>(key) & mask;
+            }
+
+            void resize(size_t capacity)
+            {
+                std::vector<uint64_t> oldKeys(capacity, emptyKey);
+                std::vector<uint32_t> oldValues(capacity);
+                oldKeys.swap(keys);
+                oldValues.swap(values);
+                mask = capacity - 1;
+                for (size_t i = 0; i < oldKeys.size(); ++i) {
+                    if (oldKeys[i] != emptyKey) {
+                        size_t slot = hash(oldKeys[i]);
+                        while (keys[slot] != emptyKey) {
+                            slot = (slot + 1) & mask;
+                        }
+                        keys[slot] = oldKeys[i];
+                        values[slot] = oldValues[i];
+                    }
+                }
+            }
+        };
+    }
+
+    bool ObjLoader::load(const std::string& filename, TaskScheduler& scheduler)
+    {
+        PROFILE_FUNCTION();
+        clear();
+        this->scheduler = &scheduler;
+
+        auto tStart = Clock::now();
+        MappedFile file;
+        if (!file.open(filename)) {
+            std::cerr << "Could not open OBJ file \"" << filename << "\"\n";
+            return false;
+        }
+        statistics.fileSize = file.size();
+        statistics.mapTime = millisecondsSince(tStart);
+
+        // Split the file into chunks ending at line breaks, a few per thread so threads finishing early can steal the remaining ones
+        tStart = Clock::now();
+        const char* fileBegin = reinterpret_cast<const char*>(file.data());
+        const char* fileEnd = fileBegin + file.size();
+        const uint64_t chunkSize = std::max<uint64_t>(minChunkSize, file.size() / (scheduler.getThreadCount() * 4ull));
+        std::vector<Chunk> chunks;
+        for (const char* begin = fileBegin; begin < fileEnd;) {
+            const char* end = (uint64_t)(fileEnd - begin) > chunkSize ? skipLine(begin + chunkSize, fileEnd) : fileEnd;
+            chunks.emplace_back();
+            chunks.back().begin = begin;
+            chunks.back().end = end;
+            begin = end;
+        }
+        statistics.chunkCount = static_cast<uint32_t>(chunks.size());
+
+        scheduler.parallelFor(statistics.chunkCount, 1, [&chunks](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                parseChunk(chunks[i]);
+            }
+        });
+
+        // Elements are numbered across the whole file, so every chunk's indices are offset by the number of elements in all chunks before it
+        bool hasColors = false;
+        uint64_t positionCount = 0;
+        uint64_t normalCount = 0;
+        uint64_t cornerCount = 0;
+        boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        for (auto& chunk : chunks) {
+            if (chunk.errorLine > 0) {
+                // Line numbers are only known within the chunk, count the lines before it for the error message
+                const uint64_t line = std::count(fileBegin, chunk.begin, '\n') + chunk.errorLine;
+                std::cerr << "Malformed OBJ file \"" << filename << "\" in line " << line << "\n";
+                clear();
+                return false;
+            }
+            chunk.positionOffset = static_cast<uint32_t>(positionCount);
+            chunk.normalOffset = static_cast<uint32_t>(normalCount);
+            positionCount += chunk.positions.size() / 3;
+            normalCount += chunk.normals.size() / 3;
+            cornerCount += chunk.corners.size();
+            hasColors |= !chunk.colors.empty();
+            boundsMin = glm::min(boundsMin, chunk.boundsMin);
+            boundsMax = glm::max(boundsMax, chunk.boundsMax);
+        }
+        if ((positionCount == 0) || (cornerCount == 0)) {
+            std::cerr << "OBJ file \"" << filename << "\" contains no faces\n";
+            clear();
+            return false;
+        }
+        if ((positionCount >= (1ull << 31)) || (cornerCount > std::numeric_limits<uint32_t>::max())) {
+            std::cerr << "OBJ file \"" << filename << "\" is too large\n";
+            clear();
+            return false;
+        }
+
+        // Merge the attributes and resolve relative indices, chunks are independent of each other now
+        positions.resize(positionCount * 3);
+        normals.resize(normalCount * 3);
+        if (hasColors) {
+            colors.resize(positionCount * 3, 1.0f);
+        }
+        std::vector<uint32_t> invalidCorners(chunks.size(), 0);
+        scheduler.parallelFor(statistics.chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                Chunk& chunk = chunks[i];
+                std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionOffset * 3ull);
+                std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalOffset * 3ull);
+                if (!chunk.colors.empty()) {
+                    std::copy(chunk.colors.begin(), chunk.colors.end(), colors.begin() + chunk.positionOffset * 3ull);
+                }
+                for (auto& corner : chunk.corners) {
+                    if (corner.positionRelative) {
+                        corner.position += static_cast<int32_t>(chunk.positionOffset);
+                    }
+                    if (corner.normalRelative) {
+                        corner.normal += static_cast<int32_t>(chunk.normalOffset);
+                    }
+                    if ((corner.position < 0) || ((uint64_t)corner.position >= positionCount) ||
+                        ((corner.normal != noNormal) && ((corner.normal < 0) || ((uint64_t)corner.normal >= normalCount)))) {
+                        invalidCorners[i]++;
+                    }
+                }
+                // Only the corners are needed from here on
+                chunk.positions = {};
+                chunk.normals = {};
+                chunk.colors = {};
+            }
+        });
+        if (std::any_of(invalidCorners.begin(), invalidCorners.end(), [](uint32_t count) { return count > 0; })) {
+            std::cerr << "OBJ file \"" << filename << "\" references vertices that don't exist\n";
+            clear();
+            return false;
+        }
+        statistics.parseTime = millisecondsSince(tStart);
+
+        // Deduplicate vertices, every unique position and normal pair becomes one vertex
+        tStart = Clock::now();
+        indices.resize(cornerCount);
+        vertexKeys.reserve(positionCount);
+        VertexTable table(positionCount);
+        size_t cornerIndex = 0;
+        for (const auto& chunk : chunks) {
+            for (const auto& corner : chunk.corners) {
+                const uint64_t key = ((uint64_t)corner.position << 32) | (uint32_t)((corner.normal == noNormal) ? 0 : corner.normal + 1);
+                const uint32_t vertexIndex = table.insert(key, static_cast<uint32_t>(vertexKeys.size()));
+                if (vertexIndex == vertexKeys.size()) {
+                    vertexKeys.push_back(key);
+                }
+                indices[cornerIndex++] = vertexIndex;
+            }
+        }
+        statistics.dedupTime = millisecondsSince(tStart);
+
+        statistics.positionCount = static_cast<uint32_t>(positionCount);
+        statistics.normalCount = static_cast<uint32_t>(normalCount);
+        statistics.vertexCount = static_cast<uint32_t>(vertexKeys.size());
+        statistics.triangleCount = static_cast<uint32_t>(cornerCount / 3);
+        return true;
+    }
+
+    void ObjLoader::writeVertices(void* dst, uint32_t firstVertex, uint32_t vertexCount, const VertexFormat& format)
+    {
+        PROFILE_FUNCTION();
+        assert(scheduler);
+        assert(firstVertex + vertexCount <= vertexKeys.size());
+        auto tStart = Clock::now();
+        uint8_t* destination = static_cast<uint8_t*>(dst);
+        scheduler->parallelFor(vertexCount, 16384, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                const uint64_t key = vertexKeys[firstVertex + i];
+                const size_t position = (size_t)(key >> 32) * 3;
+                const uint32_t normalIndex = (uint32_t)key;
+                glm::vec3 normal(0.0f);
+                if (normalIndex > 0) {
+                    const size_t n = (size_t)(normalIndex - 1) * 3;
+                    normal = glm::vec3(normals[n], normals[n + 1], normals[n + 2]);
+                }
+                glm::vec3 color(1.0f);
+                if (!colors.empty()) {
+                    color = glm::vec3(colors[position], colors[position + 1], colors[position + 2]);
+                }
+                else if (normalIndex > 0) {
+                    color = normal * 0.5f + 0.5f;
+                }
+                uint8_t* vertex = destination + (size_t)i * format.stride;
+                format.writePosition(vertex, glm::vec3(positions[position], positions[position + 1], positions[position + 2]));
+                format.writeNormal(vertex, normal);
+                format.writeColor(vertex, color);
+            }
+        });
+        statistics.writeTime += millisecondsSince(tStart);
+    }
+
+    void ObjLoader::clear()
+    {
+        positions = {};
+        colors = {};
+        normals = {};
+        vertexKeys = {};
+        indices = {};
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        statistics = {};
+    }
+}
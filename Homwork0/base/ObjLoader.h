@@ -0,0 +1,97 @@
+/*
+* Memory mapped Wavefront OBJ mesh loader
+*
+* The file is mapped and split into line aligned chunks that are parsed in parallel by the task scheduler. Faces are
+* triangulated as fans and vertices (unique position and normal pairs) are deduplicated through a hash table, so the
+* result is an indexed triangle list. Vertices are not stored in an intermediate array, they are assembled straight
+* into the destination (e.g. the staging ring of the upload manager) in the vertex format requested by the caller
+*
+* Supported are positions (with optional vertex colors), normals and faces with positive and negative (relative) indices.
+* Texture coordinates are skipped as the engine vertex layout has no use for them, materials and groups are ignored
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "TaskScheduler.h"
+#include "VertexFormat.h"
+
+namespace vks
+{
+    class ObjLoader
+    {
+    public:
+        /** @brief Sizes and timings of the last load, times are in milliseconds */
+        struct Statistics
+        {
+            uint64_t fileSize = 0;
+            uint32_t chunkCount = 0;
+            uint32_t positionCount = 0;
+            uint32_t normalCount = 0;
+            uint32_t vertexCount = 0;
+            uint32_t triangleCount = 0;
+            double mapTime = 0.0;
+            double parseTime = 0.0;
+            double dedupTime = 0.0;
+            double writeTime = 0.0;
+
+            /** @brief Parse throughput (parallel parsing and index resolving, without deduplication) in MB/s */
+            double getParseThroughput() const { return (parseTime > 0.0) ? (double)fileSize / (1024.0 * 1024.0) / (parseTime / 1000.0) : 0.0; }
+            double getTotalTime() const { return mapTime + parseTime + dedupTime + writeTime; }
+        };
+
+        /**
+        * Load and parse a mesh, releases any previously loaded mesh
+        *
+        * @param filename Path of the OBJ file
+        * @param scheduler Task scheduler chunks are parsed on, also used by writeVertices
+        *
+        * @return False if the file could not be opened or is malformed (the reason is written to std::cerr)
+        */
+        bool load(const std::string& filename, TaskScheduler& scheduler);
+
+        /**
+        * Assemble a range of the deduplicated vertices in the given vertex format, in parallel
+        * Colors are taken from the vertex colors if the file has them, otherwise they visualize the normals (or are white without normals)
+        *
+        * @param dst Destination of the first vertex in the range
+        * @param firstVertex First vertex to write
+        * @param vertexCount Number of vertices to write
+        * @param format Vertex format (layout and attribute encodings) of the destination
+        */
+        void writeVertices(void* dst, uint32_t firstVertex, uint32_t vertexCount, const VertexFormat& format);
+
+        uint32_t getVertexCount() const { return static_cast<uint32_t>(vertexKeys.size()); }
+        /** @brief Triangle list indices into the deduplicated vertices */
+        const std::vector<uint32_t>& getIndices() const { return indices; }
+        /** @brief Bounding box of all positions in the file */
+        glm::vec3 getBoundsMin() const { return boundsMin; }
+        glm::vec3 getBoundsMax() const { return boundsMax; }
+        const Statistics& getStatistics() const { return statistics; }
+
+        /* Release all parsed data */
+        void clear();
+
+    private:
+        TaskScheduler* scheduler{ nullptr };
+        // Attributes of the whole file, three floats per element
+        std::vector<float> positions;
+        std::vector<float> colors;
+        std::vector<float> normals;
+        // Unique vertices in order of first use, position index in the upper and normal index + 1 (0 = none) in the lower 32 bits
+        std::vector<uint64_t> vertexKeys;
+        std::vector<uint32_t> indices;
+        glm::vec3 boundsMin{ 0.0f };
+        glm::vec3 boundsMax{ 0.0f };
+        Statistics statistics{};
+    };
+}
@@ -0,0 +1,154 @@
+/*
+* Hierarchical CPU scope profiler
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "Profiler.h"
+
+#if defined(ENABLE_PROFILER)
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vks::profiler
+{
+    namespace
+    {
+        struct Event
+        {
+            const char* name;
+            int64_t begin;
+            int64_t end;
+        };
+
+        // Events of a single thread, only that thread writes to it
+        struct ThreadBuffer
+        {
+            uint32_t threadIndex = 0;
+            std::string name;
+            std::array<Event, eventsPerThread> events;
+            std::atomic<uint64_t> head{ 0 };
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            // Buffers are kept alive until exit, so events of threads that have already finished can still be exported
+            std::vector<std::unique_ptr<ThreadBuffer>> threads;
+            const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        };
+
+        Registry& registry()
+        {
+            static Registry instance;
+            return instance;
+        }
+
+        int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count();
+        }
+
+        ThreadBuffer& threadBuffer()
+        {
+            // Registration takes a lock, but only once per thread
+            thread_local ThreadBuffer* buffer = nullptr;
+            if (buffer == nullptr) {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.threads.push_back(std::make_unique<ThreadBuffer>());
+                buffer = reg.threads.back().get();
+                buffer->threadIndex = (uint32_t)reg.threads.size();
+                buffer->name = "Thread " + std::to_string(buffer->threadIndex);
+            }
+            return *buffer;
+        }
+
+        void writeEscaped(std::ostream& stream, const std::string& text)
+        {
+            for (char c : text) {
+                switch (c) {
+                case '"': stream << "\\\""; break;
+                case '\\': stream << "\\\\"; break;
+                case '\n': stream << "\\n"; break;
+                default:
+                    if ((unsigned char)c >= 0x20) {
+                        stream << c;
+                    }
+                }
+            }
+        }
+    }
+
+    void setThreadName(const std::string& name)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        buffer.name = name;
+    }
+
+    bool exportChromeTrace(const std::string& filename)
+    {
+        std::ofstream file(filename, std::ios::out);
+        if (!file.is_open()) {
+            std::cerr << "Profiler: Could not open \"" << filename << "\" for writing\n";
+            return false;
+        }
+
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        // Timestamps and durations in the Chrome trace format are in microseconds
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        size_t eventCount = 0;
+        for (auto& thread : reg.threads) {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->threadIndex << ",\"args\":{\"name\":\"";
+            writeEscaped(file, thread->name);
+            file << "\"}}";
+            first = false;
+
+            // Only the most recent events are available once the ring has wrapped around
+            const uint64_t head = thread->head.load(std::memory_order_acquire);
+            const uint64_t count = std::min<uint64_t>(head, eventsPerThread);
+            for (uint64_t i = head - count; i < head; ++i) {
+                const Event& event = thread->events[i % eventsPerThread];
+                file << ",\n{\"name\":\"";
+                writeEscaped(file, event.name);
+                file << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->threadIndex;
+                file << ",\"ts\":" << (double)event.begin / 1000.0 << ",\"dur\":" << (double)(event.end - event.begin) / 1000.0 << "}";
+            }
+            eventCount += (size_t)count;
+        }
+        file << "\n]}\n";
+
+        std::cout << "Profiler: Exported " << eventCount << " events to \"" << filename << "\"\n";
+        return true;
+    }
+
+    Scope::Scope(const char* name) : name(name), begin(now())
+    {
+    }
+
+    Scope::~Scope()
+    {
+        const int64_t end = now();
+        ThreadBuffer& buffer = threadBuffer();
+        // Only the owning thread advances the head, the release store publishes the event to exports from other threads
+        const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        buffer.events[head % eventsPerThread] = { name, begin, end };
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*
+* Hierarchical CPU scope profiler
+*
+* Scopes record begin/end timestamps into a per-thread ring buffer, the recorded events can be exported as a
+* Chrome trace (JSON) that can be loaded in about://tracing or Perfetto
+*
+* The profiler is only compiled in if ENABLE_PROFILER is defined, otherwise all macros expand to nothing
+* Enable it with -DENABLE_PROFILER=ON (CMake) or /p:EnableProfiler=true (MSBuild, the Visual Studio project)
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#define PROFILE_CONCAT_INNER(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if defined(ENABLE_PROFILER)
+
+#include <cstdint>
+#include <string>
+
+// Profile the enclosing scope, name must be a string literal (or otherwise outlive the profiler)
+#define PROFILE_SCOPE(name) vks::profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name) vks::profiler::setThreadName(name)
+
+namespace vks::profiler
+{
+    /** @brief Number of events kept per thread, older events are overwritten once a thread's ring is full */
+    constexpr uint32_t eventsPerThread = 65536;
+
+    /** @brief Sets the name shown for the calling thread in the trace viewer */
+    void setThreadName(const std::string& name);
+
+    /**
+    * Write all recorded events to a Chrome trace file
+    *
+    * @param filename Name of the JSON file to write
+    *
+    * @note Can be called at any time, events written by other threads while exporting may be missing from the trace
+    *
+    * @return True if the file has been written
+    */
+    bool exportChromeTrace(const std::string& filename);
+
+    /** @brief Records the time between construction and destruction as an event of the calling thread */
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        int64_t begin;
+    };
+}
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD_NAME(name)
+
+#endif
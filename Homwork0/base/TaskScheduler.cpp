@@ -0,0 +1,298 @@
+/*
+* Work-stealing task scheduler
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <string>
+
+#include "Profiler.h"
+
+namespace vks
+{
+    namespace
+    {
+        // Index of the calling thread within the scheduler it belongs to, 0 for the thread that created the scheduler
+        thread_local uint32_t currentThreadIndex = 0;
+        // Per-thread state of the xorshift generator used to pick steal victims
+        thread_local uint32_t victimSeed = 0x9E3779B9u;
+
+        uint32_t nextVictim()
+        {
+            victimSeed ^= victimSeed << 13;
+            victimSeed ^= victimSeed >> 17;
+            victimSeed ^= victimSeed << 5;
+            return victimSeed;
+        }
+    }
+
+    bool TaskScheduler::WorkStealingQueue::push(Task* task)
+    {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= capacity) {
+            return false;
+        }
+        tasks[b & (capacity - 1)].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    TaskScheduler::Task* TaskScheduler::WorkStealingQueue::pop()
+    {
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Task* task = tasks[b & (capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last task, race against thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    TaskScheduler::Task* TaskScheduler::WorkStealingQueue::steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        Task* task = tasks[t & (capacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            // Lost the race against the owner or another thief
+            return nullptr;
+        }
+        return task;
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        destroy();
+    }
+
+    void TaskScheduler::create(uint32_t workerCount)
+    {
+        assert(queues.empty());
+        mainThreadId = std::this_thread::get_id();
+        currentThreadIndex = 0;
+        stopping = false;
+        queues.resize(workerCount + 1);
+        for (auto& queue : queues) {
+            queue = std::make_unique<WorkStealingQueue>();
+        }
+        workers.reserve(workerCount);
+        for (uint32_t i = 1; i <= workerCount; i++) {
+            workers.emplace_back(&TaskScheduler::workerLoop, this, i);
+        }
+    }
+
+    void TaskScheduler::destroy()
+    {
+        if (queues.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCondition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        assert(queuedTasks == 0);
+        queues.clear();
+    }
+
+    uint32_t TaskScheduler::getThreadIndex()
+    {
+        return currentThreadIndex;
+    }
+
+    void TaskScheduler::schedule(std::function<void()> function, Counter* counter)
+    {
+        // Thread 0's deque may only be used by the thread that created the scheduler
+        assert(currentThreadIndex != 0 || std::this_thread::get_id() == mainThreadId);
+        if (counter) {
+            counter->value.fetch_add(1, std::memory_order_relaxed);
+        }
+        Task* task = new Task{ std::move(function), counter };
+        // Counted before the push, as the task may be stolen (and uncounted) right after it
+        queuedTasks.fetch_add(1);
+        if (!queues[currentThreadIndex]->push(task)) {
+            // Deque is full, run the task right away instead of growing it
+            queuedTasks.fetch_sub(1);
+            execute(task);
+            return;
+        }
+        if (sleepingWorkers.load() > 0) {
+            // Taking the lock ensures a worker that is about to sleep either sees the new task or receives the notification
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            sleepCondition.notify_one();
+        }
+    }
+
+    void TaskScheduler::wait(const Counter& counter)
+    {
+        const uint32_t threadIndex = currentThreadIndex;
+        while (!counter.done()) {
+            if (Task* task = findTask(threadIndex)) {
+                execute(task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void TaskScheduler::parallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& function)
+    {
+        grainSize = std::max(grainSize, 1u);
+        if (count <= grainSize) {
+            if (count > 0) {
+                function(0, count);
+            }
+            return;
+        }
+        Counter counter;
+        // The calling thread processes the first chunk itself instead of scheduling it
+        for (uint32_t begin = grainSize; begin < count; begin += grainSize) {
+            const uint32_t end = std::min(begin + grainSize, count);
+            schedule([&function, begin, end]() { function(begin, end); }, &counter);
+        }
+        function(0, grainSize);
+        wait(counter);
+    }
+
+    void TaskScheduler::workerLoop(uint32_t threadIndex)
+    {
+        currentThreadIndex = threadIndex;
+        victimSeed ^= threadIndex * 0x85EBCA6Bu;
+        PROFILE_THREAD_NAME("Worker " + std::to_string(threadIndex));
+        uint32_t idleSpins = 0;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            if (Task* task = findTask(threadIndex)) {
+                execute(task);
+                idleSpins = 0;
+                continue;
+            }
+            // Spin for a bit before going to sleep, tasks tend to be scheduled in bursts
+            if (++idleSpins < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepingWorkers.fetch_add(1);
+            sleepCondition.wait(lock, [this] { return queuedTasks.load() > 0 || stopping.load(); });
+            sleepingWorkers.fetch_sub(1);
+            idleSpins = 0;
+        }
+    }
+
+    TaskScheduler::Task* TaskScheduler::findTask(uint32_t threadIndex)
+    {
+        Task* task = queues[threadIndex]->pop();
+        if (!task) {
+            const uint32_t threadCount = getThreadCount();
+            const uint32_t firstVictim = nextVictim() % threadCount;
+            for (uint32_t i = 0; i < threadCount && !task; i++) {
+                const uint32_t victim = (firstVictim + i) % threadCount;
+                if (victim != threadIndex) {
+                    task = queues[victim]->steal();
+                }
+            }
+        }
+        if (task) {
+            queuedTasks.fetch_sub(1);
+        }
+        return task;
+    }
+
+    void TaskScheduler::execute(Task* task)
+    {
+        task->function();
+        if (task->counter) {
+            task->counter->value.fetch_sub(1, std::memory_order_release);
+        }
+        delete task;
+    }
+
+    void TaskScheduler::runBenchmark(uint32_t maxThreads, std::ostream& stream)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+        const uint32_t emptyTaskCount = 200000;
+        const uint32_t elementCount = 1 << 22;
+        const uint32_t grainSize = 4096;
+        const uint32_t repetitions = 5;
+
+        std::vector<float> input(elementCount), output(elementCount);
+        for (uint32_t i = 0; i < elementCount; i++) {
+            input[i] = static_cast<float>(i) * 0.001f;
+        }
+        // Enough math per element to be compute bound rather than memory bound
+        auto kernel = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                float x = input[i];
+                for (uint32_t j = 0; j < 16; j++) {
+                    x = std::sin(x) * 0.5f + std::sqrt(std::fabs(x) + 1.0f);
+                }
+                output[i] = x;
+            }
+        };
+
+        stream << "Task scheduler benchmark (" << emptyTaskCount << " empty tasks, parallel for over " << elementCount << " elements with grain size " << grainSize << ")\n";
+        stream << std::setw(8) << "threads" << std::setw(24) << "schedule+run (ns/task)" << std::setw(20) << "parallel for (ms)" << std::setw(12) << "speedup" << "\n";
+
+        double singleThreadTime = 0.0;
+        for (uint32_t threadCount = 1; threadCount <= std::max(maxThreads, 1u); threadCount++) {
+            TaskScheduler scheduler;
+            scheduler.create(threadCount - 1);
+
+            // Scheduling overhead: the calling thread schedules empty tasks and waits for them while workers steal
+            double overhead = 1e300;
+            for (uint32_t r = 0; r < repetitions; r++) {
+                Counter counter;
+                auto tStart = Clock::now();
+                for (uint32_t i = 0; i < emptyTaskCount; i++) {
+                    scheduler.schedule([]() {}, &counter);
+                }
+                scheduler.wait(counter);
+                auto tEnd = Clock::now();
+                overhead = std::min(overhead, std::chrono::duration<double, std::nano>(tEnd - tStart).count() / emptyTaskCount);
+            }
+
+            double parallelTime = 1e300;
+            for (uint32_t r = 0; r < repetitions; r++) {
+                auto tStart = Clock::now();
+                scheduler.parallelFor(elementCount, grainSize, kernel);
+                auto tEnd = Clock::now();
+                parallelTime = std::min(parallelTime, std::chrono::duration<double, std::milli>(tEnd - tStart).count());
+            }
+            if (threadCount == 1) {
+                singleThreadTime = parallelTime;
+            }
+
+            stream << std::fixed << std::setprecision(1) << std::setw(8) << threadCount << std::setw(24) << overhead << std::setw(20) << std::setprecision(3) << parallelTime
+                << std::setw(11) << std::setprecision(2) << singleThreadTime / parallelTime << "x\n";
+            scheduler.destroy();
+        }
+    }
+}
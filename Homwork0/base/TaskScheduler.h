@@ -0,0 +1,127 @@
+/*
+* Work-stealing task scheduler
+*
+* Every thread (the main thread and all workers) owns a lock-free deque of tasks. Threads push and pop tasks at the
+* bottom of their own deque and steal from the top of other threads' deques when they run out of work. Waiting for
+* tasks to complete runs other tasks instead of blocking, so tasks may schedule and wait for tasks themselves
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace vks
+{
+    class TaskScheduler
+    {
+    public:
+        /** @brief Number of tasks that have been scheduled with the counter and have not finished yet */
+        struct Counter
+        {
+            std::atomic<uint32_t> value{ 0 };
+
+            bool done() const { return value.load(std::memory_order_acquire) == 0; }
+        };
+
+        TaskScheduler() = default;
+        ~TaskScheduler();
+
+        TaskScheduler(const TaskScheduler&) = delete;
+        TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+        /**
+        * Start the worker threads
+        *
+        * @param workerCount Number of worker threads in addition to the calling thread, which becomes thread 0 of the scheduler
+        *
+        * @note Tasks must only be scheduled from the thread that called create and from within tasks
+        */
+        void create(uint32_t workerCount);
+
+        /* Stop and join all worker threads, all tasks must have finished */
+        void destroy();
+
+        /** @brief Number of threads executing tasks, including the thread that created the scheduler */
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(queues.size()); }
+
+        /** @brief Index of the calling thread (0 for the thread that created the scheduler), can be used to access per-thread resources without locking */
+        static uint32_t getThreadIndex();
+
+        /**
+        * Schedule a task
+        *
+        * @param function Function to run
+        * @param counter (Optional) Counter that is incremented now and decremented once the task has finished
+        */
+        void schedule(std::function<void()> function, Counter* counter = nullptr);
+
+        /** @brief Runs other tasks until all tasks scheduled with the counter have finished */
+        void wait(const Counter& counter);
+
+        /**
+        * Split a range into chunks that are processed in parallel, returns once all chunks have finished
+        *
+        * @param count Number of elements
+        * @param grainSize Maximum number of elements per task
+        * @param function Called with the [begin, end) range of each chunk
+        */
+        void parallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+        /**
+        * Measure scheduling overhead and parallel-for scaling with 1 to maxThreads threads
+        *
+        * @param maxThreads Maximum number of threads (including the calling thread)
+        * @param stream Stream the results are written to
+        */
+        static void runBenchmark(uint32_t maxThreads, std::ostream& stream);
+
+    private:
+        struct Task
+        {
+            std::function<void()> function;
+            Counter* counter;
+        };
+
+        // Chase-Lev deque with a fixed capacity, only the owning thread pushes and pops, all other threads steal
+        class WorkStealingQueue
+        {
+        public:
+            static constexpr int64_t capacity = 4096;
+
+            bool push(Task* task);
+            Task* pop();
+            Task* steal();
+
+        private:
+            std::array<std::atomic<Task*>, capacity> tasks{};
+            alignas(64) std::atomic<int64_t> top{ 0 };
+            alignas(64) std::atomic<int64_t> bottom{ 0 };
+        };
+
+        std::vector<std::unique_ptr<WorkStealingQueue>> queues;
+        std::vector<std::thread> workers;
+        std::thread::id mainThreadId;
+
+        // Idle workers sleep until tasks are scheduled
+        std::atomic<bool> stopping{ false };
+        std::atomic<uint32_t> queuedTasks{ 0 };
+        std::atomic<uint32_t> sleepingWorkers{ 0 };
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+
+        void workerLoop(uint32_t threadIndex);
+        Task* findTask(uint32_t threadIndex);
+        void execute(Task* task);
+    };
+}
@@ -0,0 +1,69 @@
+/*
+* Timeline semaphore wrapper
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "TimelineSemaphore.h"
+
+namespace vks
+{
+    bool TimelineSemaphore::isSupported(vk::PhysicalDevice physicalDevice)
+    {
+        if (physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+        vk::PhysicalDeviceVulkan12Features features12{};
+        vk::PhysicalDeviceFeatures2 features2{};
+        features2.pNext = &features12;
+        physicalDevice.getFeatures2(&features2);
+        return features12.timelineSemaphore == vk::True;
+    }
+
+    void TimelineSemaphore::create(vk::Device device)
+    {
+        this->device = device;
+        lastValue = 0;
+        vk::SemaphoreTypeCreateInfo semaphoreTypeCI{};
+        semaphoreTypeCI.semaphoreType = vk::SemaphoreType::eTimeline;
+        semaphoreTypeCI.initialValue = 0;
+        vk::SemaphoreCreateInfo semaphoreCI{};
+        semaphoreCI.pNext = &semaphoreTypeCI;
+        VK_CHECK_RESULT(device.createSemaphore(&semaphoreCI, nullptr, &semaphore));
+    }
+
+    void TimelineSemaphore::destroy()
+    {
+        if (semaphore) {
+            device.destroySemaphore(semaphore);
+            semaphore = nullptr;
+        }
+    }
+
+    uint64_t TimelineSemaphore::getCompletedValue() const
+    {
+        uint64_t value = 0;
+        VK_CHECK_RESULT(device.getSemaphoreCounterValue(semaphore, &value));
+        return value;
+    }
+
+    bool TimelineSemaphore::isComplete(uint64_t value) const
+    {
+        // Values that have never been reserved can't be waited for
+        assert(value <= lastValue);
+        return (value == 0) || (getCompletedValue() >= value);
+    }
+
+    void TimelineSemaphore::wait(uint64_t value) const
+    {
+        assert(value <= lastValue);
+        if (value == 0) {
+            return;
+        }
+        vk::SemaphoreWaitInfo waitInfo{};
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &semaphore;
+        waitInfo.pValues = &value;
+        VK_CHECK_RESULT(device.waitSemaphores(&waitInfo, UINT64_MAX));
+    }
+}
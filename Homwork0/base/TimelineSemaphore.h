@@ -0,0 +1,54 @@
+/*
+* Timeline semaphore wrapper
+*
+* A timeline semaphore carries a monotonically increasing 64 bit value instead of a binary state. Submissions signal
+* values reserved with nextValue, and the host (or other submissions) wait for a value to be reached. Waiting never
+* requires resetting anything, and a single semaphore can track any number of submissions
+*
+* Signal operations have to execute in the order their values were reserved, so all submissions signaling the same
+* timeline should go to the same queue (work on other queues can signal a binary semaphore that a submission on that
+* queue waits for)
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+    class TimelineSemaphore
+    {
+    public:
+        vk::Semaphore semaphore{ nullptr };
+
+        /** @brief Returns true if the physical device supports timeline semaphores (requires Vulkan 1.2) */
+        static bool isSupported(vk::PhysicalDevice physicalDevice);
+
+        /* Create the semaphore, the timelineSemaphore feature must have been enabled */
+        void create(vk::Device device);
+
+        /* Destroy the semaphore, it must no longer be in use */
+        void destroy();
+
+        /** @brief Reserves the value for the next signal operation, the submission signaling it must be made before reserving another value */
+        uint64_t nextValue() { return ++lastValue; }
+
+        /** @brief Value of the last reserved signal operation */
+        uint64_t getLastValue() const { return lastValue; }
+
+        /** @brief Value the semaphore has reached on the device */
+        uint64_t getCompletedValue() const;
+
+        /** @brief Returns true if the semaphore has reached the given value, never blocks */
+        bool isComplete(uint64_t value) const;
+
+        /** @brief Blocks until the semaphore has reached the given value */
+        void wait(uint64_t value) const;
+
+    private:
+        vk::Device device{ nullptr };
+        uint64_t lastValue = 0;
+    };
+}
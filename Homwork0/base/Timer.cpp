@@ -1,4 +1,6 @@
 #include "Timer.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 void Timer::onRender()
@@ -19,6 +21,18 @@ void Timer::onFrameStop()
 	auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
 	frameTimer = (float)tDiff / 1000.0f;
 
+	// Statistics
+	const float frameTimeMs = (float)tDiff;
+	cpuSamples.add(frameTimeMs);
+	const uint32_t bucket = std::min((uint32_t)(frameTimeMs / histogramBucketWidth), histogramBuckets - 1);
+	histogram[bucket]++;
+	lastFrameHitch = frameTimeMs > hitchThreshold;
+	if (lastFrameHitch)
+	{
+		hitchCount++;
+		lastHitchTime = frameTimeMs;
+	}
+
 	// Convert to clamped timer value
 	if (!paused)
 	{
@@ -30,12 +44,84 @@ void Timer::onFrameStop()
 	}
 
 	float fpsTimer = (float)(std::chrono::duration<double, std::milli>(tEnd - lastTimestamp).count());
+	fpsUpdate = false;
 	if (fpsTimer > 1000.0f)
 	{
 		lastFPS = static_cast<uint32_t>((float)frameCounter * (1000.0f / fpsTimer));
 		frameCounter = 0;
 		lastTimestamp = tEnd;
+		fpsUpdate = true;
 	}
 
 	tPrevEnd = tEnd;
-}
\ No newline at end of file
+}
+
+void Timer::onGpuFrame(float frameTimeMs)
+{
+	gpuFrameTimer = frameTimeMs / 1000.0f;
+	gpuSamples.add(frameTimeMs);
+}
+
+void Timer::setHistogramBucketWidth(float bucketWidthMs)
+{
+	histogramBucketWidth = std::max(bucketWidthMs, 0.001f);
+	histogram.fill(0);
+}
+
+void Timer::resetStatistics()
+{
+	cpuSamples.clear();
+	gpuSamples.clear();
+	histogram.fill(0);
+	hitchCount = 0;
+	lastHitchTime = 0.0f;
+	lastFrameHitch = false;
+}
+
+void Timer::SampleRing::add(float sample)
+{
+	samples[head] = sample;
+	head = (head + 1) % maxSamples;
+	count = std::min(count + 1, maxSamples);
+}
+
+void Timer::SampleRing::clear()
+{
+	head = 0;
+	count = 0;
+}
+
+Timer::Statistics Timer::SampleRing::getStatistics() const
+{
+	Statistics statistics{};
+	statistics.samples = count;
+	if (count == 0)
+	{
+		return statistics;
+	}
+
+	// The ring only contains valid samples at the start until it has been filled once, so copying the first count entries covers both cases
+	std::copy(samples.begin(), samples.begin() + count, sorted.begin());
+	std::sort(sorted.begin(), sorted.begin() + count);
+
+	// Nearest rank percentiles
+	auto percentile = [&](float p) {
+		uint32_t rank = (uint32_t)std::ceil(p / 100.0f * (float)count);
+		rank = std::clamp(rank, 1u, count);
+		return sorted[rank - 1];
+	};
+
+	float sum = 0.0f;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		sum += sorted[i];
+	}
+
+	statistics.min = sorted[0];
+	statistics.avg = sum / (float)count;
+	statistics.p50 = percentile(50.0f);
+	statistics.p95 = percentile(95.0f);
+	statistics.p99 = percentile(99.0f);
+	statistics.max = sorted[count - 1];
+	return statistics;
+}
@@ -1,27 +1,107 @@
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstdint>
 
 class Timer
 {
 public:
+    /** @brief Number of most recent frames the rolling statistics are computed from */
+    static constexpr uint32_t maxSamples = 1024;
+    /** @brief Number of frame time histogram buckets, the last bucket collects all frames exceeding the histogram range */
+    static constexpr uint32_t histogramBuckets = 64;
+
+    /** @brief Frame time statistics in milliseconds over the most recent frames */
+    struct Statistics {
+        uint32_t samples = 0;
+        float min = 0.0f;
+        float avg = 0.0f;
+        float p50 = 0.0f;
+        float p95 = 0.0f;
+        float p99 = 0.0f;
+        float max = 0.0f;
+    };
+
     void onRender();
     void onFrameStart();
     void onFrameStop();
     void onKeyP() { paused = !paused; }
+    void onGpuFrame(float frameTimeMs);
 
     float getFrameTime() const { return frameTimer; }
+    float getGpuFrameTime() const { return gpuFrameTimer; }
+    uint32_t getFPS() const { return lastFPS; }
+
+    /** @brief Rolling CPU frame time statistics over the last maxSamples frames */
+    Statistics getStatistics() const { return cpuSamples.getStatistics(); }
+
+    /** @brief Rolling GPU frame time statistics over the last maxSamples frames that had timestamps read back */
+    Statistics getGpuStatistics() const { return gpuSamples.getStatistics(); }
+
+    /** @brief Number of frames per frame time bucket since the statistics were last reset */
+    const std::array<uint32_t, histogramBuckets>& getHistogram() const { return histogram; }
+    float getHistogramBucketWidth() const { return histogramBucketWidth; }
+    /** @brief Sets the width of a histogram bucket in milliseconds, resets the histogram */
+    void setHistogramBucketWidth(float bucketWidthMs);
+
+    /** @brief Frames taking longer than this threshold (in milliseconds) are counted as hitches */
+    void setHitchThreshold(float thresholdMs) { hitchThreshold = thresholdMs; }
+    float getHitchThreshold() const { return hitchThreshold; }
+    /** @brief Number of hitches since the statistics were last reset */
+    uint32_t getHitchCount() const { return hitchCount; }
+    /** @brief Frame time of the last hitch in milliseconds */
+    float getLastHitchTime() const { return lastHitchTime; }
+    /** @brief Returns true if the last frame was a hitch */
+    bool lastFrameHitched() const { return lastFrameHitch; }
+
+    /** @brief Returns true if the fps value has been updated by the last frame (once per second) */
+    bool fpsUpdated() const { return fpsUpdate; }
+
+    /** @brief Clears all rolling samples, the histogram and the hitch counters */
+    void resetStatistics();
 
 private:
+    // Fixed size ring of frame time samples, adding samples never allocates
+    class SampleRing
+    {
+    public:
+        void add(float sample);
+        void clear();
+        Statistics getStatistics() const;
+
+    private:
+        std::array<float, maxSamples> samples{};
+        uint32_t head = 0;
+        uint32_t count = 0;
+        // Scratch storage for sorting when statistics are requested (preallocated so queries don't allocate either)
+        mutable std::array<float, maxSamples> sorted{};
+    };
+
     std::chrono::time_point<std::chrono::high_resolution_clock> lastTimestamp, tPrevEnd;
 
     // Frame counter to display fps
     uint32_t frameCounter = 0;
     uint32_t lastFPS = 0;
+    bool fpsUpdate = false;
 
     /** @brief Last frame time measured using a high performance timer (if available) */
     float frameTimer = 1.0f;
 
+    /** @brief Last GPU frame time read back from timestamp queries (lags behind the CPU frame time by the number of frames in flight) */
+    float gpuFrameTimer = 0.0f;
+
+    SampleRing cpuSamples;
+    SampleRing gpuSamples;
+
+    std::array<uint32_t, histogramBuckets> histogram{};
+    float histogramBucketWidth = 1.0f;
+
+    float hitchThreshold = 50.0f;
+    uint32_t hitchCount = 0;
+    float lastHitchTime = 0.0f;
+    bool lastFrameHitch = false;
+
     // Defines a frame rate independent timer value clamped from -1.0...1.0
     // For use in animations, rotations, etc.
     float timer = 0.0f;
@@ -31,5 +111,5 @@ private:
 
     bool paused = false;
 
-    std::chrono::steady_clock::time_point tStart;
-};
\ No newline at end of file
+    std::chrono::time_point<std::chrono::high_resolution_clock> tStart;
+};
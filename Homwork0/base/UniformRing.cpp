@@ -0,0 +1,56 @@
+/*
+* Persistently mapped uniform buffer used as a per-frame linear allocator
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "UniformRing.h"
+
+namespace vks
+{
+    void UniformRing::create(vks::VulkanDevice* vulkanDevice, vk::DeviceSize frameSize, uint32_t frameCount)
+    {
+        this->vulkanDevice = vulkanDevice;
+        // The alignment is guaranteed to be a power of two
+        alignment = std::max<vk::DeviceSize>(vulkanDevice->properties.limits.minUniformBufferOffsetAlignment, 1);
+        // Segments start at aligned offsets, so offsets within a segment only need to be aligned relative to its start
+        this->frameSize = alignedSize(frameSize);
+
+        vk::BufferCreateInfo bufferCI{};
+        bufferCI.size = this->frameSize * frameCount;
+        bufferCI.usage = vk::BufferUsageFlagBits::eUniformBuffer;
+        VK_CHECK_RESULT(vulkanDevice->logicalDevice.createBuffer(&bufferCI, nullptr, &buffer));
+
+        // Host coherent memory makes writes visible to the GPU without flushing, the buffer stays mapped for its whole lifetime
+        memory = vulkanDevice->memoryAllocator->allocateBufferMemory(buffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        beginFrame(0);
+    }
+
+    void UniformRing::destroy()
+    {
+        if (!vulkanDevice) {
+            return;
+        }
+        vulkanDevice->logicalDevice.destroyBuffer(buffer);
+        vulkanDevice->memoryAllocator->free(memory);
+        buffer = nullptr;
+    }
+
+    void UniformRing::beginFrame(uint32_t frameIndex)
+    {
+        frameBegin = frameSize * frameIndex;
+        head = frameBegin;
+    }
+
+    uint32_t UniformRing::push(const void* data, vk::DeviceSize size)
+    {
+        const vk::DeviceSize elementSize = alignedSize(size);
+        if (head + elementSize > frameBegin + frameSize) {
+            throw std::runtime_error("Uniform ring buffer frame segment is full");
+        }
+        memcpy(memory.mapped + head, data, size);
+        const uint32_t offset = (uint32_t)head;
+        head += elementSize;
+        return offset;
+    }
+}
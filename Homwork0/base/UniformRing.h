@@ -0,0 +1,68 @@
+/*
+* Persistently mapped uniform buffer used as a per-frame linear allocator
+*
+* A single buffer is split into one segment per frame slot. Each frame writes its uniform data linearly into its own
+* segment and binds it using dynamic offsets, so any number of objects can share one buffer and one descriptor set
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include "VulkanTools.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+    class UniformRing
+    {
+    public:
+        /** @brief Buffer to bind as a dynamic uniform buffer, descriptors should use the size of a single element as range */
+        vk::Buffer buffer{ nullptr };
+
+        /**
+        * Create the buffer
+        *
+        * @param vulkanDevice Device to create the buffer on
+        * @param frameSize Number of bytes that can be written per frame (including alignment padding between elements)
+        * @param frameCount Number of frame slots (frames that can be in flight at once)
+        */
+        void create(vks::VulkanDevice* vulkanDevice, vk::DeviceSize frameSize, uint32_t frameCount);
+
+        /* Free the buffer and its memory */
+        void destroy();
+
+        /** @brief Starts writing into the segment of the given frame slot, the GPU must no longer use that slot (i.e. its fence has signaled) */
+        void beginFrame(uint32_t frameIndex);
+
+        /**
+        * Copy data into the current frame's segment
+        *
+        * @return Dynamic offset of the data, aligned to minUniformBufferOffsetAlignment
+        *
+        * @throw Throws if the frame's segment is full
+        */
+        uint32_t push(const void* data, vk::DeviceSize size);
+
+        template<typename T>
+        uint32_t push(const T& data)
+        {
+            return push(&data, sizeof(T));
+        }
+
+        /** @brief Returns the offset of the given frame slot's segment, data pushed in the same order every frame ends up at the same offsets relative to it */
+        vk::DeviceSize getFrameOffset(uint32_t frameIndex) const { return frameSize * frameIndex; }
+
+        /** @brief Returns the size of an element with the given size including padding up to the next aligned offset */
+        vk::DeviceSize alignedSize(vk::DeviceSize size) const { return (size + alignment - 1) & ~(alignment - 1); }
+
+    private:
+        vks::VulkanDevice* vulkanDevice{ nullptr };
+        vks::Allocation memory{};
+        vk::DeviceSize alignment = 256;
+        vk::DeviceSize frameSize = 0;
+        // Start and current write position of the active frame's segment
+        vk::DeviceSize frameBegin = 0;
+        vk::DeviceSize head = 0;
+    };
+}
@@ -0,0 +1,422 @@
+/*
+* Asynchronous upload manager
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "UploadManager.h"
+
+namespace vks
+{
+    void UploadManager::create(vks::VulkanDevice* vulkanDevice, vk::Queue transferQueue, vk::Queue graphicsQueue, vk::DeviceSize stagingSize, vks::TimelineSemaphore* timeline)
+    {
+        this->vulkanDevice = vulkanDevice;
+        this->device = vulkanDevice->logicalDevice;
+        this->transferQueue = transferQueue;
+        this->graphicsQueue = graphicsQueue;
+        this->stagingSize = stagingSize;
+        this->timeline = timeline;
+
+        // Resources are owned by the queue family that last accessed them (exclusive sharing mode), so they need to be handed over if the families differ
+        ownershipTransfer = vulkanDevice->queueFamilyIndices.transfer != vulkanDevice->queueFamilyIndices.graphics;
+
+        transferCommandPool = vulkanDevice->createCommandPool(vulkanDevice->queueFamilyIndices.transfer);
+        if (ownershipTransfer) {
+            acquireCommandPool = vulkanDevice->createCommandPool(vulkanDevice->queueFamilyIndices.graphics);
+        }
+
+        vk::BufferCreateInfo bufferCI{};
+        bufferCI.size = stagingSize;
+        bufferCI.usage = vk::BufferUsageFlagBits::eTransferSrc;
+        VK_CHECK_RESULT(device.createBuffer(&bufferCI, nullptr, &stagingBuffer));
+        stagingMemory = vulkanDevice->memoryAllocator->allocateBufferMemory(stagingBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    void UploadManager::destroy()
+    {
+        if (!device) {
+            return;
+        }
+
+        flush();
+        for (auto& batch : inFlight) {
+            waitForBatch(*batch);
+        }
+        retire();
+
+        for (auto& batch : freeBatches) {
+            device.destroyFence(batch->fence);
+            if (batch->semaphore) {
+                device.destroySemaphore(batch->semaphore);
+            }
+        }
+        freeBatches.clear();
+
+        // Command buffers are freed along with their pools
+        device.destroyCommandPool(transferCommandPool);
+        if (acquireCommandPool) {
+            device.destroyCommandPool(acquireCommandPool);
+        }
+        device.destroyBuffer(stagingBuffer);
+        vulkanDevice->memoryAllocator->free(stagingMemory);
+        device = nullptr;
+    }
+
+    void UploadManager::uploadBuffer(vk::Buffer buffer, vk::DeviceSize offset, const void* data, vk::DeviceSize size)
+    {
+        const uint8_t* src = static_cast<const uint8_t*>(data);
+        uploadBuffer(buffer, offset, size, 1, [src](void* dst, vk::DeviceSize partOffset, vk::DeviceSize partSize) {
+            memcpy(dst, src + partOffset, partSize);
+        });
+    }
+
+    void UploadManager::uploadBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, vk::DeviceSize elementSize,
+        const std::function<void(void* dst, vk::DeviceSize partOffset, vk::DeviceSize partSize)>& write)
+    {
+        assert((elementSize > 0) && (elementSize <= stagingSize));
+        // Uploads larger than the staging ring are split, every part may end up in a different batch
+        const vk::DeviceSize maxChunkSize = stagingSize / elementSize * elementSize;
+        vk::DeviceSize partOffset = 0;
+        while (size > 0) {
+            const vk::DeviceSize chunkSize = std::min(size, maxChunkSize);
+            const vk::DeviceSize stagingOffset = allocateStaging(chunkSize, 16);
+            write(stagingMemory.mapped + stagingOffset, partOffset, chunkSize);
+
+            Batch& batch = getRecordingBatch();
+            vk::BufferCopy copyRegion{};
+            copyRegion.srcOffset = stagingOffset;
+            copyRegion.dstOffset = offset;
+            copyRegion.size = chunkSize;
+            batch.transferCommandBuffer.copyBuffer(stagingBuffer, buffer, 1, &copyRegion);
+
+            vk::BufferMemoryBarrier barrier{};
+            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+            barrier.dstAccessMask = ownershipTransfer ? vk::AccessFlags{} : vk::AccessFlagBits::eMemoryRead;
+            barrier.srcQueueFamilyIndex = ownershipTransfer ? vulkanDevice->queueFamilyIndices.transfer : VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = ownershipTransfer ? vulkanDevice->queueFamilyIndices.graphics : VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer;
+            barrier.offset = offset;
+            barrier.size = chunkSize;
+            batch.bufferBarriers.push_back(barrier);
+
+            partOffset += chunkSize;
+            offset += chunkSize;
+            size -= chunkSize;
+        }
+    }
+
+    void UploadManager::uploadImage(vk::Image image, vk::Extent3D extent, const void* data, vk::DeviceSize size, vk::ImageLayout finalLayout, vk::ImageSubresourceLayers subresource)
+    {
+        // Images larger than the staging ring are split into ranges of whole layers, whole depth slices or rows, each copied with its own region
+        // A part ends at the end of its layer (or slice), so every part is a single box in the image, and every part may end up in a different batch
+        const uint64_t rowsPerSlice = extent.height;
+        const uint64_t rowsPerLayer = rowsPerSlice * extent.depth;
+        const uint64_t rowCount = rowsPerLayer * subresource.layerCount;
+        assert(size % rowCount == 0);
+        const vk::DeviceSize rowSize = size / rowCount;
+
+        enum class Split { eLayers, eSlices, eRows } split = Split::eLayers;
+        uint64_t unitRows = rowCount;
+        uint64_t boundaryRows = rowCount;
+        if (size > stagingSize) {
+            // Copies of parts of a mip level have to be aligned to the transfer queue's granularity, (0, 0, 0) only allows copying whole mip levels
+            const vk::Extent3D granularity = vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.transfer].minImageTransferGranularity;
+            if (granularity.width == 0) {
+                throw std::runtime_error("Image upload does not fit into the staging ring and the transfer queue can only copy whole mip levels");
+            }
+            if (rowsPerLayer * rowSize <= stagingSize) {
+                unitRows = rowsPerLayer;
+            }
+            else if (rowsPerSlice * granularity.depth * rowSize <= stagingSize) {
+                split = Split::eSlices;
+                unitRows = rowsPerSlice * granularity.depth;
+                boundaryRows = rowsPerLayer;
+            }
+            else {
+                split = Split::eRows;
+                unitRows = granularity.height;
+                boundaryRows = rowsPerSlice;
+            }
+            if (unitRows * rowSize > stagingSize) {
+                throw std::runtime_error("Image upload does not fit into the staging ring, not even a single row");
+            }
+        }
+        const uint64_t maxChunkRows = stagingSize / (unitRows * rowSize) * unitRows;
+
+        vk::ImageSubresourceRange subresourceRange{};
+        subresourceRange.aspectMask = subresource.aspectMask;
+        subresourceRange.baseMipLevel = subresource.mipLevel;
+        subresourceRange.levelCount = 1;
+        subresourceRange.baseArrayLayer = subresource.baseArrayLayer;
+        subresourceRange.layerCount = subresource.layerCount;
+
+        const vk::DeviceSize alignment = std::max<vk::DeviceSize>(vulkanDevice->properties.limits.optimalBufferCopyOffsetAlignment, 16);
+        const uint8_t* src = static_cast<const uint8_t*>(data);
+        Ticket previousTicket = 0;
+        uint64_t row = 0;
+        while (row < rowCount) {
+            const uint64_t chunkRows = std::min(maxChunkRows, boundaryRows - row % boundaryRows);
+            const vk::DeviceSize chunkSize = chunkRows * rowSize;
+            const vk::DeviceSize stagingOffset = allocateStaging(chunkSize, alignment);
+            memcpy(stagingMemory.mapped + stagingOffset, src + row * rowSize, chunkSize);
+
+            Batch& batch = getRecordingBatch();
+
+            // The recording batch is submitted with the ticket nextTicket, so a changed value means the previous part was flushed with another batch
+            // The image stays in the transfer layout (and owned by the transfer queue family) until its last part has been copied
+            vk::ImageMemoryBarrier barrier{};
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange = subresourceRange;
+            barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+            barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+            if (row == 0) {
+                // The previous content is discarded, so the transition can start from an undefined layout
+                barrier.srcAccessMask = {};
+                barrier.oldLayout = vk::ImageLayout::eUndefined;
+                batch.transferCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &barrier);
+            }
+            else if (previousTicket != nextTicket) {
+                // Orders the copy after the layout transition submitted with an earlier batch (on the same queue)
+                barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+                barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+                batch.transferCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &barrier);
+            }
+            previousTicket = nextTicket;
+
+            // Without a split, this is a single region covering the whole image
+            const uint64_t layer = row / rowsPerLayer;
+            const uint64_t slice = row % rowsPerLayer / rowsPerSlice;
+            vk::BufferImageCopy copyRegion{};
+            copyRegion.bufferOffset = stagingOffset;
+            copyRegion.imageSubresource = subresource;
+            copyRegion.imageSubresource.baseArrayLayer = subresource.baseArrayLayer + (uint32_t)layer;
+            copyRegion.imageExtent = extent;
+            if (split == Split::eLayers) {
+                copyRegion.imageSubresource.layerCount = (uint32_t)(chunkRows / rowsPerLayer);
+            }
+            else if (split == Split::eSlices) {
+                copyRegion.imageSubresource.layerCount = 1;
+                copyRegion.imageOffset.z = (int32_t)slice;
+                copyRegion.imageExtent.depth = (uint32_t)(chunkRows / rowsPerSlice);
+            }
+            else {
+                copyRegion.imageSubresource.layerCount = 1;
+                copyRegion.imageOffset.y = (int32_t)(row % rowsPerSlice);
+                copyRegion.imageOffset.z = (int32_t)slice;
+                copyRegion.imageExtent.height = (uint32_t)chunkRows;
+                copyRegion.imageExtent.depth = 1;
+            }
+            batch.transferCommandBuffer.copyBufferToImage(stagingBuffer, image, vk::ImageLayout::eTransferDstOptimal, 1, &copyRegion);
+
+            row += chunkRows;
+            if (row == rowCount) {
+                // The transition to the final layout is part of the release (and acquire) barrier if ownership is transferred
+                barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+                barrier.dstAccessMask = ownershipTransfer ? vk::AccessFlags{} : vk::AccessFlagBits::eMemoryRead;
+                barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+                barrier.newLayout = finalLayout;
+                barrier.srcQueueFamilyIndex = ownershipTransfer ? vulkanDevice->queueFamilyIndices.transfer : VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = ownershipTransfer ? vulkanDevice->queueFamilyIndices.graphics : VK_QUEUE_FAMILY_IGNORED;
+                batch.imageBarriers.push_back(barrier);
+            }
+        }
+    }
+
+    UploadManager::Ticket UploadManager::flush()
+    {
+        if (!recording) {
+            return nextTicket - 1;
+        }
+
+        Batch& batch = *recording;
+
+        // Make the copies visible to the graphics queue (or release them to the graphics queue family)
+        batch.transferCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, ownershipTransfer ? vk::PipelineStageFlagBits::eBottomOfPipe : vk::PipelineStageFlagBits::eAllCommands, {},
+            0, nullptr, (uint32_t)batch.bufferBarriers.size(), batch.bufferBarriers.data(), (uint32_t)batch.imageBarriers.size(), batch.imageBarriers.data());
+        batch.transferCommandBuffer.end();
+
+        vk::SubmitInfo submitInfo{};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.transferCommandBuffer;
+
+        if (ownershipTransfer) {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &batch.semaphore;
+            VK_CHECK_RESULT(transferQueue.submit(1, &submitInfo, nullptr));
+
+            // The acquire barriers must match the release barriers, only the access masks differ
+            for (auto& barrier : batch.bufferBarriers) {
+                barrier.srcAccessMask = {};
+                barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+            }
+            for (auto& barrier : batch.imageBarriers) {
+                barrier.srcAccessMask = {};
+                barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+            }
+
+            vk::CommandBufferBeginInfo cmdBufInfo{};
+            cmdBufInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+            VK_CHECK_RESULT(batch.acquireCommandBuffer.begin(&cmdBufInfo));
+            batch.acquireCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eAllCommands, {},
+                0, nullptr, (uint32_t)batch.bufferBarriers.size(), batch.bufferBarriers.data(), (uint32_t)batch.imageBarriers.size(), batch.imageBarriers.data());
+            batch.acquireCommandBuffer.end();
+
+            const vk::PipelineStageFlags waitStageMask = vk::PipelineStageFlagBits::eAllCommands;
+            vk::SubmitInfo acquireSubmitInfo{};
+            acquireSubmitInfo.waitSemaphoreCount = 1;
+            acquireSubmitInfo.pWaitSemaphores = &batch.semaphore;
+            acquireSubmitInfo.pWaitDstStageMask = &waitStageMask;
+            acquireSubmitInfo.commandBufferCount = 1;
+            acquireSubmitInfo.pCommandBuffers = &batch.acquireCommandBuffer;
+            submitLast(graphicsQueue, acquireSubmitInfo, batch);
+        }
+        else {
+            // Same queue family means transfer and graphics queue are the same queue
+            submitLast(transferQueue, submitInfo, batch);
+        }
+
+        batch.ticket = nextTicket++;
+        batch.stagingEnd = stagingHead;
+        inFlight.push_back(std::move(recording));
+        return batch.ticket;
+    }
+
+    bool UploadManager::isComplete(Ticket ticket)
+    {
+        retire();
+        return ticket <= completedTicket;
+    }
+
+    void UploadManager::wait(Ticket ticket)
+    {
+        assert(ticket < nextTicket);
+        while (!isComplete(ticket)) {
+            waitForBatch(*inFlight.front());
+        }
+    }
+
+    UploadManager::Batch& UploadManager::getRecordingBatch()
+    {
+        if (recording) {
+            return *recording;
+        }
+
+        if (!freeBatches.empty()) {
+            recording = std::move(freeBatches.back());
+            freeBatches.pop_back();
+        }
+        else {
+            recording = std::make_unique<Batch>();
+
+            vk::CommandBufferAllocateInfo cmdBufAllocateInfo{};
+            cmdBufAllocateInfo.commandPool = transferCommandPool;
+            cmdBufAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
+            cmdBufAllocateInfo.commandBufferCount = 1;
+            VK_CHECK_RESULT(device.allocateCommandBuffers(&cmdBufAllocateInfo, &recording->transferCommandBuffer));
+
+            if (ownershipTransfer) {
+                cmdBufAllocateInfo.commandPool = acquireCommandPool;
+                VK_CHECK_RESULT(device.allocateCommandBuffers(&cmdBufAllocateInfo, &recording->acquireCommandBuffer));
+                vk::SemaphoreCreateInfo semaphoreCI{};
+                VK_CHECK_RESULT(device.createSemaphore(&semaphoreCI, nullptr, &recording->semaphore));
+            }
+
+            if (!timeline) {
+                vk::FenceCreateInfo fenceCI{};
+                VK_CHECK_RESULT(device.createFence(&fenceCI, nullptr, &recording->fence));
+            }
+        }
+
+        recording->bufferBarriers.clear();
+        recording->imageBarriers.clear();
+
+        // Command pools are created with the reset flag, so beginning a command buffer implicitly resets it
+        vk::CommandBufferBeginInfo cmdBufInfo{};
+        cmdBufInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+        VK_CHECK_RESULT(recording->transferCommandBuffer.begin(&cmdBufInfo));
+
+        return *recording;
+    }
+
+    vk::DeviceSize UploadManager::allocateStaging(vk::DeviceSize size, vk::DeviceSize alignment)
+    {
+        assert(size <= stagingSize);
+        for (;;) {
+            // Restart at the beginning of the ring if no staging memory is in use
+            if (inFlight.empty() && !recording) {
+                stagingHead = 0;
+                stagingTail = 0;
+            }
+
+            uint64_t position = (stagingHead + alignment - 1) / alignment * alignment;
+            // Ranges never wrap around the end of the buffer, skip to the start of the next lap instead
+            if (position % stagingSize + size > stagingSize) {
+                position = (position / stagingSize + 1) * stagingSize;
+            }
+            if (position + size - stagingTail <= stagingSize) {
+                stagingHead = position + size;
+                return position % stagingSize;
+            }
+
+            // The ring is full, make room by waiting for the oldest batch (or submitting the current one if nothing else is in flight)
+            if (inFlight.empty()) {
+                flush();
+            }
+            else {
+                waitForBatch(*inFlight.front());
+                retire();
+            }
+        }
+    }
+
+    void UploadManager::retire()
+    {
+        while (!inFlight.empty() && isBatchComplete(*inFlight.front())) {
+            std::unique_ptr<Batch> batch = std::move(inFlight.front());
+            inFlight.pop_front();
+            completedTicket = batch->ticket;
+            stagingTail = batch->stagingEnd;
+            if (batch->fence) {
+                VK_CHECK_RESULT(device.resetFences(1, &batch->fence));
+            }
+            freeBatches.push_back(std::move(batch));
+        }
+    }
+
+    void UploadManager::submitLast(vk::Queue queue, vk::SubmitInfo& submitInfo, Batch& batch)
+    {
+        if (!timeline) {
+            VK_CHECK_RESULT(queue.submit(1, &submitInfo, batch.fence));
+            return;
+        }
+        // Signals the shared timeline from the graphics queue, so its values stay in submission order with the frames signaling it
+        batch.timelineValue = timeline->nextValue();
+        vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+        timelineSubmitInfo.signalSemaphoreValueCount = 1;
+        timelineSubmitInfo.pSignalSemaphoreValues = &batch.timelineValue;
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timeline->semaphore;
+        VK_CHECK_RESULT(queue.submit(1, &submitInfo, nullptr));
+    }
+
+    bool UploadManager::isBatchComplete(const Batch& batch) const
+    {
+        if (timeline) {
+            return timeline->isComplete(batch.timelineValue);
+        }
+        return device.getFenceStatus(batch.fence) == vk::Result::eSuccess;
+    }
+
+    void UploadManager::waitForBatch(const Batch& batch) const
+    {
+        if (timeline) {
+            timeline->wait(batch.timelineValue);
+        }
+        else {
+            VK_CHECK_RESULT(device.waitForFences(1, &batch.fence, vk::True, UINT64_MAX));
+        }
+    }
+}
@@ -0,0 +1,151 @@
+/*
+* Asynchronous upload manager
+*
+* Batches buffer and image uploads through a persistently mapped staging ring and submits the copies to the transfer
+* queue. If the transfer queue belongs to a different queue family than the graphics queue, ownership of the
+* destination resources is released on the transfer queue and acquired on the graphics queue
+*
+* Every submitted batch is identified by a ticket that can be polled, so the render thread never has to block on uploads
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "VulkanTools.h"
+#include "VulkanDevice.h"
+#include "TimelineSemaphore.h"
+
+namespace vks
+{
+    class UploadManager
+    {
+    public:
+        /** @brief Identifies a submitted batch of uploads, tickets increase monotonically and 0 is always complete */
+        using Ticket = uint64_t;
+
+        static constexpr vk::DeviceSize defaultStagingSize = 32 * 1024 * 1024;
+
+        /**
+        * Create the staging ring and command pools
+        *
+        * @param vulkanDevice Device the uploads are done on
+        * @param transferQueue Queue the copies are submitted to (family queueFamilyIndices.transfer)
+        * @param graphicsQueue Queue the uploaded resources are used on (family queueFamilyIndices.graphics)
+        * @param stagingSize (Optional) Size of the staging ring in bytes, larger buffer uploads are split into multiple copies
+        * @param timeline (Optional) Timeline semaphore signaled by the graphics queue (e.g. the frame timeline), batches signal it instead of using a fence
+        *
+        * @note If transfer and graphics queue are the same queue, submissions to it must not happen concurrently from another thread
+        */
+        void create(vks::VulkanDevice* vulkanDevice, vk::Queue transferQueue, vk::Queue graphicsQueue, vk::DeviceSize stagingSize = defaultStagingSize,
+            vks::TimelineSemaphore* timeline = nullptr);
+
+        /* Wait for all uploads to finish and free all Vulkan resources */
+        void destroy();
+
+        /** @brief Queue a copy of data into a buffer, the copy is part of the next flush */
+        void uploadBuffer(vk::Buffer buffer, vk::DeviceSize offset, const void* data, vk::DeviceSize size);
+
+        /**
+        * Queue a copy into a buffer whose data is written straight into the staging ring, saves the intermediate copy if the data has to be generated or converted anyway
+        *
+        * @param buffer Destination buffer
+        * @param offset Offset into the destination buffer
+        * @param size Size of the data in bytes
+        * @param elementSize Uploads larger than the staging ring are split into parts that are a multiple of this (e.g. the vertex stride), so every part holds whole elements
+        * @param write Called once per part with a pointer into the staging ring and the part's byte offset and size relative to the start of the upload
+        */
+        void uploadBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, vk::DeviceSize elementSize,
+            const std::function<void(void* dst, vk::DeviceSize partOffset, vk::DeviceSize partSize)>& write);
+
+        /**
+        * Queue a copy of data into (one mip level of) an image, the copy is part of the next flush
+        *
+        * @param image Destination image, its current content is discarded
+        * @param extent Extent of the copied mip level
+        * @param data Tightly packed texel data for all layers
+        * @param size Size of data in bytes, images larger than the staging ring are split into copies of layers, depth slices or rows (uncompressed formats only)
+        * @param finalLayout Layout the image is transitioned to once the copy has finished
+        * @param subresource (Optional) Mip level and layers to copy to
+        */
+        void uploadImage(vk::Image image, vk::Extent3D extent, const void* data, vk::DeviceSize size, vk::ImageLayout finalLayout,
+            vk::ImageSubresourceLayers subresource = { vk::ImageAspectFlagBits::eColor, 0, 0, 1 });
+
+        /**
+        * Submit all uploads queued since the last flush
+        *
+        * @note Graphics queue submissions made after this call are ordered after the upload, so uploaded resources may be used right away
+        *       (the GPU then waits for the copy). Poll the ticket to only use them once they're resident instead
+        *
+        * @return Ticket of the submitted batch (or of the last batch if nothing was queued)
+        */
+        Ticket flush();
+
+        /** @brief Returns true once all uploads of the batch with the given ticket (and all batches before it) have finished, never blocks */
+        bool isComplete(Ticket ticket);
+
+        /** @brief Blocks until the batch with the given ticket has finished */
+        void wait(Ticket ticket);
+
+        /** @brief Returns true if the transfer queue belongs to a different queue family, i.e. uploads actually run in parallel to rendering */
+        bool usesDedicatedQueue() const { return ownershipTransfer; }
+
+    private:
+        struct Batch
+        {
+            vk::CommandBuffer transferCommandBuffer{ nullptr };
+            // Acquires ownership on the graphics queue, only used if queue families differ
+            vk::CommandBuffer acquireCommandBuffer{ nullptr };
+            // Signaled by the transfer submission, waited on by the acquire submission
+            vk::Semaphore semaphore{ nullptr };
+            // Signaled by the last submission of the batch (only used without a timeline)
+            vk::Fence fence{ nullptr };
+            // Timeline value signaled by the last submission of the batch
+            uint64_t timelineValue = 0;
+            Ticket ticket = 0;
+            // Position of the staging ring head after this batch, the ring's tail advances to it once the batch has finished
+            uint64_t stagingEnd = 0;
+            std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+            std::vector<vk::ImageMemoryBarrier> imageBarriers;
+        };
+
+        vks::VulkanDevice* vulkanDevice{ nullptr };
+        vk::Device device{ nullptr };
+        vk::Queue transferQueue{ nullptr };
+        vk::Queue graphicsQueue{ nullptr };
+        bool ownershipTransfer = false;
+        vks::TimelineSemaphore* timeline{ nullptr };
+
+        vk::CommandPool transferCommandPool{ nullptr };
+        vk::CommandPool acquireCommandPool{ nullptr };
+
+        // Staging ring, head and tail are absolute byte positions that only grow (the buffer offset is position % stagingSize)
+        vk::Buffer stagingBuffer{ nullptr };
+        vks::Allocation stagingMemory{};
+        vk::DeviceSize stagingSize = 0;
+        uint64_t stagingHead = 0;
+        uint64_t stagingTail = 0;
+
+        // Batch currently being recorded (nullptr if no uploads have been queued since the last flush)
+        std::unique_ptr<Batch> recording;
+        // Submitted batches in submission order
+        std::deque<std::unique_ptr<Batch>> inFlight;
+        // Finished batches whose command buffers and sync objects can be reused
+        std::vector<std::unique_ptr<Batch>> freeBatches;
+
+        Ticket nextTicket = 1;
+        Ticket completedTicket = 0;
+
+        Batch& getRecordingBatch();
+        vk::DeviceSize allocateStaging(vk::DeviceSize size, vk::DeviceSize alignment);
+        void submitLast(vk::Queue queue, vk::SubmitInfo& submitInfo, Batch& batch);
+        bool isBatchComplete(const Batch& batch) const;
+        void waitForBatch(const Batch& batch) const;
+        void retire();
+    };
+}
@@ -0,0 +1,149 @@
+/*
+* Vertex formats with full float and packed (quantized) attribute encodings
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VertexFormat.h"
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace vks
+{
+    uint32_t VertexFormat::getPositionSize() const
+    {
+        return (positionEncoding == PositionEncoding::eFloat) ? 12 : 8;
+    }
+
+    uint32_t VertexFormat::getNormalSize() const
+    {
+        switch (normalEncoding) {
+        case NormalEncoding::eFloat:
+            return 12;
+        case NormalEncoding::eOctahedral:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t VertexFormat::getColorSize() const
+    {
+        return (colorEncoding == ColorEncoding::eFloat) ? 12 : 4;
+    }
+
+    VertexFormat VertexFormat::create(PositionEncoding positionEncoding, NormalEncoding normalEncoding, ColorEncoding colorEncoding)
+    {
+        // All attribute sizes are multiples of four, which satisfies the alignment requirements of all used formats
+        VertexFormat format;
+        format.positionEncoding = positionEncoding;
+        format.normalEncoding = normalEncoding;
+        format.colorEncoding = colorEncoding;
+        format.positionOffset = 0;
+        format.normalOffset = format.positionOffset + format.getPositionSize();
+        format.colorOffset = format.normalOffset + format.getNormalSize();
+        format.stride = format.colorOffset + format.getColorSize();
+        return format;
+    }
+
+    bool VertexFormat::fromName(const std::string& name, VertexFormat& format)
+    {
+        if (name == "float") {
+            format = create(PositionEncoding::eFloat, NormalEncoding::eFloat, ColorEncoding::eFloat);
+            return true;
+        }
+        if (name == "half") {
+            format = create(PositionEncoding::eHalf, NormalEncoding::eOctahedral, ColorEncoding::eUnorm8);
+            return true;
+        }
+        if (name == "snorm16") {
+            format = create(PositionEncoding::eSnorm16, NormalEncoding::eOctahedral, ColorEncoding::eUnorm8);
+            return true;
+        }
+        return false;
+    }
+
+    std::string VertexFormat::getName() const
+    {
+        for (const char* name : { "float", "half", "snorm16" }) {
+            VertexFormat preset;
+            fromName(name, preset);
+            if ((preset.positionEncoding == positionEncoding) && (preset.normalEncoding == normalEncoding) && (preset.colorEncoding == colorEncoding)) {
+                return name;
+            }
+        }
+        const char* positionNames[] = { "float", "half", "snorm16" };
+        const char* normalNames[] = { "none", "float", "octahedral" };
+        const char* colorNames[] = { "float", "unorm8" };
+        return std::string("position ") + positionNames[(int)positionEncoding] + ", normal " + normalNames[(int)normalEncoding] + ", color " + colorNames[(int)colorEncoding];
+    }
+
+    void VertexFormat::setQuantizationBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    {
+        // A single scale for all axes keeps the dequantization a similarity transform, so normals don't have to be corrected for it
+        const glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+        quantizationCenter = (boundsMin + boundsMax) * 0.5f;
+        quantizationScale = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+    }
+
+    glm::mat4 VertexFormat::getDequantizationMatrix() const
+    {
+        if (!isQuantized()) {
+            return glm::mat4(1.0f);
+        }
+        return glm::scale(glm::translate(glm::mat4(1.0f), quantizationCenter), glm::vec3(quantizationScale));
+    }
+
+    vk::Format VertexFormat::getPositionFormat() const
+    {
+        switch (positionEncoding) {
+        case PositionEncoding::eHalf:
+            return vk::Format::eR16G16B16A16Sfloat;
+        case PositionEncoding::eSnorm16:
+            return vk::Format::eR16G16B16A16Snorm;
+        default:
+            return vk::Format::eR32G32B32Sfloat;
+        }
+    }
+
+    vk::Format VertexFormat::getNormalFormat() const
+    {
+        switch (normalEncoding) {
+        case NormalEncoding::eFloat:
+            return vk::Format::eR32G32B32Sfloat;
+        case NormalEncoding::eOctahedral:
+            return vk::Format::eR16G16Snorm;
+        default:
+            return vk::Format::eUndefined;
+        }
+    }
+
+    vk::Format VertexFormat::getColorFormat() const
+    {
+        return (colorEncoding == ColorEncoding::eFloat) ? vk::Format::eR32G32B32Sfloat : vk::Format::eR8G8B8A8Unorm;
+    }
+
+    vk::VertexInputBindingDescription VertexFormat::getBindingDescription(uint32_t binding, vk::VertexInputRate inputRate) const
+    {
+        vk::VertexInputBindingDescription description{};
+        description.binding = binding;
+        description.stride = stride;
+        description.inputRate = inputRate;
+        return description;
+    }
+
+    std::vector<vk::VertexInputAttributeDescription> VertexFormat::getAttributeDescriptions(uint32_t binding) const
+    {
+        // All used formats are required to support vertex buffer usage, so they don't need to be checked against the device
+        // Formats with fewer components than the shader input are expanded by the vertex fetch (missing components are 0, w is 1)
+        std::vector<vk::VertexInputAttributeDescription> descriptions;
+        descriptions.push_back(vk::VertexInputAttributeDescription(0, binding, getPositionFormat(), positionOffset));
+        descriptions.push_back(vk::VertexInputAttributeDescription(1, binding, getColorFormat(), colorOffset));
+        if (hasNormals()) {
+            descriptions.push_back(vk::VertexInputAttributeDescription(2, binding, getNormalFormat(), normalOffset));
+        }
+        return descriptions;
+    }
+}
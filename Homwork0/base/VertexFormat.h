@@ -0,0 +1,158 @@
+/*
+* Vertex formats with full float and packed (quantized) attribute encodings
+*
+* A format describes how the position, normal and color of a vertex are stored in a vertex buffer. Mesh loaders encode
+* vertices straight into the destination (e.g. the staging ring of the upload manager) with it, and the pipeline's vertex
+* input state is generated from it. Packed attributes are expanded to floats by the vertex fetch hardware (SFLOAT, SNORM
+* and UNORM formats), only octahedral normals have to be decoded in the vertex shader
+*
+* Quantized positions are stored relative to the mesh bounds, (position - center) / scale with a single scale for all axes.
+* The dequantization is an affine transform (see getDequantizationMatrix) that is folded into the model matrix, so it's free in the shader
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <vulkan/vulkan.hpp>
+
+namespace vks
+{
+    struct VertexFormat
+    {
+        enum class PositionEncoding {
+            // Three 32 bit floats (12 bytes), not quantized
+            eFloat,
+            // Four 16 bit floats (8 bytes, w is unused) of the quantized position
+            eHalf,
+            // Four 16 bit signed normalized integers (8 bytes, w is unused) of the quantized position
+            eSnorm16
+        };
+        enum class NormalEncoding {
+            eNone,
+            // Three 32 bit floats (12 bytes)
+            eFloat,
+            // Octahedral mapping of the unit sphere to [-1, 1]^2, stored as two 16 bit signed normalized integers (4 bytes)
+            eOctahedral
+        };
+        enum class ColorEncoding {
+            // Three 32 bit floats (12 bytes)
+            eFloat,
+            // Four 8 bit unsigned normalized integers (4 bytes, alpha is unused)
+            eUnorm8
+        };
+
+        PositionEncoding positionEncoding = PositionEncoding::eFloat;
+        NormalEncoding normalEncoding = NormalEncoding::eNone;
+        ColorEncoding colorEncoding = ColorEncoding::eFloat;
+        // Vertex stride and attribute offsets in bytes
+        uint32_t stride = 0;
+        uint32_t positionOffset = 0;
+        uint32_t normalOffset = 0;
+        uint32_t colorOffset = 0;
+        // Position quantization, only used by the quantized position encodings
+        glm::vec3 quantizationCenter{ 0.0f };
+        float quantizationScale = 1.0f;
+
+        /** @brief Create a format with the attributes packed in the order position, normal, color (each four byte aligned) */
+        static VertexFormat create(PositionEncoding positionEncoding, NormalEncoding normalEncoding, ColorEncoding colorEncoding);
+
+        /**
+        * Get one of the mesh vertex format presets by name, all of them have normals
+        * "float": float position, normal and color (36 bytes)
+        * "half": half float position, octahedral normal and unorm8 color (16 bytes)
+        * "snorm16": snorm16 position, octahedral normal and unorm8 color (16 bytes)
+        *
+        * @return False if there is no preset with that name
+        */
+        static bool fromName(const std::string& name, VertexFormat& format);
+        /** @brief Name of the preset this format matches or a description of its encodings */
+        std::string getName() const;
+
+        /** @brief Size of the attributes in bytes (0 for a format without normals) */
+        uint32_t getPositionSize() const;
+        uint32_t getNormalSize() const;
+        uint32_t getColorSize() const;
+
+        bool isQuantized() const { return positionEncoding != PositionEncoding::eFloat; }
+        bool hasNormals() const { return normalEncoding != NormalEncoding::eNone; }
+
+        /** @brief Set the position quantization so that the bounding box maps to [-1, 1] on its largest axis */
+        void setQuantizationBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+        /** @brief Transform from the stored positions to the mesh's positions (identity for float positions) */
+        glm::mat4 getDequantizationMatrix() const;
+
+        vk::Format getPositionFormat() const;
+        vk::Format getNormalFormat() const;
+        vk::Format getColorFormat() const;
+
+        /** @brief Vertex input binding description with the format's stride */
+        vk::VertexInputBindingDescription getBindingDescription(uint32_t binding, vk::VertexInputRate inputRate = vk::VertexInputRate::eVertex) const;
+        /** @brief Vertex input attribute descriptions, position is at location 0, color at location 1 and the normal (if present) at location 2 */
+        std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions(uint32_t binding) const;
+
+        /* Encode the attributes of a vertex, vertex points to the start of the vertex in the destination */
+
+        void writePosition(uint8_t* vertex, const glm::vec3& position) const
+        {
+            if (positionEncoding == PositionEncoding::eFloat) {
+                memcpy(vertex + positionOffset, &position.x, sizeof(float) * 3);
+                return;
+            }
+            const glm::vec3 quantized = (position - quantizationCenter) / quantizationScale;
+            uint16_t packed[4];
+            if (positionEncoding == PositionEncoding::eHalf) {
+                packed[0] = glm::packHalf1x16(quantized.x);
+                packed[1] = glm::packHalf1x16(quantized.y);
+                packed[2] = glm::packHalf1x16(quantized.z);
+                packed[3] = glm::packHalf1x16(1.0f);
+            }
+            else {
+                packed[0] = glm::packSnorm1x16(quantized.x);
+                packed[1] = glm::packSnorm1x16(quantized.y);
+                packed[2] = glm::packSnorm1x16(quantized.z);
+                packed[3] = glm::packSnorm1x16(1.0f);
+            }
+            memcpy(vertex + positionOffset, packed, sizeof(packed));
+        }
+
+        /* The normal is expected to be normalized, zero normals (no normal) are stored as they are for float and as +z for octahedral normals */
+        void writeNormal(uint8_t* vertex, const glm::vec3& normal) const
+        {
+            if (normalEncoding == NormalEncoding::eFloat) {
+                memcpy(vertex + normalOffset, &normal.x, sizeof(float) * 3);
+            }
+            else if (normalEncoding == NormalEncoding::eOctahedral) {
+                // Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower hemisphere over the diagonals
+                const float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+                glm::vec2 octahedral = (sum > 0.0f) ? glm::vec2(normal.x, normal.y) / sum : glm::vec2(0.0f);
+                if (normal.z < 0.0f) {
+                    octahedral = glm::vec2((1.0f - std::abs(octahedral.y)) * (octahedral.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(octahedral.x)) * (octahedral.y >= 0.0f ? 1.0f : -1.0f));
+                }
+                const uint16_t packed[2] = { glm::packSnorm1x16(octahedral.x), glm::packSnorm1x16(octahedral.y) };
+                memcpy(vertex + normalOffset, packed, sizeof(packed));
+            }
+        }
+
+        void writeColor(uint8_t* vertex, const glm::vec3& color) const
+        {
+            if (colorEncoding == ColorEncoding::eFloat) {
+                memcpy(vertex + colorOffset, &color.x, sizeof(float) * 3);
+                return;
+            }
+            const uint8_t packed[4] = { glm::packUnorm1x8(color.x), glm::packUnorm1x8(color.y), glm::packUnorm1x8(color.z), 255 };
+            memcpy(vertex + colorOffset, packed, sizeof(packed));
+        }
+    };
+}
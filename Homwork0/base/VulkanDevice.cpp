@@ -55,6 +55,12 @@ namespace vks
     */
     VulkanDevice::~VulkanDevice()
     {
+        // The device must be idle at this point, so remaining deferred deletions can be done right away
+        deletionQueue.flush();
+
+        // All memory blocks are freed along with the allocator
+        delete memoryAllocator;
+
         if (commandPool)
         {
             logicalDevice.destroyCommandPool(commandPool);
@@ -153,6 +159,12 @@ namespace vks
             }
         }
 
+        // Graphics and compute queues always support transfer operations, even if the family doesn't report the transfer bit
+        if (queueFlags == vk::QueueFlags(vk::QueueFlagBits::eTransfer))
+        {
+            return getQueueFamilyIndex(vk::QueueFlagBits::eGraphics);
+        }
+
         throw std::runtime_error("Could not find a matching queue family index");
     }
 
@@ -284,6 +296,9 @@ namespace vks
         // Create a default command pool for graphics command buffers
         commandPool = createCommandPool(queueFamilyIndices.graphics);
 
+        memoryAllocator = new MemoryAllocator(this);
+        deletionQueue.create(logicalDevice, memoryAllocator);
+
         return result;
     }
 
@@ -11,6 +11,8 @@
 #pragma once
 
 #include "VulkanTools.h"
+#include "VulkanMemoryAllocator.h"
+#include "DeletionQueue.h"
 
 #include <vulkan/vulkan.hpp>
 #include <algorithm>
@@ -48,6 +50,12 @@ namespace vks
         /** @brief Default command pool for the graphics queue family index */
         vk::CommandPool commandPool = VK_NULL_HANDLE;
 
+        /** @brief Sub-allocator for device memory, created along with the logical device */
+        MemoryAllocator* memoryAllocator = nullptr;
+
+        /** @brief Resources waiting for the submissions using them to complete before they are destroyed, values are frame numbers reported by the example base */
+        DeletionQueue deletionQueue;
+
         /** @brief Contains queue family indices */
         struct
         {
@@ -0,0 +1,73 @@
+/*
+* Class wrapping a ring of offscreen color images that stand in for the swap chain in headless mode
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanHeadless.h"
+
+void VulkanHeadless::setContext(vks::VulkanDevice* vulkanDevice)
+{
+    this->vulkanDevice = vulkanDevice;
+    this->device = vulkanDevice->logicalDevice;
+}
+
+void VulkanHeadless::create(uint32_t width, uint32_t height, uint32_t imageCount, Retired* retired)
+{
+    assert(vulkanDevice);
+    assert(device);
+
+    if (retired) {
+        *retired = { std::move(images), std::move(memories), std::move(imageViews) };
+    }
+    cleanup();
+
+    images.resize(imageCount);
+    memories.resize(imageCount);
+    imageViews.resize(imageCount);
+
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        vk::ImageCreateInfo imageCI{};
+        imageCI.imageType   = vk::ImageType::e2D;
+        imageCI.format      = colorFormat;
+        imageCI.extent      = vk::Extent3D(width, height, 1);
+        imageCI.mipLevels   = 1;
+        imageCI.arrayLayers = 1;
+        imageCI.samples     = vk::SampleCountFlagBits::e1;
+        imageCI.tiling      = vk::ImageTiling::eOptimal;
+        // Transfer source is enabled so the rendered images can be read back (e.g. for screenshots or image comparisons)
+        // Transfer destination is enabled so upscaled frames can be blitted into them (dynamic resolution)
+        imageCI.usage       = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+        VK_CHECK_RESULT(device.createImage(&imageCI, nullptr, &images[i]));
+
+        memories[i] = vulkanDevice->memoryAllocator->allocateImageMemory(images[i], vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        vk::ImageViewCreateInfo colorAttachmentView{};
+        colorAttachmentView.viewType                        = vk::ImageViewType::e2D;
+        colorAttachmentView.image                           = images[i];
+        colorAttachmentView.format                          = colorFormat;
+        colorAttachmentView.subresourceRange.aspectMask     = vk::ImageAspectFlagBits::eColor;
+        colorAttachmentView.subresourceRange.baseMipLevel   = 0;
+        colorAttachmentView.subresourceRange.levelCount     = 1;
+        colorAttachmentView.subresourceRange.baseArrayLayer = 0;
+        colorAttachmentView.subresourceRange.layerCount     = 1;
+        VK_CHECK_RESULT(device.createImageView(&colorAttachmentView, nullptr, &imageViews[i]));
+    }
+}
+
+void VulkanHeadless::cleanup()
+{
+    Retired current{ std::move(images), std::move(memories), std::move(imageViews) };
+    destroyRetired(current);
+}
+
+void VulkanHeadless::destroyRetired(Retired& retired)
+{
+    for (size_t i = 0; i < retired.images.size(); ++i) {
+        device.destroyImageView(retired.imageViews[i]);
+        device.destroyImage(retired.images[i]);
+        vulkanDevice->memoryAllocator->free(retired.memories[i]);
+    }
+    retired = {};
+}
@@ -0,0 +1,58 @@
+/*
+* Class wrapping a ring of offscreen color images that stand in for the swap chain in headless mode
+* (also used for the scaled render targets of dynamic resolution)
+*
+* Headless rendering does not use a surface or the presentation engine, so frames are rendered into
+* images owned by the application instead. This allows running on devices without display support
+* (e.g. software implementations like lavapipe) and measuring frame throughput without present overhead
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "VulkanTools.h"
+#include "VulkanDevice.h"
+
+class VulkanHeadless
+{
+private:
+    vks::VulkanDevice* vulkanDevice { nullptr };
+    vk::Device         device       { nullptr };
+
+public:
+    vk::Format                    colorFormat { vk::Format::eR8G8B8A8Unorm };
+    std::vector<vk::Image>        images      {};
+    std::vector<vks::Allocation>  memories    {};
+    std::vector<vk::ImageView>    imageViews  {};
+
+    /** @brief Images replaced by a recreation, still in use by frames in flight */
+    struct Retired {
+        std::vector<vk::Image>       images     {};
+        std::vector<vks::Allocation> memories   {};
+        std::vector<vk::ImageView>   imageViews {};
+    };
+
+    /* Set the Vulkan objects required for image creation, must be called before the targets are created */
+    void setContext(vks::VulkanDevice* vulkanDevice);
+
+    /**
+    * Create the ring of offscreen color images (and views) with the given size
+    *
+    * @param width Width of the offscreen images
+    * @param height Height of the offscreen images
+    * @param imageCount Number of images in the ring, should match the number of frames that can be in flight at once
+    * @param retired (Optional) If set, existing images are handed over instead of being destroyed, so they can be destroyed once the frames using them have finished
+    *
+    * @note Without retired, existing images are destroyed right away, so the device must no longer use them
+    */
+    void create(uint32_t width, uint32_t height, uint32_t imageCount, Retired* retired = nullptr);
+
+    /* Destroy images handed over by create, the device must no longer use them */
+    void destroyRetired(Retired& retired);
+
+    /* Free all Vulkan resources owned by the offscreen targets */
+    void cleanup();
+};
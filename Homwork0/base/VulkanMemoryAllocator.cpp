@@ -0,0 +1,317 @@
+/*
+* Device memory sub-allocator
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanMemoryAllocator.h"
+#include "VulkanDevice.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace vks
+{
+    namespace
+    {
+        vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        vk::DeviceSize alignDown(vk::DeviceSize value, vk::DeviceSize alignment)
+        {
+            return value / alignment * alignment;
+        }
+    }
+
+    float MemoryAllocator::Statistics::fragmentation() const
+    {
+        const vk::DeviceSize freeBytes = reservedBytes - usedBytes;
+        if (freeBytes == 0) {
+            return 0.0f;
+        }
+        return 1.0f - (float)((double)largestFreeRange / (double)freeBytes);
+    }
+
+    MemoryAllocator::MemoryAllocator(vks::VulkanDevice* vulkanDevice, vk::DeviceSize blockSize) : vulkanDevice(vulkanDevice), blockSize(blockSize)
+    {
+        assert(vulkanDevice);
+        device = vulkanDevice->logicalDevice;
+        nonCoherentAtomSize = std::max<vk::DeviceSize>(vulkanDevice->properties.limits.nonCoherentAtomSize, 1);
+        maxAllocationCount = vulkanDevice->properties.limits.maxMemoryAllocationCount;
+    }
+
+    MemoryAllocator::~MemoryAllocator()
+    {
+        for (auto& block : blocks) {
+            if (block->allocationCount > 0) {
+                std::cerr << "Memory allocator: " << block->allocationCount << " allocation(s) of memory type " << block->memoryTypeIndex << " have not been freed\n";
+            }
+            if (block->mapped) {
+                device.unmapMemory(block->memory);
+            }
+            device.freeMemory(block->memory);
+        }
+    }
+
+    Allocation MemoryAllocator::allocate(const vk::MemoryRequirements& memReqs, vk::MemoryPropertyFlags properties, bool linear)
+    {
+        const uint32_t memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, properties);
+
+        vk::DeviceSize size = memReqs.size;
+        vk::DeviceSize alignment = std::max<vk::DeviceSize>(memReqs.alignment, 1);
+        // Flushes and invalidates of non-coherent memory work on nonCoherentAtomSize granularity
+        // Aligning start and size of such allocations to it ensures that flushing one allocation never touches its neighbours
+        const bool hostVisible = (vulkanDevice->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) == vk::MemoryPropertyFlagBits::eHostVisible;
+        if (hostVisible && !isCoherent(memoryTypeIndex)) {
+            alignment = alignUp(alignment, nonCoherentAtomSize);
+            size = alignUp(size, nonCoherentAtomSize);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        Allocation allocation{};
+
+        // Large resources would quickly fragment shared blocks, so they get a block of their own
+        if (size > blockSize / 2) {
+            Block* block = createBlock(memoryTypeIndex, size, linear, true);
+            allocateFromBlock(*block, size, alignment, allocation);
+            return allocation;
+        }
+
+        // Linear (buffers) and optimal (images) resources never share a block, so bufferImageGranularity never has to be considered for neighbouring ranges
+        for (auto& block : blocks) {
+            if (block->memoryTypeIndex == memoryTypeIndex && block->linear == linear && !block->dedicated) {
+                if (allocateFromBlock(*block, size, alignment, allocation)) {
+                    return allocation;
+                }
+            }
+        }
+
+        // Don't reserve a large share of small heaps (e.g. the 256 MiB host visible device local heap on some discrete GPUs)
+        const uint32_t heapIndex = vulkanDevice->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+        const vk::DeviceSize heapSize = vulkanDevice->memoryProperties.memoryHeaps[heapIndex].size;
+        const vk::DeviceSize newBlockSize = std::max(std::min(blockSize, alignUp(heapSize / 8, nonCoherentAtomSize)), alignUp(size, nonCoherentAtomSize));
+        Block* block = createBlock(memoryTypeIndex, newBlockSize, linear, false);
+        allocateFromBlock(*block, size, alignment, allocation);
+        return allocation;
+    }
+
+    Allocation MemoryAllocator::allocateBufferMemory(vk::Buffer buffer, vk::MemoryPropertyFlags properties)
+    {
+        Allocation allocation = allocate(device.getBufferMemoryRequirements(buffer), properties, true);
+        device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+        return allocation;
+    }
+
+    Allocation MemoryAllocator::allocateImageMemory(vk::Image image, vk::MemoryPropertyFlags properties, vk::ImageTiling tiling)
+    {
+        Allocation allocation = allocate(device.getImageMemoryRequirements(image), properties, tiling == vk::ImageTiling::eLinear);
+        device.bindImageMemory(image, allocation.memory, allocation.offset);
+        return allocation;
+    }
+
+    void MemoryAllocator::free(Allocation& allocation)
+    {
+        if (!allocation) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        Block* block = static_cast<Block*>(allocation.block);
+        assert(block && block->allocationCount > 0);
+
+        // Insert the range at its sorted position and merge it with adjacent free ranges
+        auto& ranges = block->freeRanges;
+        auto next = std::lower_bound(ranges.begin(), ranges.end(), allocation.offset, [](const Range& range, vk::DeviceSize offset) { return range.offset < offset; });
+        auto it = ranges.insert(next, { allocation.offset, allocation.size });
+        if (std::next(it) != ranges.end() && it->offset + it->size == std::next(it)->offset) {
+            it->size += std::next(it)->size;
+            ranges.erase(std::next(it));
+        }
+        if (it != ranges.begin() && std::prev(it)->offset + std::prev(it)->size == it->offset) {
+            std::prev(it)->size += it->size;
+            ranges.erase(it);
+        }
+
+        block->usedBytes -= allocation.size;
+        block->allocationCount--;
+        allocation = {};
+
+        if (block->allocationCount == 0) {
+            // Keep one empty block per memory type and resource kind around so allocation patterns that repeatedly free and allocate don't hit the driver every time
+            bool otherEmptyBlock = false;
+            for (auto& other : blocks) {
+                if (other.get() != block && other->allocationCount == 0 && !other->dedicated && other->memoryTypeIndex == block->memoryTypeIndex && other->linear == block->linear) {
+                    otherEmptyBlock = true;
+                    break;
+                }
+            }
+            if (block->dedicated || otherEmptyBlock) {
+                destroyBlock(block);
+            }
+        }
+    }
+
+    void MemoryAllocator::flush(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        if (!allocation || isCoherent(allocation.memoryTypeIndex)) {
+            return;
+        }
+        vk::MappedMemoryRange range = getMappedRange(allocation, offset, size);
+        VK_CHECK_RESULT(device.flushMappedMemoryRanges(1, &range));
+    }
+
+    void MemoryAllocator::invalidate(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        if (!allocation || isCoherent(allocation.memoryTypeIndex)) {
+            return;
+        }
+        vk::MappedMemoryRange range = getMappedRange(allocation, offset, size);
+        VK_CHECK_RESULT(device.invalidateMappedMemoryRanges(1, &range));
+    }
+
+    MemoryAllocator::Statistics MemoryAllocator::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Statistics statistics{};
+        for (auto& block : blocks) {
+            addStatistics(*block, statistics);
+        }
+        return statistics;
+    }
+
+    MemoryAllocator::Statistics MemoryAllocator::getStatistics(uint32_t memoryTypeIndex) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Statistics statistics{};
+        for (auto& block : blocks) {
+            if (block->memoryTypeIndex == memoryTypeIndex) {
+                addStatistics(*block, statistics);
+            }
+        }
+        return statistics;
+    }
+
+    void MemoryAllocator::printStatistics(std::ostream& stream) const
+    {
+        const double MiB = 1024.0 * 1024.0;
+        for (uint32_t i = 0; i < vulkanDevice->memoryProperties.memoryTypeCount; ++i) {
+            const Statistics statistics = getStatistics(i);
+            if (statistics.blockCount == 0) {
+                continue;
+            }
+            const vk::MemoryType& memoryType = vulkanDevice->memoryProperties.memoryTypes[i];
+            stream << "Memory type " << i << " (heap " << memoryType.heapIndex << ", " << vk::to_string(memoryType.propertyFlags) << "): "
+                << statistics.blockCount << " blocks, " << statistics.allocationCount << " allocations, "
+                << std::fixed << std::setprecision(2) << (double)statistics.usedBytes / MiB << " / " << (double)statistics.reservedBytes / MiB << " MiB used, "
+                << statistics.freeRangeCount << " free ranges, " << statistics.fragmentation() * 100.0f << "% fragmentation\n";
+        }
+    }
+
+    MemoryAllocator::Block* MemoryAllocator::createBlock(uint32_t memoryTypeIndex, vk::DeviceSize size, bool linear, bool dedicated)
+    {
+        if (blocks.size() >= maxAllocationCount) {
+            throw std::runtime_error("Could not allocate a memory block, maxMemoryAllocationCount has been reached");
+        }
+
+        auto block = std::make_unique<Block>();
+        block->size = size;
+        block->memoryTypeIndex = memoryTypeIndex;
+        block->linear = linear;
+        block->dedicated = dedicated;
+        block->freeRanges.push_back({ 0, size });
+
+        vk::MemoryAllocateInfo memAlloc{};
+        memAlloc.allocationSize = size;
+        memAlloc.memoryTypeIndex = memoryTypeIndex;
+        VK_CHECK_RESULT(device.allocateMemory(&memAlloc, nullptr, &block->memory));
+
+        // Host visible blocks stay mapped, so allocations from them never have to be mapped or unmapped individually
+        if (vulkanDevice->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+            VK_CHECK_RESULT(device.mapMemory(block->memory, 0, VK_WHOLE_SIZE, {}, (void**)&block->mapped));
+        }
+
+        blocks.push_back(std::move(block));
+        return blocks.back().get();
+    }
+
+    void MemoryAllocator::destroyBlock(Block* block)
+    {
+        if (block->mapped) {
+            device.unmapMemory(block->memory);
+        }
+        device.freeMemory(block->memory);
+        blocks.erase(std::find_if(blocks.begin(), blocks.end(), [block](const std::unique_ptr<Block>& b) { return b.get() == block; }));
+    }
+
+    bool MemoryAllocator::allocateFromBlock(Block& block, vk::DeviceSize size, vk::DeviceSize alignment, Allocation& allocation)
+    {
+        // First fit, the padding in front of the aligned offset stays in the free list
+        for (size_t i = 0; i < block.freeRanges.size(); ++i) {
+            const Range range = block.freeRanges[i];
+            const vk::DeviceSize offset = alignUp(range.offset, alignment);
+            const vk::DeviceSize padding = offset - range.offset;
+            if (range.size < padding + size) {
+                continue;
+            }
+
+            const vk::DeviceSize remaining = range.size - padding - size;
+            block.freeRanges.erase(block.freeRanges.begin() + i);
+            if (remaining > 0) {
+                block.freeRanges.insert(block.freeRanges.begin() + i, { offset + size, remaining });
+            }
+            if (padding > 0) {
+                block.freeRanges.insert(block.freeRanges.begin() + i, { range.offset, padding });
+            }
+
+            block.usedBytes += size;
+            block.allocationCount++;
+
+            allocation.memory = block.memory;
+            allocation.offset = offset;
+            allocation.size = size;
+            allocation.memoryTypeIndex = block.memoryTypeIndex;
+            allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+            allocation.block = &block;
+            return true;
+        }
+        return false;
+    }
+
+    bool MemoryAllocator::isCoherent(uint32_t memoryTypeIndex) const
+    {
+        return (vulkanDevice->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent) == vk::MemoryPropertyFlagBits::eHostCoherent;
+    }
+
+    vk::MappedMemoryRange MemoryAllocator::getMappedRange(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size) const
+    {
+        const Block* block = static_cast<const Block*>(allocation.block);
+        const vk::DeviceSize begin = allocation.offset + offset;
+        const vk::DeviceSize end = (size == VK_WHOLE_SIZE) ? allocation.offset + allocation.size : begin + size;
+        assert(end <= allocation.offset + allocation.size);
+
+        // Non-coherent allocations are atom aligned, so the expanded range stays within the allocation
+        vk::MappedMemoryRange range{};
+        range.memory = allocation.memory;
+        range.offset = alignDown(begin, nonCoherentAtomSize);
+        range.size = std::min(alignUp(end, nonCoherentAtomSize), block->size) - range.offset;
+        return range;
+    }
+
+    void MemoryAllocator::addStatistics(const Block& block, Statistics& statistics) const
+    {
+        statistics.blockCount++;
+        statistics.allocationCount += block.allocationCount;
+        statistics.reservedBytes += block.size;
+        statistics.usedBytes += block.usedBytes;
+        statistics.freeRangeCount += (uint32_t)block.freeRanges.size();
+        for (auto& range : block.freeRanges) {
+            statistics.largestFreeRange = std::max(statistics.largestFreeRange, range.size);
+        }
+    }
+}
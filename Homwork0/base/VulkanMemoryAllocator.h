@@ -0,0 +1,147 @@
+/*
+* Device memory sub-allocator
+*
+* Allocates large blocks of device memory per memory type and hands out ranges of these blocks using a free list,
+* so the number of vkAllocateMemory calls stays small (and well below maxMemoryAllocationCount) regardless of the
+* number of resources. Host visible blocks are mapped once for their whole lifetime
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+    struct VulkanDevice;
+
+    /** @brief A range of device memory handed out by the allocator */
+    struct Allocation
+    {
+        vk::DeviceMemory memory{ nullptr };
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        /** @brief Pointer to the start of the allocation if it's host visible, blocks are mapped persistently */
+        uint8_t* mapped = nullptr;
+
+        explicit operator bool() const { return static_cast<bool>(memory); }
+
+    private:
+        friend class MemoryAllocator;
+        // Block the range was taken from, opaque to users of the allocation
+        void* block = nullptr;
+    };
+
+    class MemoryAllocator
+    {
+    public:
+        /** @brief Usage statistics over all blocks (or all blocks of a single memory type) */
+        struct Statistics
+        {
+            /** @brief Number of device memory allocations (blocks) */
+            uint32_t blockCount = 0;
+            /** @brief Number of live sub-allocations */
+            uint32_t allocationCount = 0;
+            /** @brief Bytes of device memory allocated for blocks */
+            vk::DeviceSize reservedBytes = 0;
+            /** @brief Bytes handed out to sub-allocations (alignment padding stays in the free lists) */
+            vk::DeviceSize usedBytes = 0;
+            /** @brief Number of free ranges, a high number relative to the allocation count indicates fragmentation */
+            uint32_t freeRangeCount = 0;
+            /** @brief Size of the largest free range in any block */
+            vk::DeviceSize largestFreeRange = 0;
+
+            /** @brief 0 if all free memory is contiguous, approaches 1 the more the free memory is split into small ranges */
+            float fragmentation() const;
+        };
+
+        /**
+        * @param vulkanDevice Device to allocate memory from, the logical device must have been created
+        * @param blockSize (Optional) Default size of the blocks allocated from device memory, smaller heaps use smaller blocks
+        */
+        explicit MemoryAllocator(vks::VulkanDevice* vulkanDevice, vk::DeviceSize blockSize = 64 * 1024 * 1024);
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator&) = delete;
+        MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+        /**
+        * Sub-allocate memory
+        *
+        * @param memReqs Memory requirements of the resource
+        * @param properties Memory properties the memory type must have
+        * @param linear True for buffers and linear images, false for optimal tiling images (kept in separate blocks to satisfy bufferImageGranularity)
+        *
+        * @return Allocation, requests larger than half the block size get a block of their own
+        */
+        Allocation allocate(const vk::MemoryRequirements& memReqs, vk::MemoryPropertyFlags properties, bool linear);
+
+        /** @brief Allocates memory for a buffer and binds it */
+        Allocation allocateBufferMemory(vk::Buffer buffer, vk::MemoryPropertyFlags properties);
+
+        /** @brief Allocates memory for an image and binds it */
+        Allocation allocateImageMemory(vk::Image image, vk::MemoryPropertyFlags properties, vk::ImageTiling tiling = vk::ImageTiling::eOptimal);
+
+        /** @brief Returns the range to the free list of its block, resets the allocation */
+        void free(Allocation& allocation);
+
+        /** @brief Makes host writes to a range of a non-coherent allocation visible to the device (no-op for coherent memory) */
+        void flush(const Allocation& allocation, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+
+        /** @brief Makes device writes to a range of a non-coherent allocation visible to the host (no-op for coherent memory) */
+        void invalidate(const Allocation& allocation, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+
+        /** @brief Statistics over all memory types */
+        Statistics getStatistics() const;
+
+        /** @brief Statistics for a single memory type */
+        Statistics getStatistics(uint32_t memoryTypeIndex) const;
+
+        /** @brief Writes a per memory type usage summary */
+        void printStatistics(std::ostream& stream) const;
+
+    private:
+        struct Range
+        {
+            vk::DeviceSize offset;
+            vk::DeviceSize size;
+        };
+
+        struct Block
+        {
+            vk::DeviceMemory memory{ nullptr };
+            vk::DeviceSize size = 0;
+            uint32_t memoryTypeIndex = 0;
+            bool linear = true;
+            // Blocks holding a single large resource are freed as soon as that resource is freed
+            bool dedicated = false;
+            uint8_t* mapped = nullptr;
+            vk::DeviceSize usedBytes = 0;
+            uint32_t allocationCount = 0;
+            // Free ranges sorted by offset, adjacent ranges are always merged
+            std::vector<Range> freeRanges;
+        };
+
+        vks::VulkanDevice* vulkanDevice;
+        vk::Device device;
+        vk::DeviceSize blockSize;
+        vk::DeviceSize nonCoherentAtomSize;
+        uint32_t maxAllocationCount;
+        std::vector<std::unique_ptr<Block>> blocks;
+        mutable std::mutex mutex;
+
+        Block* createBlock(uint32_t memoryTypeIndex, vk::DeviceSize size, bool linear, bool dedicated);
+        void destroyBlock(Block* block);
+        bool allocateFromBlock(Block& block, vk::DeviceSize size, vk::DeviceSize alignment, Allocation& allocation);
+        bool isCoherent(uint32_t memoryTypeIndex) const;
+        vk::MappedMemoryRange getMappedRange(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size) const;
+        void addStatistics(const Block& block, Statistics& statistics) const;
+    };
+}
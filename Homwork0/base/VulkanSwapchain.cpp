@@ -116,7 +116,7 @@ void VulkanSwapchain::setContext(vk::Instance instance, vk::PhysicalDevice physi
     this->device = device;
 }
 
-void VulkanSwapchain::create(uint32_t& width, uint32_t& height, bool vsync, bool fullscreen)
+void VulkanSwapchain::create(uint32_t& width, uint32_t& height, bool vsync, bool fullscreen, Retired* retired)
 {
     assert(physicalDevice);
     assert(device);
@@ -152,9 +152,25 @@ void VulkanSwapchain::create(uint32_t& width, uint32_t& height, bool vsync, bool
     // This mode waits for the vertical blank ("v-sync")
     vk::PresentModeKHR swapchainPresentMode = vk::PresentModeKHR::eFifo;
 
+    // An explicitly requested present mode takes precedence, if the surface doesn't support it we fall back to the default selection
+    bool presentModeSelected = false;
+    if (requestedPresentMode.has_value())
+    {
+        if (std::find(presentModes.begin(), presentModes.end(), *requestedPresentMode) != presentModes.end())
+        {
+            swapchainPresentMode = *requestedPresentMode;
+            presentModeSelected = true;
+        }
+        else
+        {
+            std::cerr << "Present mode " << vk::to_string(*requestedPresentMode) << " is not supported by the surface, using the default present mode\n";
+            requestedPresentMode.reset();
+        }
+    }
+
     // If v-sync is not requested, try to find a mailbox mode
     // It's the lowest latency non-tearing present mode available
-    if (!vsync)
+    if (!vsync && !presentModeSelected)
     {
         for (size_t i = 0; i < presentModes.size(); ++i)
         {
@@ -170,8 +186,15 @@ void VulkanSwapchain::create(uint32_t& width, uint32_t& height, bool vsync, bool
         }
     }
 
+    presentMode = swapchainPresentMode;
+
     // Determine the number of images
+    // More images let the application run further ahead of the display (mailbox, fifo), at the cost of latency
     uint32_t desiredNumberOfSwapchainImages = surfCaps.minImageCount + 1;
+    if (requestedImageCount > 0)
+    {
+        desiredNumberOfSwapchainImages = std::max(requestedImageCount, surfCaps.minImageCount);
+    }
     if (surfCaps.maxImageCount > 0 && desiredNumberOfSwapchainImages > surfCaps.maxImageCount)
     {
         desiredNumberOfSwapchainImages = surfCaps.maxImageCount;
@@ -236,13 +259,18 @@ void VulkanSwapchain::create(uint32_t& width, uint32_t& height, bool vsync, bool
     }
 
     VK_CHECK_RESULT(device.createSwapchainKHR(&swapchainCI, nullptr, &swapchain));
+    imageUsage = swapchainCI.imageUsage;
 
     // If an existing swap chain is re-created, destroy the old swap chain and the ressources owned by the application (image views, images are owned by the swap chain)
+    // Frames still in flight may use them, so the caller can take them over and destroy them later instead
     if (oldSwapchain != nullptr) {
-        for (auto i = 0; i < images.size(); ++i) {
-            device.destroyImageView(imageViews[i]);
+        Retired old{ oldSwapchain, imageViews };
+        if (retired) {
+            *retired = std::move(old);
+        }
+        else {
+            destroyRetired(old);
         }
-        device.destroySwapchainKHR(oldSwapchain);
     }
 
     // Get the swap chain images
@@ -272,6 +300,32 @@ void VulkanSwapchain::create(uint32_t& width, uint32_t& height, bool vsync, bool
     }
 }
 
+void VulkanSwapchain::destroyRetired(Retired& retired)
+{
+    for (auto& imageView : retired.imageViews) {
+        device.destroyImageView(imageView);
+    }
+    device.destroySwapchainKHR(retired.swapchain);
+    retired = {};
+}
+
+bool VulkanSwapchain::presentModeFromString(const std::string& name, vk::PresentModeKHR& mode)
+{
+    static const std::pair<const char*, vk::PresentModeKHR> presentModeNames[] = {
+        { "fifo", vk::PresentModeKHR::eFifo },
+        { "fifo-relaxed", vk::PresentModeKHR::eFifoRelaxed },
+        { "mailbox", vk::PresentModeKHR::eMailbox },
+        { "immediate", vk::PresentModeKHR::eImmediate },
+    };
+    for (auto& [presentModeName, presentMode] : presentModeNames) {
+        if (name == presentModeName) {
+            mode = presentMode;
+            return true;
+        }
+    }
+    return false;
+}
+
 vk::Result VulkanSwapchain::acquireNextImage(vk::Semaphore presentCompleteSemaphore, uint32_t& imageIndex)
 {
     // By setting timeout to UINT64_MAX we will always wait until the next image has been acquired or an actual error is thrown
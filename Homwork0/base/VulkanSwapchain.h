@@ -14,9 +14,12 @@
 #include <string>
 #include <cassert>
 #include <cstdio>
+#include <optional>
 #include <vector>
 
+#if defined(_WIN32)
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #include <vulkan/vulkan.h>
 #include "VulkanTools.h"
 
@@ -43,6 +46,21 @@ public:
     std::vector<vk::Image>     images         {};
     std::vector<vk::ImageView> imageViews     {};
     uint32_t                   queueNodeIndex { UINT32_MAX };
+    /** @brief Usage flags the swapchain images have been created with */
+    vk::ImageUsageFlags        imageUsage     {};
+    /** @brief Present mode selected by the last call to create */
+    vk::PresentModeKHR         presentMode    { vk::PresentModeKHR::eFifo };
+
+    /** @brief Present mode to use, if not set (or not supported by the surface) the mode is chosen based on the vsync argument of create */
+    std::optional<vk::PresentModeKHR> requestedPresentMode {};
+    /** @brief Number of images to request, 0 requests one more than the minimum; clamped to the limits of the surface */
+    uint32_t requestedImageCount { 0 };
+
+    /** @brief Swapchain (and the image views created for its images) replaced by a recreation, still in use by frames in flight */
+    struct Retired {
+        vk::SwapchainKHR           swapchain  { nullptr };
+        std::vector<vk::ImageView> imageViews {};
+    };
 
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
     void initSurface(void* platformHandle, void* platformWindow);
@@ -56,9 +74,23 @@ public:
     *
     * @param width Pointer to the width of the swapchain (may be adjusted to fit the requirements of the swapchain)
     * @param height Pointer to the height of the swapchain (may be adjusted to fit the requirements of the swapchain)
-    * @param vsync (Optional, default = false) Can be used to force vsync-ed rendering (by using VK_PRESENT_MODE_FIFO_KHR as presentation mode)
+    * @param vsync (Optional, default = false) Can be used to force vsync-ed rendering (by using VK_PRESENT_MODE_FIFO_KHR as presentation mode), ignored if a supported requestedPresentMode is set
+    * @param retired (Optional) If set, an existing swapchain is handed over instead of being destroyed right away, so it can be destroyed once the frames using it have finished
+    */
+    void create(uint32_t& width, uint32_t& height, bool vsync = false, bool fullscreen = false, Retired* retired = nullptr);
+
+    /* Destroy a swapchain handed over by create, the device must no longer use it */
+    void destroyRetired(Retired& retired);
+
+    /**
+    * Get the present mode for a name as used on the command line
+    *
+    * @param name One of "fifo", "fifo-relaxed", "mailbox" or "immediate"
+    * @param mode Set to the matching present mode
+    *
+    * @return False if the name doesn't match a present mode
     */
-    void create(uint32_t& width, uint32_t& height, bool vsync = false, bool fullscreen = false);
+    static bool presentModeFromString(const std::string& name, vk::PresentModeKHR& mode);
 
     /**
     * Acquires the next image in the swap chain
@@ -14,6 +14,8 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "FrustumCulling.h"
+
 class Camera
 {
 public:
@@ -84,6 +86,12 @@ public:
 		return zfar;
 	}
 
+	// View frustum of the current matrices in world space, for culling on the CPU
+	vks::Frustum getFrustum() const
+	{
+		return vks::Frustum::fromMatrix(matrices.perspective * matrices.view);
+	}
+
 	void setPerspective(float fov, float aspect, float znear, float zfar)
 	{
 		glm::mat4 currentMatrix = matrices.perspective;
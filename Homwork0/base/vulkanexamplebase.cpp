@@ -17,11 +17,13 @@ VulkanExampleBase::VulkanExampleBase()
     commandLineParser.add("validation", { "-v", "--validation" }, 0, "Enable validation layers");
     commandLineParser.add("validationlog", { "-vl", "--validationlog" }, 0, "Log validation messages to a textfile (validation.txt)");
     commandLineParser.add("vsync", { "-vs", "--vsync" }, 0, "Enable V-Sync");
+    commandLineParser.add("presentmode", { "-pm", "--presentmode" }, 1, "Set the swapchain present mode (fifo, fifo-relaxed, mailbox or immediate)");
+    commandLineParser.add("swapchainimages", { "-si", "--swapchainimages" }, 1, "Number of swapchain images to request (default: surface minimum + 1)");
     commandLineParser.add("fullscreen", { "-f", "--fullscreen" }, 0, "Start in fullscreen mode");
     commandLineParser.add("width", { "-w", "--width" }, 1, "Set window width");
     commandLineParser.add("height", { "-h", "--height" }, 1, "Set window height");
     commandLineParser.add("shaders", { "-s", "--shaders" }, 1, "Select shader type to use (gls, hlsl or slang)");
-    commandLineParser.add("gpuselection", { "-g", "--gpu" }, 1, "Select GPU to run on");
+    commandLineParser.add("gpuselection", { "-g", "--gpu" }, 1, "Select GPU to run on by index or by (part of) its name (default: device with the highest score)");
     commandLineParser.add("gpulist", { "-gl", "--listgpus" }, 0, "Display a list of available Vulkan devices");
     commandLineParser.add("benchmark", { "-b", "--benchmark" }, 0, "Run example in benchmark mode");
     commandLineParser.add("benchmarkwarmup", { "-bw", "--benchwarmup" }, 1, "Set warmup time for benchmark mode in seconds");
@@ -29,6 +31,22 @@ VulkanExampleBase::VulkanExampleBase()
     commandLineParser.add("benchmarkresultfile", { "-bf", "--benchfilename" }, 1, "Set file name for benchmark results");
     commandLineParser.add("benchmarkresultframes", { "-bt", "--benchframetimes" }, 0, "Save frame times to benchmark results file");
     commandLineParser.add("benchmarkframes", { "-bfs", "--benchmarkframes" }, 1, "Only render the given number of frames");
+    commandLineParser.add("headless", { "-hl", "--headless" }, 0, "Render into offscreen images without a window or swapchain");
+    commandLineParser.add("timeline", { "-tl", "--timeline" }, 0, "Pace frames with a timeline semaphore instead of per-frame fences");
+    commandLineParser.add("dynamicresolution", { "-dr", "--dynamicresolution" }, 1, "Render at a dynamically scaled resolution to hold the given GPU frame time in milliseconds");
+    commandLineParser.add("resizestorm", { "-rs", "--resizestorm" }, 1, "Resize to a random size every given number of frames (headless only, for benchmarking swapchain recreation)");
+    commandLineParser.add("framesinflight", { "-fif", "--framesinflight" }, 1, "Number of frames the CPU may work on ahead of the GPU (default: 3)");
+    commandLineParser.add("pipelinecache", { "-pc", "--pipelinecache" }, 1, "Set file name for the persistent pipeline cache");
+    commandLineParser.add("nopipelinecache", { "-npc", "--nopipelinecache" }, 0, "Don't load or save the pipeline cache (cold pipeline compilation)");
+    commandLineParser.add("prerecord", { "-pr", "--prerecord" }, 0, "Record command buffers once and replay them every frame");
+    commandLineParser.add("threads", { "-t", "--threads" }, 1, "Number of secondary command buffers recorded in parallel by the task scheduler (0 = record on the main thread)");
+    commandLineParser.add("workers", { "-wt", "--workers" }, 1, "Number of task scheduler worker threads in addition to the main thread (default: number of cores - 1)");
+    commandLineParser.add("benchscheduler", { "-bs", "--benchscheduler" }, 0, "Measure task scheduler overhead and scaling from 1 to N threads, then exit");
+    commandLineParser.add("benchculling", { "-bc", "--benchculling" }, 0, "Measure CPU frustum culling throughput of the scalar and SIMD kernels and its scaling from 1 to N threads, then exit");
+    commandLineParser.add("hitchthreshold", { "-ht", "--hitchthreshold" }, 1, "Frame time in milliseconds above which a frame is counted as a hitch");
+#if defined(ENABLE_PROFILER)
+    commandLineParser.add("profile", { "-pf", "--profile" }, 1, "Set file name for the CPU profiler trace (Chrome trace format)");
+#endif
 
     commandLineParser.parse(args);
     if (commandLineParser.isSet("help")) {
@@ -40,6 +58,22 @@ VulkanExampleBase::VulkanExampleBase()
         exit(0);
     }
 
+    if (commandLineParser.isSet("benchscheduler")) {
+#if defined(_WIN32)
+        setupConsole("Vulkan example");
+#endif
+        vks::TaskScheduler::runBenchmark(std::max(std::thread::hardware_concurrency(), 1u), std::cout);
+        exit(0);
+    }
+
+    if (commandLineParser.isSet("benchculling")) {
+#if defined(_WIN32)
+        setupConsole("Vulkan example");
+#endif
+        vks::FrustumCulling::runBenchmark(1u << 22, std::max(std::thread::hardware_concurrency(), 1u), std::cout);
+        exit(0);
+    }
+
     if (commandLineParser.isSet("validation")) {
         settings.validation = true;
     }
@@ -48,6 +82,21 @@ VulkanExampleBase::VulkanExampleBase()
         settings.vsync = true;
     }
 
+    if (commandLineParser.isSet("presentmode")) {
+        const std::string presentModeName = commandLineParser.getValueAsString("presentmode", "");
+        vk::PresentModeKHR presentMode;
+        if (VulkanSwapchain::presentModeFromString(presentModeName, presentMode)) {
+            settings.presentMode = presentMode;
+        }
+        else {
+            std::cerr << "Unknown present mode \"" << presentModeName << "\", using the default present mode\n";
+        }
+    }
+
+    if (commandLineParser.isSet("swapchainimages")) {
+        settings.swapchainImages = (uint32_t)std::max(commandLineParser.getValueAsInt("swapchainimages", 0), 0);
+    }
+
     if (commandLineParser.isSet("width")) {
         width = commandLineParser.getValueAsInt("width", width);
     }
@@ -60,6 +109,90 @@ VulkanExampleBase::VulkanExampleBase()
         settings.fullscreen = true;
     }
 
+    if (commandLineParser.isSet("headless")) {
+        settings.headless = true;
+    }
+
+    if (commandLineParser.isSet("hitchthreshold")) {
+        // Frame budgets are rarely whole milliseconds (e.g. 16.7), so the threshold is parsed as a float
+        const float threshold = (float)std::atof(commandLineParser.getValueAsString("hitchthreshold", "").c_str());
+        if (threshold > 0.0f) {
+            timer.setHitchThreshold(threshold);
+        }
+    }
+
+    // Benchmark
+    if (commandLineParser.isSet("benchmark")) {
+        benchmark.active = true;
+        // Message boxes would block unattended benchmark runs
+        vks::tools::errorModeSilent = true;
+    }
+
+    if (commandLineParser.isSet("benchmarkwarmup")) {
+        benchmark.warmup = commandLineParser.getValueAsInt("benchmarkwarmup", benchmark.warmup);
+    }
+
+    if (commandLineParser.isSet("benchmarkruntime")) {
+        benchmark.duration = commandLineParser.getValueAsInt("benchmarkruntime", benchmark.duration);
+    }
+
+    if (commandLineParser.isSet("benchmarkresultfile")) {
+        benchmark.filename = commandLineParser.getValueAsString("benchmarkresultfile", benchmark.filename);
+    }
+
+    if (commandLineParser.isSet("benchmarkresultframes")) {
+        benchmark.outputFrameTimes = true;
+    }
+
+    if (commandLineParser.isSet("benchmarkframes")) {
+        benchmark.outputFrames = commandLineParser.getValueAsInt("benchmarkframes", benchmark.outputFrames);
+    }
+    if (commandLineParser.isSet("framesinflight")) {
+        settings.framesInFlight = (uint32_t)std::max(commandLineParser.getValueAsInt("framesinflight", (int32_t)settings.framesInFlight), 1);
+    }
+    if (commandLineParser.isSet("dynamicresolution")) {
+        const float target = (float)std::atof(commandLineParser.getValueAsString("dynamicresolution", "").c_str());
+        if (target > 0.0f) {
+            settings.dynamicResolution = true;
+            settings.dynamicResolutionTarget = target;
+        }
+    }
+    if (commandLineParser.isSet("resizestorm")) {
+        settings.resizeStormInterval = (uint32_t)std::max(commandLineParser.getValueAsInt("resizestorm", 0), 0);
+    }
+    if (commandLineParser.isSet("timeline")) {
+        settings.timelineSemaphores = true;
+    }
+    if (commandLineParser.isSet("prerecord")) {
+        settings.prerecordCommandBuffers = true;
+    }
+    if (commandLineParser.isSet("threads")) {
+        settings.recordingThreads = (uint32_t)commandLineParser.getValueAsInt("threads", 0);
+    }
+    if (commandLineParser.isSet("workers")) {
+        settings.workerThreads = (uint32_t)commandLineParser.getValueAsInt("workers", (int)settings.workerThreads);
+    }
+    if (commandLineParser.isSet("pipelinecache")) {
+        settings.pipelineCacheFile = commandLineParser.getValueAsString("pipelinecache", settings.pipelineCacheFile);
+    }
+    if (commandLineParser.isSet("nopipelinecache")) {
+        settings.persistentPipelineCache = false;
+    }
+#if defined(ENABLE_PROFILER)
+    if (commandLineParser.isSet("profile")) {
+        settings.profileFile = commandLineParser.getValueAsString("profile", settings.profileFile);
+    }
+    PROFILE_THREAD_NAME("Main");
+#endif
+
+    // Created up front so samples can already use it while loading assets
+    taskScheduler.create(settings.workerThreads);
+
+#if !defined(_WIN32)
+    // Window system integration is only implemented for Windows, other platforms can only render headless
+    settings.headless = true;
+#endif
+
 #if defined(_WIN32)
     // Enable console if validation is active, debug message callback will output to it
     if (this->settings.validation) {
@@ -71,8 +204,23 @@ VulkanExampleBase::VulkanExampleBase()
 
 VulkanExampleBase::~VulkanExampleBase()
 {
+#if defined(ENABLE_PROFILER)
+    // Derived classes have already been destroyed at this point, so the trace includes their cleanup
+    vks::profiler::exportChromeTrace(settings.profileFile);
+#endif
+
     // Clean up Vulkan resources
+    if (pipelineCache) {
+        savePipelineCache();
+        device.destroyPipelineCache(pipelineCache);
+    }
+
+    // The render loop waits for the device to become idle before returning
+    vulkanDevice->deletionQueue.flush();
+
     swapchain.cleanup();
+    headless.cleanup();
+    renderTargets.cleanup();
 
     if (renderPass != nullptr) {
         device.destroyRenderPass(renderPass);
@@ -84,14 +232,22 @@ VulkanExampleBase::~VulkanExampleBase()
 
     device.destroyImageView(depthStencil.view);
     device.destroyImage(depthStencil.image);
-    device.freeMemory(depthStencil.memory);
+    vulkanDevice->memoryAllocator->free(depthStencil.memory);
+
+    gpuTimer.destroy();
+    uploadManager.destroy();
+    threadCommandPools.destroy();
+    taskScheduler.destroy();
 
     // synchronization objects
-    for (uint32_t i = 0; i < MAX_CONCURRENT_FRAMES; ++i) {
+    for (size_t i = 0; i < presentCompleteSemaphores.size(); ++i) {
         device.destroySemaphore(presentCompleteSemaphores[i]);
         device.destroySemaphore(renderCompleteSemaphores[i]);
-        device.destroyFence(waitFences[i]);
     }
+    for (auto& fence : waitFences) {
+        device.destroyFence(fence);
+    }
+    frameTimeline.destroy();
 
     delete vulkanDevice;
 
@@ -100,8 +256,13 @@ VulkanExampleBase::~VulkanExampleBase()
 
 bool VulkanExampleBase::initVulkan()
 {
+    PROFILE_FUNCTION();
     // Create the instance
-    vk::Result result = createInstance();
+    vk::Result result;
+    {
+        PROFILE_SCOPE("createInstance");
+        result = createInstance();
+    }
     if (result != vk::Result::eSuccess) {
         vks::tools::exitFatal("Could not create Vulkan instance : \n" + vks::tools::errorString(result), result);
         return false;
@@ -117,8 +278,14 @@ bool VulkanExampleBase::initVulkan()
     // GPU selection
 
     // Select physical device to be used for the Vulkan example
-    // Defualts to the first device unless specified by command line
-    physicalDevice = physicalDevices[0];
+    // Defaults to the suitable device with the highest score unless specified by command line
+    deviceSelector.create(physicalDevices, apiVersion, !settings.headless);
+    if (commandLineParser.isSet("gpulist")) {
+        deviceSelector.print(std::cout);
+    }
+    const vks::DeviceSelector::Score* selectedDevice = deviceSelector.select(commandLineParser.getValueAsString("gpuselection", ""), explicitDeviceSelection);
+    physicalDevice = selectedDevice->physicalDevice;
+    selectedDeviceIndex = selectedDevice->index;
 
     // Store properties (including limits), features and memory properties of the physical device (so that examples can check against them)
     deviceProperties = physicalDevice.getProperties();
@@ -136,7 +303,29 @@ bool VulkanExampleBase::initVulkan()
     // Derived examples can enable extensions based on the list of supported extensions read from the physical device
     getEnabledExtensions();
 
-    result = vulkanDevice->createLogicalDevice(enabledFeatures, enabledDeviceExtensions, deviceCreatepNextChain);
+    // Vulkan 1.2 features (requested by the example or needed for timeline semaphores) are enabled by putting them in front of the example's own pNext chain
+    void* pNextChain = deviceCreatepNextChain;
+    if (settings.timelineSemaphores) {
+        if (vks::TimelineSemaphore::isSupported(physicalDevice)) {
+            enabledFeatures12.timelineSemaphore = vk::True;
+        }
+        else {
+            std::cerr << "Timeline semaphores are not supported by the selected GPU, falling back to fences\n";
+            settings.timelineSemaphores = false;
+        }
+    }
+    if (enabledFeatures12 != vk::PhysicalDeviceVulkan12Features{}) {
+        enabledFeatures12.pNext = pNextChain;
+        pNextChain = &enabledFeatures12;
+    }
+
+    // Headless rendering does not present, so the swapchain extension is not required (and may not be supported, e.g. by software implementations)
+    {
+        PROFILE_SCOPE("createLogicalDevice");
+        // A transfer queue is requested in addition to graphics and compute, so uploads can run in parallel to rendering
+        result = vulkanDevice->createLogicalDevice(enabledFeatures, enabledDeviceExtensions, pNextChain, !settings.headless,
+            vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+    }
     if (result != vk::Result::eSuccess) {
         vks::tools::exitFatal("Could not create Vulkan device: \n" + vks::tools::errorString(result), result);
         return false;
@@ -145,6 +334,7 @@ bool VulkanExampleBase::initVulkan()
 
     // Get a graphics queue from the device
     queue = device.getQueue(vulkanDevice->queueFamilyIndices.graphics, 0);
+    transferQueue = device.getQueue(vulkanDevice->queueFamilyIndices.transfer, 0);
 
     // Find a suitable depth and/or stencil format
     vk::Bool32 validFormat{ false };
@@ -158,18 +348,53 @@ bool VulkanExampleBase::initVulkan()
     }
     assert(validFormat);
 
-    swapchain.setContext(instance, physicalDevice, device);
- 
+    if (settings.headless) {
+        headless.setContext(vulkanDevice);
+    }
+    else {
+        swapchain.setContext(instance, physicalDevice, device);
+    }
+    renderTargets.setContext(vulkanDevice);
+
     return true;
 }
 
 void VulkanExampleBase::prepare()
 {
-    createSurface();
+    PROFILE_FUNCTION();
+    if (!settings.headless) {
+        createSurface();
+    }
     createSwapchain();
+
+    // Upscaling blits the render targets into the swapchain images, so both need to support blitting (with linear filtering)
+    if (settings.dynamicResolution) {
+        const vk::Format colorFormat = settings.headless ? headless.colorFormat : swapchain.colorFormat;
+        const vk::FormatFeatureFlags requiredFeatures = vk::FormatFeatureFlagBits::eColorAttachment | vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+        const bool formatSupported = (physicalDevice.getFormatProperties(colorFormat).optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+        const bool swapchainSupported = settings.headless || (swapchain.imageUsage & vk::ImageUsageFlagBits::eTransferDst);
+        if (formatSupported && swapchainSupported) {
+            dynamicResolution.create(settings.dynamicResolutionTarget, settings.framesInFlight);
+        }
+        else {
+            std::cerr << "Blitting to the swapchain is not supported, dynamic resolution is disabled\n";
+            settings.dynamicResolution = false;
+        }
+    }
+    updateRenderExtent();
+
     createCommandBuffers();
     createSynchronizationPrimitives();
     createPipelineCache();
+    gpuTimer.create(vulkanDevice, settings.framesInFlight);
+    latencyProbe.create(device, settings.framesInFlight);
+    // With timeline semaphores, uploads signal the frame timeline (from the graphics queue) instead of their own fences
+    uploadManager.create(vulkanDevice, transferQueue, queue, vks::UploadManager::defaultStagingSize, settings.timelineSemaphores ? &frameTimeline : nullptr);
+    if (settings.recordingThreads > 0) {
+        // Recording tasks may run on any scheduler thread, so every thread needs its own pools
+        threadCommandPools.create(device, vulkanDevice->queueFamilyIndices.graphics, taskScheduler.getThreadCount(), settings.framesInFlight);
+    }
+    setupRenderTargets();
     setupDepthStencil();
     setupRenderPass();
     setupFrameBuffer();
@@ -182,6 +407,37 @@ void VulkanExampleBase::renderLoop()
     destWidth = width;
     destHeight = height;
 
+    // Store the pipelines compiled during preparation right away instead of relying on a clean shutdown
+    savePipelineCache();
+
+    if (benchmark.active) {
+        // Statistics gathered during warmup (e.g. hitches caused by first time pipeline use) are not part of the results
+        benchmark.run([this] { nextFrame(); }, vulkanDevice->properties, [this] {
+            timer.resetStatistics();
+            resizeCount = 0;
+            resizeTimeTotal = 0.0;
+            resizeTimeMax = 0.0;
+            dynamicResolution.resetStatistics();
+        });
+        device.waitIdle();
+        addBenchmarkResults();
+        benchmark.saveResults();
+        return;
+    }
+
+    if (settings.headless) {
+        // Without a window there are no messages to process, so frames are rendered back-to-back
+        // The number of frames can be limited via command line, otherwise rendering continues until the process is terminated
+        const int32_t frameLimit = benchmark.outputFrames;
+        for (int32_t frame = 0; frameLimit < 0 || frame < frameLimit; ++frame) {
+            if (prepared) {
+                nextFrame();
+            }
+        }
+        device.waitIdle();
+        return;
+    }
+
 #if defined(_WIN32)
     MSG msg;
     bool quitMessageReceived = false;
@@ -208,12 +464,16 @@ void VulkanExampleBase::renderLoop()
 
 vk::Result VulkanExampleBase::createInstance()
 {
-    std::vector<const char*> instanceExtensions = { VK_KHR_SURFACE_EXTENSION_NAME };
+    std::vector<const char*> instanceExtensions;
 
-    // Enable surface extensions depending on os
+    // Surface extensions are only required when presenting to a window
+    if (!settings.headless) {
+        instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        // Enable surface extensions depending on os
 #if defined(_WIN32)
-    instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+        instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #endif
+    }
 
     // Get extensions supported by the instance and store for later use
     auto extensions = vk::enumerateInstanceExtensionProperties();
@@ -236,6 +496,11 @@ vk::Result VulkanExampleBase::createInstance()
         }
     }
 
+    // Timeline semaphores are core in Vulkan 1.2
+    if (settings.timelineSemaphores && (apiVersion < VK_API_VERSION_1_2)) {
+        apiVersion = VK_API_VERSION_1_2;
+    }
+
     // Shaders generated by Slang require a certain SPIR-V environment that can't be satisfied by Vulkan 1.0, so we need to expliclity up that to at least 1.1 and enable some required extensions
     if (shaderDir == "slang") {
         if (apiVersion < VK_API_VERSION_1_1) {
@@ -301,6 +566,7 @@ vk::Result VulkanExampleBase::createInstance()
 
 void VulkanExampleBase::setupDepthStencil()
 {
+    PROFILE_FUNCTION();
     vk::ImageCreateInfo imageCI{};
     imageCI.imageType   = vk::ImageType::e2D;
     imageCI.format      = depthFormat;
@@ -312,12 +578,7 @@ void VulkanExampleBase::setupDepthStencil()
     imageCI.usage       = vk::ImageUsageFlagBits::eDepthStencilAttachment;
     VK_CHECK_RESULT(device.createImage(&imageCI, nullptr, &depthStencil.image));
 
-    auto memReqs = device.getImageMemoryRequirements(depthStencil.image);
-    vk::MemoryAllocateInfo memAlloc{};
-    memAlloc.allocationSize = memReqs.size;
-    memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-    VK_CHECK_RESULT(device.allocateMemory(&memAlloc, nullptr, &depthStencil.memory));
-    device.bindImageMemory(depthStencil.image, depthStencil.memory, 0);
+    depthStencil.memory = vulkanDevice->memoryAllocator->allocateImageMemory(depthStencil.image, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
     vk::ImageViewCreateInfo imageViewCI{};
     imageViewCI.viewType                        = vk::ImageViewType::e2D;
@@ -337,12 +598,15 @@ void VulkanExampleBase::setupDepthStencil()
 
 void VulkanExampleBase::setupFrameBuffer()
 {
-    // Create frame buffers for every swap chain image
-    frameBuffers.resize(swapchain.images.size());
+    PROFILE_FUNCTION();
+    // Create frame buffers for every swap chain image (or offscreen image in headless mode)
+    // With dynamic resolution, the scene is rendered into the scaled render targets instead, which are blitted to the swap chain images afterwards
+    const std::vector<vk::ImageView>& colorViews = settings.dynamicResolution ? renderTargets.imageViews : (settings.headless ? headless.imageViews : swapchain.imageViews);
+    frameBuffers.resize(colorViews.size());
     for (uint32_t i = 0; i < frameBuffers.size(); ++i)
     {
         const vk::ImageView attachments[2] = {
-            swapchain.imageViews[i],
+            colorViews[i],
             // Depth/Stencil attachment is the same for all frame buffers
             depthStencil.view
         };
@@ -360,17 +624,19 @@ void VulkanExampleBase::setupFrameBuffer()
 
 void VulkanExampleBase::setupRenderPass()
 {
+    PROFILE_FUNCTION();
     std::array<vk::AttachmentDescription, 2> attachments = {};
 
     // Color attachment
-    attachments[0].format         = swapchain.colorFormat;
+    attachments[0].format         = settings.headless ? headless.colorFormat : swapchain.colorFormat;
     attachments[0].samples        = vk::SampleCountFlagBits::e1;
     attachments[0].loadOp         = vk::AttachmentLoadOp::eClear;
     attachments[0].storeOp        = vk::AttachmentStoreOp::eStore;
     attachments[0].stencilLoadOp  = vk::AttachmentLoadOp::eDontCare;
     attachments[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
     attachments[0].initialLayout  = vk::ImageLayout::eUndefined;
-    attachments[0].finalLayout    = vk::ImageLayout::ePresentSrcKHR;
+    // Headless images are never presented, they are left ready to be copied from instead (as are render targets, which are blitted to the output image)
+    attachments[0].finalLayout    = (settings.headless || settings.dynamicResolution) ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
 
     // Depth attachment
     attachments[1].format         = depthFormat;
@@ -442,43 +708,40 @@ void VulkanExampleBase::windowResize()
         return;
     }
 
+    PROFILE_FUNCTION();
+
     prepared = false;
     resized = true;
+    const auto tStart = std::chrono::high_resolution_clock::now();
 
-    // Ensure all operations on the device have been finished before destroying resources
-    device.waitIdle();
-
-    // Recreate swap chain
+    // Frames in flight may still use the swap chain, depth buffer and frame buffers, so instead of waiting for the device to become idle,
+    // new ones are created right away and the old ones are retired and destroyed once those frames have finished
     width = destWidth;
     height = destHeight;
     createSwapchain();
 
-    // Recreate the frame buffers
-    device.destroyImageView(depthStencil.view);
-    device.destroyImage(depthStencil.image);
-    device.freeMemory(depthStencil.memory);
-    setupDepthStencil();
-
-    for (auto& frameBuffer : frameBuffers) {
-        device.destroyFramebuffer(frameBuffer);
+    auto oldDepthStencil = depthStencil;
+    std::vector<vk::Framebuffer> oldFrameBuffers = std::move(frameBuffers);
+    vks::DeletionQueue& deletionQueue = vulkanDevice->deletionQueue;
+    for (auto& frameBuffer : oldFrameBuffers) {
+        deletionQueue.push(frameBuffer);
     }
+    deletionQueue.push(oldDepthStencil.view);
+    deletionQueue.push(oldDepthStencil.image);
+    deletionQueue.push(oldDepthStencil.memory);
+    updateRenderExtent();
+    setupRenderTargets();
+    setupDepthStencil();
     setupFrameBuffer();
 
-    // TODO
-
-    // Command buffers need to be recreated as they may store
-    // references to the recreated frame buffer
-    destroyCommandBuffers();
-    createCommandBuffers();
+    // Per-frame command buffers are re-recorded every frame and the synchronization primitives don't depend on the swap chain, so they're kept
+    // Samples with prerecorded command buffers referencing the frame buffers rebuild them (retiring the old ones)
     buildCommandBuffers();
 
-    // SRS - Recreate fences in case number of swapchain images has changed on resize
-    for (auto& fence : waitFences) {
-        device.destroyFence(fence);
-    }
-    createSynchronizationPrimitives();
-
-    device.waitIdle();
+    const double resizeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    resizeCount++;
+    resizeTimeTotal += resizeTime;
+    resizeTimeMax = std::max(resizeTimeMax, resizeTime);
 
     if (width > 0.0f && height > 0.0f) {
         camera.updateAspectRatio((float)width / height);
@@ -664,6 +927,12 @@ void VulkanExampleBase::handleMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
         case KEY_F1:
             // TODO
             break;
+#if defined(ENABLE_PROFILER)
+        case KEY_F3:
+            // Capture the trace on demand without having to exit
+            vks::profiler::exportChromeTrace(settings.profileFile);
+            break;
+#endif
         case KEY_F2:
             if (camera.type == Camera::CameraType::lookat) {
                 camera.type = Camera::CameraType::firstperson;
@@ -788,7 +1057,25 @@ void VulkanExampleBase::createSurface()
 
 void VulkanExampleBase::createSwapchain()
 {
-    swapchain.create(width, height, settings.vsync, settings.fullscreen);
+    PROFILE_FUNCTION();
+    if (settings.headless) {
+        // One offscreen image per frame in flight, so the fence of a frame slot also guards its image
+        auto retired = std::make_shared<VulkanHeadless::Retired>();
+        headless.create(width, height, settings.framesInFlight, retired.get());
+        if (!retired->images.empty()) {
+            vulkanDevice->deletionQueue.push([this, retired]() { headless.destroyRetired(*retired); });
+        }
+    }
+    else {
+        // The old swap chain is passed to the new one (oldSwapchain), so images it already acquired can still be presented
+        auto retired = std::make_shared<VulkanSwapchain::Retired>();
+        swapchain.requestedPresentMode = settings.presentMode;
+        swapchain.requestedImageCount = settings.swapchainImages;
+        swapchain.create(width, height, settings.vsync, settings.fullscreen, retired.get());
+        if (retired->swapchain) {
+            vulkanDevice->deletionQueue.push([this, retired]() { swapchain.destroyRetired(*retired); });
+        }
+    }
 }
 
 void VulkanExampleBase::createCommandBuffers()
@@ -796,41 +1083,204 @@ void VulkanExampleBase::createCommandBuffers()
     vk::CommandBufferAllocateInfo cmdBufAllocateInfo = {};
     cmdBufAllocateInfo.commandPool = vulkanDevice->commandPool;
     cmdBufAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
-    cmdBufAllocateInfo.commandBufferCount = MAX_CONCURRENT_FRAMES;
+    cmdBufAllocateInfo.commandBufferCount = settings.framesInFlight;
+    commandBuffers.resize(settings.framesInFlight);
     VK_CHECK_RESULT(device.allocateCommandBuffers(&cmdBufAllocateInfo, commandBuffers.data()));
-}
-
-void VulkanExampleBase::destroyCommandBuffers()
-{
-    device.freeCommandBuffers(vulkanDevice->commandPool, commandBuffers);
+    if (settings.dynamicResolution) {
+        upscaleCommandBuffers.resize(settings.framesInFlight);
+        VK_CHECK_RESULT(device.allocateCommandBuffers(&cmdBufAllocateInfo, upscaleCommandBuffers.data()));
+    }
 }
 
 void VulkanExampleBase::createSynchronizationPrimitives()
 {
-    for (uint32_t i = 0; i < MAX_CONCURRENT_FRAMES; ++i) {
+    frameSlotFrames.assign(settings.framesInFlight, 0);
+    presentCompleteSemaphores.resize(settings.framesInFlight);
+    renderCompleteSemaphores.resize(settings.framesInFlight);
+    if (settings.timelineSemaphores) {
+        frameTimeline.create(device);
+        frameTimelineValues.assign(settings.framesInFlight, 0);
+    }
+    else {
+        waitFences.resize(settings.framesInFlight);
+    }
+    for (uint32_t i = 0; i < settings.framesInFlight; ++i) {
         // Semaphores are used for correct command ordering within a queue
         vk::SemaphoreCreateInfo semaphoreCI = {};
         // Semaphore used to ensure that image presentation is complete before starting to submit again
         VK_CHECK_RESULT(device.createSemaphore(&semaphoreCI, nullptr, &presentCompleteSemaphores[i]));
         // Semaphore used to ensure that all commands submitted have been finished before submitting the image to the queue
         VK_CHECK_RESULT(device.createSemaphore(&semaphoreCI, nullptr, &renderCompleteSemaphores[i]));
-        // Fence used to ensure that command buffer has completed execution before using it again
-        vk::FenceCreateInfo fenceCI = {};
-        // Create the fences in signaled state (so we don't wait on first render of each command buffer)
-        fenceCI.flags = vk::FenceCreateFlagBits::eSignaled;
-        VK_CHECK_RESULT(device.createFence(&fenceCI, nullptr, &waitFences[i]));
+        if (!settings.timelineSemaphores) {
+            // Fence used to ensure that command buffer has completed execution before using it again
+            vk::FenceCreateInfo fenceCI = {};
+            // Create the fences in signaled state (so we don't wait on first render of each command buffer)
+            fenceCI.flags = vk::FenceCreateFlagBits::eSignaled;
+            VK_CHECK_RESULT(device.createFence(&fenceCI, nullptr, &waitFences[i]));
+        }
     }
 }
 
 void VulkanExampleBase::createPipelineCache()
 {
+    PROFILE_FUNCTION();
+    // Seed the cache with the data saved by a previous run, so pipelines don't have to be compiled from scratch
+    std::vector<uint8_t> cacheData;
+    if (settings.persistentPipelineCache) {
+        std::ifstream file(settings.pipelineCacheFile, std::ios::binary | std::ios::ate);
+        if (file.is_open()) {
+            cacheData.resize((size_t)file.tellg());
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(cacheData.data()), cacheData.size());
+            if (!file || !isPipelineCacheCompatible(cacheData)) {
+                std::cout << "Pipeline cache \"" << settings.pipelineCacheFile << "\" is invalid or was created for a different device or driver, starting with an empty cache\n";
+                cacheData.clear();
+            }
+        }
+    }
+
     vk::PipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-    VK_CHECK_RESULT(device.createPipelineCache(&pipelineCacheCreateInfo, nullptr, &pipelineCache));
+    pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+    pipelineCacheCreateInfo.pInitialData = cacheData.data();
+    vk::Result result = device.createPipelineCache(&pipelineCacheCreateInfo, nullptr, &pipelineCache);
+    if (result != vk::Result::eSuccess && !cacheData.empty()) {
+        // Implementations may still reject data that passed the header check, fall back to an empty cache
+        pipelineCacheCreateInfo.initialDataSize = 0;
+        pipelineCacheCreateInfo.pInitialData = nullptr;
+        cacheData.clear();
+        result = device.createPipelineCache(&pipelineCacheCreateInfo, nullptr, &pipelineCache);
+    }
+    VK_CHECK_RESULT(result);
+    pipelineCacheSavedSize = cacheData.size();
+}
+
+bool VulkanExampleBase::isPipelineCacheCompatible(const std::vector<uint8_t>& data) const
+{
+    // The cache data starts with a header identifying the device and driver it was created with (see VkPipelineCacheHeaderVersionOne)
+    vk::PipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    return header.headerSize >= sizeof(header)
+        && header.headerVersion == vk::PipelineCacheHeaderVersion::eOne
+        && header.vendorID == deviceProperties.vendorID
+        && header.deviceID == deviceProperties.deviceID
+        && memcmp(header.pipelineCacheUUID.data(), deviceProperties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+void VulkanExampleBase::savePipelineCache()
+{
+    if (!settings.persistentPipelineCache || !pipelineCache) {
+        return;
+    }
+    PROFILE_FUNCTION();
+
+    // Pipeline caches only grow, so an unchanged size means no new pipelines have been added
+    size_t dataSize = 0;
+    VK_CHECK_RESULT(device.getPipelineCacheData(pipelineCache, &dataSize, nullptr));
+    if (dataSize == 0 || dataSize == pipelineCacheSavedSize) {
+        return;
+    }
+    std::vector<uint8_t> cacheData(dataSize);
+    VK_CHECK_RESULT(device.getPipelineCacheData(pipelineCache, &dataSize, cacheData.data()));
+
+    // Write to a temporary file first and then replace the old cache, so an interrupted write never leaves a truncated cache behind
+    const std::string tempFile = settings.pipelineCacheFile + ".tmp";
+    {
+        std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Could not write pipeline cache to \"" << tempFile << "\"\n";
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(cacheData.data()), dataSize);
+        if (!file.flush()) {
+            std::cerr << "Could not write pipeline cache to \"" << tempFile << "\"\n";
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempFile, settings.pipelineCacheFile, error);
+    if (error) {
+        std::cerr << "Could not replace pipeline cache \"" << settings.pipelineCacheFile << "\": " << error.message() << "\n";
+        std::filesystem::remove(tempFile, error);
+        return;
+    }
+    pipelineCacheSavedSize = dataSize;
 }
 
 std::string VulkanExampleBase::getWindowTitle() const
 {
-    return title;
+    std::string windowTitle = title + " - " + std::string(deviceProperties.deviceName.data());
+
+    const Timer::Statistics statistics = timer.getStatistics();
+    if (settings.overlay && (statistics.samples > 0)) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), " - %u fps | p50 %.2f ms | p99 %.2f ms | max %.2f ms | gpu %.2f ms | %u hitches", timer.getFPS(), statistics.p50, statistics.p99, statistics.max, timer.getGpuStatistics().p50, timer.getHitchCount());
+        windowTitle += buffer;
+        if (settings.dynamicResolution) {
+            snprintf(buffer, sizeof(buffer), " | %ux%u", renderExtent.width, renderExtent.height);
+            windowTitle += buffer;
+        }
+    }
+
+    return windowTitle;
+}
+
+void VulkanExampleBase::addBenchmarkResults()
+{
+    const vks::DeviceSelector::Score& deviceScore = deviceSelector.getScores()[selectedDeviceIndex];
+    benchmark.addResult("device index", deviceScore.index);
+    benchmark.addResult("device selection", explicitDeviceSelection ? "explicit" : "score");
+    benchmark.addResult("device score", deviceScore.total());
+    benchmark.addResult("device score type", deviceScore.typeScore);
+    benchmark.addResult("device score memory", deviceScore.memoryScore);
+    benchmark.addResult("device score queues", deviceScore.queueScore);
+    benchmark.addResult("device score api", deviceScore.apiScore);
+    benchmark.addResult("frames in flight", settings.framesInFlight);
+    benchmark.addResult("frame pacing", settings.timelineSemaphores ? "timeline semaphore" : "fences");
+    if (!settings.headless) {
+        benchmark.addResult("present mode", vk::to_string(swapchain.presentMode));
+        benchmark.addResult("swapchain images", swapchain.images.size());
+    }
+    benchmark.addResult("resizes", resizeCount);
+    benchmark.addResult("resize avg (ms)", (resizeCount > 0) ? resizeTimeTotal / (double)resizeCount : 0.0);
+    benchmark.addResult("resize max (ms)", resizeTimeMax);
+    if (settings.dynamicResolution) {
+        benchmark.addResult("dynamic resolution target (ms)", dynamicResolution.getTargetFrameTime());
+        benchmark.addResult("render scale", dynamicResolution.getScale());
+        benchmark.addResult("render scale min", dynamicResolution.getLowestScale());
+        benchmark.addResult("render scale changes", dynamicResolution.getChangeCount());
+    }
+    benchmark.addResult("hitch threshold (ms)", timer.getHitchThreshold());
+    benchmark.addResult("hitches", timer.getHitchCount());
+
+    const vks::MemoryAllocator::Statistics memoryStatistics = vulkanDevice->memoryAllocator->getStatistics();
+    benchmark.addResult("memory blocks", memoryStatistics.blockCount);
+    benchmark.addResult("memory allocations", memoryStatistics.allocationCount);
+    benchmark.addResult("memory used (MiB)", (double)memoryStatistics.usedBytes / (1024.0 * 1024.0));
+    benchmark.addResult("memory reserved (MiB)", (double)memoryStatistics.reservedBytes / (1024.0 * 1024.0));
+    benchmark.addResult("memory fragmentation (%)", memoryStatistics.fragmentation() * 100.0f);
+
+    // Frame time histogram, empty buckets are omitted
+    const auto& histogram = timer.getHistogram();
+    const float bucketWidth = timer.getHistogramBucketWidth();
+    for (uint32_t i = 0; i < Timer::histogramBuckets; ++i) {
+        if (histogram[i] == 0) {
+            continue;
+        }
+        std::ostringstream name;
+        name << std::fixed << std::setprecision(1) << "histogram " << (float)i * bucketWidth << "-";
+        if (i < Timer::histogramBuckets - 1) {
+            name << (float)(i + 1) * bucketWidth << " ms";
+        }
+        else {
+            name << "inf ms";
+        }
+        benchmark.addResult(name.str(), histogram[i]);
+    }
+
+    getBenchmarkResults(benchmark);
 }
 
 void VulkanExampleBase::handleMouseMove(int32_t x, int32_t y)
@@ -864,8 +1314,244 @@ void VulkanExampleBase::handleMouseMove(int32_t x, int32_t y)
     mouseState.position = glm::vec2((float)x, (float)y);
 }
 
+bool VulkanExampleBase::prepareFrame()
+{
+    PROFILE_FUNCTION();
+    // Frames that finished while the CPU was busy are stamped before blocking, so their latency doesn't include the wait below
+    collectFrameLatencies();
+
+    // Use a fence to wait until the command buffer has finished execution before using it again
+    // With timeline semaphores, the frame waits for the value signaled by the last frame that used this slot (framesInFlight frames ago) instead
+    {
+        PROFILE_SCOPE("waitForFrameFence");
+        if (settings.timelineSemaphores) {
+            frameTimeline.wait(frameTimelineValues[currentFrame]);
+        }
+        else {
+            VK_CHECK_RESULT(device.waitForFences(1, &waitFences[currentFrame], vk::True, UINT64_MAX));
+        }
+    }
+    collectFrameLatency(currentFrame);
+
+    // Frames finish in submission order, so all frames up to the last one submitted with this slot have finished
+    completedFrames = std::max(completedFrames, frameSlotFrames[currentFrame]);
+    vulkanDevice->deletionQueue.collect(completedFrames);
+
+    // The fence also guarantees that the timestamps written by the previous use of this frame slot are available
+    if (gpuTimer.collect(currentFrame)) {
+        timer.onGpuFrame(gpuTimer.getFrameTime());
+        benchmark.addGpuFrameTime(gpuTimer.getFrameTime());
+        // Frames recorded from here on use the new scale, prerecorded command buffers contain the render area, viewport and scissor and are rebuilt
+        if (settings.dynamicResolution && dynamicResolution.update(gpuTimer.getFrameTime())) {
+            updateRenderExtent();
+            buildCommandBuffers();
+        }
+    }
+
+    if (settings.headless) {
+        // Offscreen images are used in the same order as the frame slots, the fence above ensures the image is no longer in use
+        currentImageIndex = currentFrame;
+    }
+    else {
+        // Get the next swap chain image from the implementation
+        // Note that the implementation is free to return the images in any order, so we must use the acquire function and can't just cycle through the images/imageIndex on our own
+        vk::Result result = swapchain.acquireNextImage(presentCompleteSemaphores[currentFrame], currentImageIndex);
+        if (result == vk::Result::eErrorOutOfDateKHR) {
+            windowResize();
+            return false;
+        }
+        else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
+            throw std::runtime_error("Could not acquire the next swap chain image");
+        }
+    }
+
+    // Only reset the fence once we know work will be submitted for this frame, otherwise the next wait on it would never return
+    // Timeline values are never reset, so there's nothing to do with timeline semaphores
+    if (!settings.timelineSemaphores) {
+        VK_CHECK_RESULT(device.resetFences(1, &waitFences[currentFrame]));
+    }
+
+    // From here on the CPU works on the new frame (updating uniforms, recording commands)
+    latencyProbe.frameStarted(currentFrame);
+
+    return true;
+}
+
+void VulkanExampleBase::submitFrame(vk::CommandBuffer commandBuffer)
+{
+    PROFILE_FUNCTION();
+    // Pipeline stage at which the queue submission will wait
+    vk::PipelineStageFlags waitStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+
+    // The submit info structure specifies a command buffer queue submission batch
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.pWaitDstStageMask = &waitStageMask;      // Pointer to the list of pipeline stages that the semaphore waits will occur at
+    submitInfo.pCommandBuffers = &commandBuffer;        // Command buffer(s) to execute in this batch (submission)
+    submitInfo.commandBufferCount = 1;
+
+    // With dynamic resolution, a second command buffer upscales the rendered image into the swapchain image
+    // Rendering waits for the acquired image too, as that also orders it after the last blit from the render target of this image
+    std::array<vk::CommandBuffer, 2> submitCommandBuffers{ commandBuffer };
+    if (settings.dynamicResolution) {
+        recordUpscale(upscaleCommandBuffers[currentFrame]);
+        submitCommandBuffers[submitInfo.commandBufferCount++] = upscaleCommandBuffers[currentFrame];
+        submitInfo.pCommandBuffers = submitCommandBuffers.data();
+        waitStageMask |= vk::PipelineStageFlagBits::eTransfer;
+    }
+
+    // Binary semaphores for presentation plus (optionally) the frame timeline, values for binary semaphores are ignored
+    std::array<vk::Semaphore, 2> signalSemaphores{};
+    std::array<uint64_t, 2> signalValues{};
+    if (!settings.headless) {
+        // Semaphore to wait upon before the submitted command buffer starts executing
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
+        // Semaphore to be signaled when command buffers have completed
+        signalSemaphores[submitInfo.signalSemaphoreCount++] = renderCompleteSemaphores[currentFrame];
+    }
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    if (settings.timelineSemaphores) {
+        frameTimelineValues[currentFrame] = frameTimeline.nextValue();
+        signalValues[submitInfo.signalSemaphoreCount] = frameTimelineValues[currentFrame];
+        signalSemaphores[submitInfo.signalSemaphoreCount++] = frameTimeline.semaphore;
+        timelineSubmitInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+        timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+        submitInfo.pNext = &timelineSubmitInfo;
+    }
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    frameSlotFrames[currentFrame] = ++submittedFrames;
+    vulkanDevice->deletionQueue.setSubmittedValue(submittedFrames);
+
+    // Submit to the graphics queue passing a wait fence (or signaling the timeline)
+    if (settings.timelineSemaphores) {
+        VK_CHECK_RESULT(queue.submit(1, &submitInfo, nullptr));
+        latencyProbe.frameSubmitted(currentFrame, frameTimeline.semaphore, frameTimelineValues[currentFrame]);
+    }
+    else {
+        VK_CHECK_RESULT(queue.submit(1, &submitInfo, waitFences[currentFrame]));
+        latencyProbe.frameSubmitted(currentFrame, waitFences[currentFrame]);
+    }
+
+    if (!settings.headless) {
+        // Present the current frame buffer to the swap chain
+        // Pass the semaphore signaled by the command buffer submission from the submit info as the wait semaphore for swap chain presentation
+        // This ensures that the image is not presented to the windowing system until all commands have been submitted
+        vk::Result result = swapchain.queuePresent(queue, currentImageIndex, renderCompleteSemaphores[currentFrame]);
+        // Depending on the present mode and the number of images, present may block until an image becomes available
+        latencyProbe.framePresented(currentFrame);
+        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
+            windowResize();
+        }
+        else if (result != vk::Result::eSuccess) {
+            throw std::runtime_error("Could not present the image to the swap chain");
+        }
+    }
+
+    // Select the next frame to render to, based on the max. no. of concurrent frames
+    currentFrame = (currentFrame + 1) % settings.framesInFlight;
+}
+
+void VulkanExampleBase::setupRenderTargets()
+{
+    if (!settings.dynamicResolution) {
+        return;
+    }
+    PROFILE_FUNCTION();
+    // Render targets have the full output size, lower scales only render to (and blit from) a part of them, so scale changes don't need new images
+    auto retired = std::make_shared<VulkanHeadless::Retired>();
+    renderTargets.colorFormat = settings.headless ? headless.colorFormat : swapchain.colorFormat;
+    renderTargets.create(width, height, settings.headless ? settings.framesInFlight : static_cast<uint32_t>(swapchain.images.size()), retired.get());
+    if (!retired->images.empty()) {
+        vulkanDevice->deletionQueue.push([this, retired]() { renderTargets.destroyRetired(*retired); });
+    }
+}
+
+void VulkanExampleBase::updateRenderExtent()
+{
+    const float scale = settings.dynamicResolution ? dynamicResolution.getScale() : 1.0f;
+    renderExtent.width = std::max(static_cast<uint32_t>((float)width * scale + 0.5f), 1u);
+    renderExtent.height = std::max(static_cast<uint32_t>((float)height * scale + 0.5f), 1u);
+}
+
+void VulkanExampleBase::recordUpscale(vk::CommandBuffer commandBuffer)
+{
+    const vk::Image source = renderTargets.images[currentImageIndex];
+    const vk::Image destination = settings.headless ? headless.images[currentImageIndex] : swapchain.images[currentImageIndex];
+    const vk::ImageSubresourceRange subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+
+    commandBuffer.reset();
+    vk::CommandBufferBeginInfo cmdBufInfo = {};
+    cmdBufInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    VK_CHECK_RESULT(commandBuffer.begin(&cmdBufInfo));
+
+    // The render pass has left the render target in transfer source layout, the blit has to wait for the color writes though
+    // The previous contents of the destination image are discarded
+    std::array<vk::ImageMemoryBarrier, 2> barriers{};
+    barriers[0].srcAccessMask       = vk::AccessFlagBits::eColorAttachmentWrite;
+    barriers[0].dstAccessMask       = vk::AccessFlagBits::eTransferRead;
+    barriers[0].oldLayout           = vk::ImageLayout::eTransferSrcOptimal;
+    barriers[0].newLayout           = vk::ImageLayout::eTransferSrcOptimal;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image               = source;
+    barriers[0].subresourceRange    = subresourceRange;
+    barriers[1].srcAccessMask       = {};
+    barriers[1].dstAccessMask       = vk::AccessFlagBits::eTransferWrite;
+    barriers[1].oldLayout           = vk::ImageLayout::eUndefined;
+    barriers[1].newLayout           = vk::ImageLayout::eTransferDstOptimal;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].image               = destination;
+    barriers[1].subresourceRange    = subresourceRange;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    vk::ImageBlit blitRegion{};
+    blitRegion.srcSubresource = { vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+    blitRegion.srcOffsets[1]  = vk::Offset3D((int32_t)renderExtent.width, (int32_t)renderExtent.height, 1);
+    blitRegion.dstSubresource = { vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+    blitRegion.dstOffsets[1]  = vk::Offset3D((int32_t)width, (int32_t)height, 1);
+    commandBuffer.blitImage(source, vk::ImageLayout::eTransferSrcOptimal, destination, vk::ImageLayout::eTransferDstOptimal, 1, &blitRegion, vk::Filter::eLinear);
+
+    // Leave the destination in the same layout the render pass would have (headless images are left ready to be copied from)
+    vk::ImageMemoryBarrier presentBarrier{};
+    presentBarrier.srcAccessMask       = vk::AccessFlagBits::eTransferWrite;
+    presentBarrier.dstAccessMask       = {};
+    presentBarrier.oldLayout           = vk::ImageLayout::eTransferDstOptimal;
+    presentBarrier.newLayout           = settings.headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+    presentBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    presentBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    presentBarrier.image               = destination;
+    presentBarrier.subresourceRange    = subresourceRange;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, 0, nullptr, 0, nullptr, 1, &presentBarrier);
+
+    commandBuffer.end();
+}
+
+void VulkanExampleBase::collectFrameLatencies()
+{
+    for (uint32_t i = 0; i < settings.framesInFlight; ++i) {
+        collectFrameLatency(i);
+    }
+}
+
+void VulkanExampleBase::collectFrameLatency(uint32_t frameIndex)
+{
+    if (latencyProbe.collect(frameIndex)) {
+        const vks::LatencyProbe::Sample& sample = latencyProbe.getSample();
+        benchmark.addLatency(sample.completion);
+        benchmark.addSubmitLatency(sample.submit);
+        if (sample.presented) {
+            benchmark.addPresentLatency(sample.present);
+        }
+    }
+}
+
 void VulkanExampleBase::nextFrame()
 {
+    PROFILE_FUNCTION();
     timer.onFrameStart();
 
     if (viewUpdated)
@@ -873,10 +1559,25 @@ void VulkanExampleBase::nextFrame()
         viewUpdated = false;
     }
 
+    // Resize storm: synthetic resize events in between frames, like a window being dragged (only headless targets can take arbitrary sizes)
+    if (settings.headless && (settings.resizeStormInterval > 0) && (++framesSinceResize >= settings.resizeStormInterval)) {
+        framesSinceResize = 0;
+        destWidth = std::uniform_int_distribution<uint32_t>(64, 1920)(resizeRandom);
+        destHeight = std::uniform_int_distribution<uint32_t>(64, 1080)(resizeRandom);
+        windowResize();
+    }
+
     render();
 
     timer.onFrameStop();
 
+#if defined(_WIN32)
+    // Frame statistics are shown in the window title and refreshed once per second
+    if (!settings.headless && timer.fpsUpdated()) {
+        SetWindowText(window, getWindowTitle().c_str());
+    }
+#endif
+
     camera.update(timer.getFrameTime());
     if (camera.moving())
     {
@@ -28,7 +28,12 @@
 #include <iostream>
 #include <random>
 #include <algorithm>
+#include <iomanip>
+#include <sstream>
 #include <sys/stat.h>
+#include <filesystem>
+#include <fstream>
+#include <optional>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -41,21 +46,30 @@
 #include <numeric>
 #include <array>
 
+#if defined(_WIN32)
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #include <vulkan/vulkan.hpp>
 
 #include "keycodes.h"
 #include "camera.h"
 #include "CommandLineParser.h"
 #include "Timer.h"
+#include "Benchmark.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
 #include "VulkanTools.h"
 #include "VulkanDevice.h"
 #include "VulkanSwapchain.h"
-
-// We want to keep GPU and CPU busy. To do that we may start building a new command buffer while the previous one is still being executed
-// This number defines how many frames may be worked on simultaneously at once
-// Increasing this number may improve performance but will also introduce additional latency
-#define MAX_CONCURRENT_FRAMES 3
+#include "VulkanHeadless.h"
+#include "UniformRing.h"
+#include "UploadManager.h"
+#include "CommandPoolSet.h"
+#include "TaskScheduler.h"
+#include "LatencyProbe.h"
+#include "TimelineSemaphore.h"
+#include "DynamicResolution.h"
+#include "DeviceSelector.h"
 
 class VulkanExampleBase
 {
@@ -101,6 +115,9 @@ public:
     /** @brief (Virtual) Called after the physical device extensions have been read, can be used to enable extensions based on the supported extension listing*/
     virtual void getEnabledExtensions() {}
 
+    /** @brief (Virtual) Called after a benchmark run, can be used to add example specific results */
+    virtual void getBenchmarkResults(vks::Benchmark& benchmark) {}
+
     /** @brief (Virtual) Called after a key was pressed, can be used to do custom key handling */
     virtual void keyPressed(uint32_t) {}
 
@@ -113,8 +130,17 @@ public:
     /** @brief Entry point for the main render loop */
     void renderLoop();
 
+    /** @brief Waits for the current frame's fence and acquires the next image to render to (from the swapchain or the headless targets) */
+    bool prepareFrame();
+
+    /** @brief Submits the given command buffer for the current frame and presents the acquired image (if not running headless) */
+    void submitFrame(vk::CommandBuffer commandBuffer);
+
     void windowResize();
 
+    /** @brief Writes the pipeline cache to disk if pipelines have been added since it was last loaded or saved */
+    void savePipelineCache();
+
 #if defined(_WIN32)
     virtual void OnHandleMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {}
 #endif
@@ -124,6 +150,9 @@ public:
 
     CommandLineParser commandLineParser;
 
+    /** @brief Runs the example for a fixed duration or number of frames and stores frame time statistics if enabled via command line */
+    vks::Benchmark benchmark;
+
     /** @brief Encapsulated physical and logical vulkan device */
     vks::VulkanDevice* vulkanDevice{};
 
@@ -135,8 +164,41 @@ public:
         bool fullscreen = false;
         /** @brief Set to true if v-sync will be forced for the swapchain */
         bool vsync = false;
+        /** @brief Present mode requested for the swapchain, if not set mailbox (or immediate) is preferred unless v-sync is forced */
+        std::optional<vk::PresentModeKHR> presentMode;
+        /** @brief Number of swapchain images to request, 0 requests one more than the surface's minimum */
+        uint32_t swapchainImages = 0;
         /** @brief Enable UI overlay */
         bool overlay = true;
+        /** @brief Render into offscreen images instead of a swapchain (no window or surface is created) */
+        bool headless = false;
+        /**
+        * @brief Number of frames the CPU may work on while the GPU is still busy with previous ones
+        * More frames in flight keep CPU and GPU busier (throughput) but add up to one frame of latency each
+        */
+        uint32_t framesInFlight = 3;
+        /** @brief Pace frames (and uploads) with a single timeline semaphore instead of one fence per frame slot, requires Vulkan 1.2 */
+        bool timelineSemaphores = false;
+        /** @brief Render the scene into offscreen targets at a resolution scaled to hold dynamicResolutionTarget and upscale it when presenting */
+        bool dynamicResolution = false;
+        /** @brief GPU frame time in milliseconds the dynamic resolution controller aims for */
+        float dynamicResolutionTarget = 16.6f;
+        /** @brief If > 0, a synthetic resize to a random size is done every this many frames (headless only), used to benchmark swapchain recreation */
+        uint32_t resizeStormInterval = 0;
+        /** @brief Record command buffers once per swapchain image and frame slot and replay them instead of recording every frame */
+        bool prerecordCommandBuffers = false;
+        /** @brief Number of secondary command buffers recorded in parallel on the task scheduler, 0 records on the main thread only */
+        uint32_t recordingThreads = 0;
+        /** @brief Number of task scheduler worker threads in addition to the main thread */
+        uint32_t workerThreads = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+        /** @brief Load the pipeline cache from disk at startup and save it on exit */
+        bool persistentPipelineCache = true;
+        /** @brief File the pipeline cache is stored in */
+        std::string pipelineCacheFile = "pipelinecache.bin";
+#if defined(ENABLE_PROFILER)
+        /** @brief File the CPU profiler trace is written to on exit (or when pressing F3) */
+        std::string profileFile = "profile.json";
+#endif
     } settings;
 
     /** @brief State of mouse/touch input */
@@ -158,7 +220,7 @@ public:
     /** @brief Default depth stencil attachment used by the default render pass */
     struct {
         vk::Image image;
-        vk::DeviceMemory memory;
+        vks::Allocation memory;
         vk::ImageView view;
     } depthStencil{};
 
@@ -186,6 +248,9 @@ protected:
     // Handle to the device graphics queue that command buffers are submitted to
     vk::Queue queue{ nullptr };
 
+    // Handle to the queue uploads are submitted to, this is a dedicated transfer queue if the device has one (and the graphics queue otherwise)
+    vk::Queue transferQueue{ nullptr };
+
     // Depth buffer format (selected during Vulkan initialization)
     vk::Format depthFormat{ vk::Format::eUndefined };
 
@@ -207,12 +272,22 @@ protected:
     /** @brief Set of physical device features to be enabled for this example (must be set in the derived constructor) */
     vk::PhysicalDeviceFeatures enabledFeatures{};
 
+    /** @brief Set of Vulkan 1.2 features to be enabled for this example (must be set in getEnabledFeatures, requires apiVersion >= 1.2) */
+    vk::PhysicalDeviceVulkan12Features enabledFeatures12{};
+
     /** @brief Set of layer settings to be enabled for this example (must be set in the derived constructor) */
     std::vector<vk::LayerSettingEXT> enabledLayerSettings;
 
     // List of available frame buffers (same as number of swap chain images)
     std::vector<vk::Framebuffer> frameBuffers;
 
+    // Resolution the scene is rendered at, the same as width and height unless dynamic resolution is enabled
+    // Frame buffers always have the full size, only render area, viewport and scissor have to use the render extent
+    vk::Extent2D renderExtent{};
+
+    // Adjusts the render extent from measured GPU frame times (if enabled with --dynamicresolution)
+    vks::DynamicResolution dynamicResolution;
+
     // Global render pass for frame buffer writes
     vk::RenderPass renderPass{ nullptr };
 
@@ -222,17 +297,24 @@ protected:
     // Wraps the swap chain to present images (framebuffers) to the windowing system
     VulkanSwapchain swapchain;
 
-    // Command buffers used for rendering
-    std::array<vk::CommandBuffer, MAX_CONCURRENT_FRAMES> commandBuffers;
+    // Offscreen images used instead of the swap chain in headless mode
+    VulkanHeadless headless;
+
+    // Command buffers used for rendering, one per frame in flight
+    std::vector<vk::CommandBuffer> commandBuffers;
 
     // Synchronization primitives
     // Synchronization is an important concept of Vulkan that OpenGL mostly hid away. Getting this right is crucial to using Vulkan.
     // Semaphores are used to coordinate operations within the graphics queue and ensure correct command ordering
-    std::array<vk::Semaphore, MAX_CONCURRENT_FRAMES> presentCompleteSemaphores{};
-    std::array<vk::Semaphore, MAX_CONCURRENT_FRAMES> renderCompleteSemaphores{};
+    std::vector<vk::Semaphore> presentCompleteSemaphores;
+    std::vector<vk::Semaphore> renderCompleteSemaphores;
 
     // Fences are used to make sure command buffers aren't rerecorded until they've finished executing
-    std::array<vk::Fence, MAX_CONCURRENT_FRAMES> waitFences{};
+    std::vector<vk::Fence> waitFences;
+
+    // Replaces the fences if timeline semaphores are enabled: every frame signals the next value, and a frame slot can be reused once the value of its previous frame has been reached
+    vks::TimelineSemaphore frameTimeline;
+    std::vector<uint64_t> frameTimelineValues;
 
     /** @brief Optional pNext structure for passing extension structures to device creation */
     void* deviceCreatepNextChain = nullptr;
@@ -242,6 +324,24 @@ protected:
     // Active frame buffer index
     uint32_t currentFrame = 0;
 
+    // Streams buffer and image data to the device through the transfer queue without blocking the render thread
+    vks::UploadManager uploadManager;
+
+    // Work-stealing job system for spreading work like asset loading, culling and command recording across all cores
+    vks::TaskScheduler taskScheduler;
+
+    // Command pools for every scheduler thread and frame slot, tasks only allocate secondary command buffers from the pools of the thread they run on
+    vks::CommandPoolSet threadCommandPools;
+
+    // Timestamp queries measuring the GPU time of each frame, results are read back once a frame slot is reused
+    vks::GpuTimer gpuTimer;
+
+    // Measures the time from the CPU starting a frame until the GPU has finished it
+    vks::LatencyProbe latencyProbe;
+
+    // Index of the swapchain (or headless) image acquired for the current frame
+    uint32_t currentImageIndex = 0;
+
     Camera camera;
 
 private:
@@ -250,9 +350,15 @@ private:
     void createCommandBuffers();
     void createSynchronizationPrimitives();
     void createPipelineCache();
-    void destroyCommandBuffers();
+    bool isPipelineCacheCompatible(const std::vector<uint8_t>& data) const;
+    void collectFrameLatencies();
+    void collectFrameLatency(uint32_t frameIndex);
+    void setupRenderTargets();
+    void updateRenderExtent();
+    void recordUpscale(vk::CommandBuffer commandBuffer);
 
     std::string getWindowTitle() const;
+    void addBenchmarkResults();
     void handleMouseMove(int32_t x, int32_t y);
     void nextFrame();
 
@@ -263,4 +369,30 @@ private:
     uint32_t destHeight{};
 
     std::string shaderDir = "glsl";
+
+    // Size of the pipeline cache data as last loaded or saved, used to skip writing an unchanged cache
+    size_t pipelineCacheSavedSize = 0;
+
+    // Number of frames submitted so far, and the number of the last frame known to have finished on the GPU
+    // These are the values the device's deletion queue is driven with
+    uint64_t submittedFrames = 0;
+    uint64_t completedFrames = 0;
+    // Number of the last frame submitted with each frame slot
+    std::vector<uint64_t> frameSlotFrames;
+
+    // Synthetic resizes of the resize storm benchmark
+    uint32_t framesSinceResize = 0;
+    std::minstd_rand resizeRandom;
+    uint32_t resizeCount = 0;
+    double resizeTimeTotal = 0.0;
+    double resizeTimeMax = 0.0;
+
+    // Scores of all physical devices and the device selected from them (by score or explicitly with --gpu)
+    vks::DeviceSelector deviceSelector;
+    uint32_t selectedDeviceIndex = 0;
+    bool explicitDeviceSelection = false;
+
+    // Offscreen targets the scene is rendered into with dynamic resolution (one per swapchain image), and the command buffers blitting them to the swapchain
+    VulkanHeadless renderTargets;
+    std::vector<vk::CommandBuffer> upscaleCommandBuffers;
 };
\ No newline at end of file
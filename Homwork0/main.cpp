@@ -1,6 +1,8 @@
 #include "triangle.h"
 
 VulkanExampleBase* vulkanExample;
+
+#if defined(_WIN32)
 LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     if (vulkanExample != nullptr)
@@ -15,9 +17,24 @@ int APIENTRY WinMain(_In_ HINSTANCE hInstance, _In_opt_  HINSTANCE hPrevInstance
     for (int32_t i = 0; i < __argc; i++) { VulkanExampleBase::args.push_back(__argv[i]); };
     vulkanExample = new VulkanTriangle();
     vulkanExample->initVulkan();
-    vulkanExample->setupWindow(hInstance, WndProc);
+    if (!vulkanExample->settings.headless) {
+        vulkanExample->setupWindow(hInstance, WndProc);
+    }
     vulkanExample->prepare();
     vulkanExample->renderLoop();
     delete vulkanExample;
     return 0;
-}
\ No newline at end of file
+}
+#else
+// Without window system integration the example always runs headless
+int main(int argc, char* argv[])
+{
+    for (int32_t i = 0; i < argc; i++) { VulkanExampleBase::args.push_back(argv[i]); };
+    vulkanExample = new VulkanTriangle();
+    vulkanExample->initVulkan();
+    vulkanExample->prepare();
+    vulkanExample->renderLoop();
+    delete vulkanExample;
+    return 0;
+}
+#endif
\ No newline at end of file
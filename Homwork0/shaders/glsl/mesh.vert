@@ -0,0 +1,45 @@
+#version 450
+
+// Attributes of all vertex formats are read as floats, packed formats are expanded by the vertex fetch
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inColor;
+// Either a float normal or an octahedral normal in xy (z is 0), selected by the octahedralNormals constant
+layout (location = 2) in vec3 inNormal;
+
+layout (constant_id = 0) const bool octahedralNormals = false;
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projectionMatrix;
+	mat4 modelMatrix;
+	mat4 viewMatrix;
+} ubo;
+
+layout (location = 0) out vec3 outColor;
+
+out gl_PerVertex 
+{
+    vec4 gl_Position;   
+};
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += (n.x >= 0.0) ? -t : t;
+	n.y += (n.y >= 0.0) ? -t : t;
+	return n;
+}
+
+void main() 
+{
+	vec3 normal = octahedralNormals ? decodeOctahedral(inNormal.xy) : inNormal;
+	// Simple headlight shading, vertices without normals (zero normal) are unlit
+	float lighting = 1.0;
+	if (dot(normal, normal) > 0.0) {
+		vec3 viewNormal = normalize(mat3(ubo.viewMatrix * ubo.modelMatrix) * normal);
+		lighting = 0.35 + 0.65 * abs(viewNormal.z);
+	}
+	outColor = inColor * lighting;
+	gl_Position = ubo.projectionMatrix * ubo.viewMatrix * ubo.modelMatrix * vec4(inPos.xyz, 1.0);
+}
@@ -0,0 +1,49 @@
+#version 450
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inColor;
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projectionMatrix;
+	mat4 modelMatrix;
+	mat4 viewMatrix;
+} ubo;
+
+struct Instance
+{
+	vec4 positionScale;
+	vec4 colorRotation;
+};
+
+// Per-instance data is pulled from storage buffers
+layout (std430, binding = 1) readonly buffer Instances
+{
+	Instance instances[];
+};
+
+// Maps gl_InstanceIndex to the instance: the identity for CPU issued draws, the visible instances compacted by the culling pass with GPU culling
+layout (std430, binding = 2) readonly buffer InstanceIndices
+{
+	uint instanceIndices[];
+};
+
+layout (location = 0) out vec3 outColor;
+
+out gl_PerVertex 
+{
+    vec4 gl_Position;   
+};
+
+
+void main() 
+{
+	// Instances are scaled, rotated around the y axis and then moved to their position
+	Instance instance = instances[instanceIndices[gl_InstanceIndex]];
+	float s = sin(instance.colorRotation.w);
+	float c = cos(instance.colorRotation.w);
+	vec3 pos = inPos * instance.positionScale.w;
+	pos = vec3(c * pos.x + s * pos.z, pos.y, -s * pos.x + c * pos.z) + instance.positionScale.xyz;
+	outColor = inColor * instance.colorRotation.rgb;
+	gl_Position = ubo.projectionMatrix * ubo.viewMatrix * ubo.modelMatrix * vec4(pos, 1.0);
+}
@@ -3,12 +3,56 @@
 VulkanTriangle::VulkanTriangle() : VulkanExampleBase()
 {
     title = "Vulkan Example - Basic indexed triangle";
+    // Requested for the instance and required from the physical device, devices not supporting it are skipped when selecting the GPU
+    apiVersion = VK_API_VERSION_1_3;
 
     // Setup a default look-at camera
     camera.type = Camera::CameraType::lookat;
     camera.setPosition(glm::vec3(0.0f, 0.0f, -2.5f));
     camera.setRotation(glm::vec3(0.0f));
     camera.setPerspective(60.0f, (float)width / (float)height, 1.0f, 256.0f);
+
+    commandLineParser.add("objects", { "-o", "--objects" }, 1, "Number of triangles to draw, each with its own uniform data");
+    commandLineParser.add("mesh", { "-m", "--mesh" }, 1, "Load a mesh from a Wavefront OBJ or binary glTF (GLB) file and draw it instead of the triangle");
+    commandLineParser.add("vertexformat", { "-vf", "--vertexformat" }, 1, "Vertex format of the mesh: float (default), half or snorm16 (quantized positions, octahedral normals and 8 bit colors)");
+    commandLineParser.add("stress", { "-st", "--stress" }, 1, "Draw the given number of instances of a procedural mesh instead (vertex throughput stress test)");
+    commandLineParser.add("stresstriangles", { "-stt", "--stresstriangles" }, 1, "Number of triangles of the stress test mesh (default: 256)");
+    commandLineParser.add("stressdraws", { "-std", "--stressdraws" }, 1, "Number of draws the stress test instances are split into (default: 1)");
+    commandLineParser.add("gpuculling", { "-gc", "--gpuculling" }, 0, "Frustum cull the stress test instances in a compute shader and draw them with a single indirect draw");
+    commandLineParser.parse(args);
+    if (commandLineParser.isSet("objects")) {
+        objectCount = (uint32_t)commandLineParser.getValueAsInt("objects", (int32_t)objectCount);
+    }
+    if (commandLineParser.isSet("mesh")) {
+        mesh.filename = commandLineParser.getValueAsString("mesh", "");
+    }
+    if (commandLineParser.isSet("vertexformat")) {
+        const std::string name = commandLineParser.getValueAsString("vertexformat", "float");
+        if (!vks::VertexFormat::fromName(name, mesh.vertexFormat)) {
+            std::cerr << "Unknown vertex format \"" << name << "\", using float\n";
+            vks::VertexFormat::fromName("float", mesh.vertexFormat);
+        }
+    }
+    if (commandLineParser.isSet("stress")) {
+        stress.instanceCount = (uint32_t)std::max(commandLineParser.getValueAsInt("stress", 0), 0);
+    }
+    if (commandLineParser.isSet("stresstriangles")) {
+        stress.trianglesPerMesh = (uint32_t)std::max(commandLineParser.getValueAsInt("stresstriangles", (int32_t)stress.trianglesPerMesh), 1);
+    }
+    if (commandLineParser.isSet("stressdraws")) {
+        stress.drawCount = (uint32_t)std::max(commandLineParser.getValueAsInt("stressdraws", (int32_t)stress.drawCount), 1);
+    }
+    if (stress.instanceCount > 0) {
+        // Draws are distributed over the recording tasks like objects are, every draw covers a range of instances
+        stress.drawCount = std::min(stress.drawCount, stress.instanceCount);
+        objectCount = stress.drawCount;
+        // Support is checked once the GPU has been selected (see getEnabledFeatures)
+        gpuCulling.enabled = commandLineParser.isSet("gpuculling");
+        if (!mesh.filename.empty()) {
+            std::cerr << "The stress test uses its own mesh, ignoring --mesh\n";
+            mesh.filename.clear();
+        }
+    }
 }
 
 VulkanTriangle::~VulkanTriangle()
@@ -21,60 +65,129 @@ VulkanTriangle::~VulkanTriangle()
         device.destroyDescriptorPool(descriptorPool);
         device.destroyDescriptorSetLayout(descriptorSetLayout);
         device.destroyBuffer(vertexBuffer.handle);
-        device.freeMemory(vertexBuffer.memory);
+        vulkanDevice->memoryAllocator->free(vertexBuffer.memory);
         device.destroyBuffer(indexBuffer.handle);
-        device.freeMemory(indexBuffer.memory);
+        vulkanDevice->memoryAllocator->free(indexBuffer.memory);
+        if (stress.instanceBuffer.handle) {
+            device.destroyBuffer(stress.instanceBuffer.handle);
+            vulkanDevice->memoryAllocator->free(stress.instanceBuffer.memory);
+            device.destroyBuffer(stress.instanceIndexBuffer.handle);
+            vulkanDevice->memoryAllocator->free(stress.instanceIndexBuffer.memory);
+        }
+        if (gpuCulling.enabled) {
+            device.destroyPipeline(gpuCulling.pipeline);
+            device.destroyPipelineLayout(gpuCulling.pipelineLayout);
+            device.destroyDescriptorSetLayout(gpuCulling.descriptorSetLayout);
+            device.destroyBuffer(gpuCulling.drawCommandBuffer.handle);
+            vulkanDevice->memoryAllocator->free(gpuCulling.drawCommandBuffer.memory);
+        }
 
-        for (uint32_t i = 0; i < MAX_CONCURRENT_FRAMES; ++i) {
-            device.destroyBuffer(uniformBuffers[i].handle);
-            device.freeMemory(uniformBuffers[i].memory);
+        uniformRing.destroy();
+
+        if (!prerecordedCommandBuffers.empty()) {
+            device.freeCommandBuffers(vulkanDevice->commandPool, prerecordedCommandBuffers);
         }
     }
 }
 
 void VulkanTriangle::prepare()
 {
+    PROFILE_FUNCTION();
     VulkanExampleBase::prepare();
     createVertexBuffer();
     createUniformBuffers();
     createDescriptors();
     createPipeline();
+    if (gpuCulling.enabled) {
+        createCullingPipeline();
+    }
+    buildCommandBuffers();
     prepared = true;
 }
 
 void VulkanTriangle::render()
 {
-    // Use a fence to wait until the command buffer has finished execution before using it again
-    VK_CHECK_RESULT(device.waitForFences(1, &waitFences[currentFrame], vk::True, UINT64_MAX));
-    VK_CHECK_RESULT(device.resetFences(1, &waitFences[currentFrame]));
-
-    // Get the next swap chain image from the implementation
-    // Note that the implementation is free to return the images in any order, so we must use the acquire function and can't just cycle through the images/imageIndex on our own
-    uint32_t imageIndex;
-    vk::Result result = device.acquireNextImageKHR(swapchain.swapchain, UINT64_MAX, presentCompleteSemaphores[currentFrame], nullptr, &imageIndex);
-    if (result == vk::Result::eErrorOutOfDateKHR) {
-        windowResize();
+    PROFILE_FUNCTION();
+    // Wait for the frame slot to become available and get the image to render to
+    if (!prepareFrame()) {
         return;
     }
-    else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
-        throw "Could not acquire the next swap chain iamge!";
+
+    // The fence of this frame slot has signaled, so its segment of the uniform ring can be overwritten
+    uniformRing.beginFrame(currentFrame);
+    updateUniformBuffers();
+
+    // Geometry is streamed in by the upload manager, until it has arrived only the clear is rendered
+    const bool geometryResident = uploadManager.isComplete(geometryUploadTicket);
+
+    // Prerecorded command buffers can only be built once the geometry is resident, until then we record every frame
+    if (settings.prerecordCommandBuffers && geometryResident && !prerecordedCommandBuffersValid) {
+        buildCommandBuffers();
+    }
+
+    vk::CommandBuffer commandBuffer;
+    if (prerecordedCommandBuffersValid) {
+        // Nothing changes between frames except for the uniform data, so the command buffer for this image and frame slot can be replayed as is
+        commandBuffer = prerecordedCommandBuffers[currentImageIndex * settings.framesInFlight + currentFrame];
+        gpuTimer.replayFrame(currentFrame);
+    }
+    else {
+        // Build the command buffer for the next frame to render
+        const auto tStart = std::chrono::high_resolution_clock::now();
+        commandBuffer = commandBuffers[currentFrame];
+        commandBuffer.reset();
+        // Secondary command buffers recorded for this frame slot the last time it was used have finished executing, so their pools can be recycled
+        const bool useThreads = geometryResident && (threadCommandPools.getThreadCount() > 0);
+        if (useThreads) {
+            threadCommandPools.reset(currentFrame);
+        }
+        recordCommandBuffer(commandBuffer, currentImageIndex, currentFrame, geometryResident, useThreads);
+        recordingTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+        recordedFrames++;
+    }
+
+    // Submit the command buffer to the graphics queue and present the image (unless running headless)
+    submitFrame(commandBuffer);
+}
+
+void VulkanTriangle::updateUniformBuffers()
+{
+    // All stress scene instances share a single set of matrices, their transforms come from the instance buffer
+    if (stress.instanceCount > 0) {
+        ShaderData shaderData{};
+        shaderData.viewMatrix = camera.matrices.view;
+        shaderData.projectionMatrix = camera.matrices.perspective;
+        shaderData.modelMatrix = glm::mat4(1.0f);
+        uniformRing.push(shaderData);
+        return;
     }
 
-    // Update the uniform buffer for the next frame
+    // Objects are laid out on a square grid that fills the same area as a single triangle
+    const uint32_t gridSize = (uint32_t)std::ceil(std::sqrt((float)objectCount));
+    const float cellSize = 2.0f / (float)gridSize;
+
     ShaderData shaderData{};
-    shaderData.modelMatrix = glm::mat4(1.0f);
     shaderData.viewMatrix = camera.matrices.view;
     shaderData.projectionMatrix = camera.matrices.perspective;
-    
-    // Copy the current matrices to the current frame's uniform buffer. As we requested a host coherent memory type for the uniform buffer, the write is instantly visible to the GPU
-    memcpy(uniformBuffers[currentFrame].mapped, &shaderData, sizeof(ShaderData));
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        const glm::vec3 position((float)(i % gridSize) + 0.5f, (float)(i / gridSize) + 0.5f, 0.0f);
+        shaderData.modelMatrix = glm::translate(glm::mat4(1.0f), (position * cellSize) - glm::vec3(1.0f, 1.0f, 0.0f));
+        shaderData.modelMatrix = glm::scale(shaderData.modelMatrix, glm::vec3(cellSize * 0.5f)) * mesh.transform;
+
+        // Copy the object's matrices into the current frame's segment of the uniform ring. As the ring uses host coherent memory, the write is instantly visible to the GPU
+        // Objects are always pushed in the same order, so object i's data is at the same dynamic offset every frame (see recordCommandBuffer)
+        uniformRing.push(shaderData);
+    }
+}
 
-    // Build the command buffer for the next frame to render
-    commandBuffers[currentFrame].reset();
+void VulkanTriangle::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, uint32_t frameIndex, bool drawGeometry, bool useThreads)
+{
     vk::CommandBufferBeginInfo cmdBufInfo = {};
-    const vk::CommandBuffer commandBuffer = commandBuffers[currentFrame];
     VK_CHECK_RESULT(commandBuffer.begin(&cmdBufInfo));
 
+    // Timestamps are written into the query range of the frame slot and read back by the base class once this frame slot is reused
+    gpuTimer.beginFrame(commandBuffer, frameIndex);
+
     // Set clear values for all framebuffer attachments with loadOp set to clear
     // We use two attachments (color and depth) that are cleared at the start of the subpass and as such we need to set clear values for both
     vk::ClearValue clearValues[2]{};
@@ -85,39 +198,118 @@ void VulkanTriangle::render()
     renderPassBeginInfo.renderPass = renderPass;
     renderPassBeginInfo.renderArea.offset.x = 0;
     renderPassBeginInfo.renderArea.offset.y = 0;
-    renderPassBeginInfo.renderArea.extent.width = width;
-    renderPassBeginInfo.renderArea.extent.height = height;
+    // The scene may be rendered at a lower resolution than the frame buffer (dynamic resolution), the base class upscales it afterwards
+    renderPassBeginInfo.renderArea.extent = renderExtent;
     renderPassBeginInfo.clearValueCount = 2;
     renderPassBeginInfo.pClearValues = clearValues;
     renderPassBeginInfo.framebuffer = frameBuffers[imageIndex];
 
+    // Culling has to be done outside of the render pass, its results are consumed by the indirect draw inside of it
+    if (gpuCulling.enabled && drawGeometry) {
+        recordCulling(commandBuffer, frameIndex);
+    }
+
     // Start the first sub pass specified in our default render pass setup b the base class
     // This will clear the color and depth attachment
-    commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+    // If the draws are recorded by worker threads, the sub pass contents are provided by secondary command buffers
+    gpuTimer.beginRenderPass(commandBuffer, frameIndex);
+    commandBuffer.beginRenderPass(renderPassBeginInfo, useThreads ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+
+    if (useThreads) {
+        // Secondary command buffers inherit the render pass and framebuffer of the primary command buffer they're executed from
+        vk::CommandBufferInheritanceInfo inheritanceInfo = {};
+        inheritanceInfo.renderPass = renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = frameBuffers[imageIndex];
+
+        // Every task records the draws for a contiguous range of objects into a command buffer from the pools of the scheduler thread it runs on
+        // The main thread runs recording tasks too while it waits for them to finish
+        const uint32_t taskCount = settings.recordingThreads;
+        std::vector<vk::CommandBuffer> secondaryCommandBuffers(taskCount);
+        const uint32_t objectsPerTask = (objectCount + taskCount - 1) / taskCount;
+        vks::TaskScheduler::Counter recordingTasks;
+        for (uint32_t t = 0; t < taskCount; ++t) {
+            taskScheduler.schedule([=, &secondaryCommandBuffers, &inheritanceInfo] {
+                PROFILE_SCOPE("recordSecondaryCommandBuffer");
+                vk::CommandBuffer secondaryCommandBuffer = threadCommandPools.getSecondaryCommandBuffer(vks::TaskScheduler::getThreadIndex(), frameIndex);
+                vk::CommandBufferBeginInfo secondaryBeginInfo = {};
+                secondaryBeginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+                secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+                VK_CHECK_RESULT(secondaryCommandBuffer.begin(&secondaryBeginInfo));
+                const uint32_t firstObject = std::min(t * objectsPerTask, objectCount);
+                drawObjects(secondaryCommandBuffer, frameIndex, firstObject, std::min(objectsPerTask, objectCount - firstObject));
+                secondaryCommandBuffer.end();
+                secondaryCommandBuffers[t] = secondaryCommandBuffer;
+            }, &recordingTasks);
+        }
+        taskScheduler.wait(recordingTasks);
+
+        commandBuffer.executeCommands(static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+    }
+    else {
+        drawObjects(commandBuffer, frameIndex, 0, drawGeometry ? objectCount : 0);
+    }
+
+    commandBuffer.endRenderPass();
+    gpuTimer.endRenderPass(commandBuffer, frameIndex);
+
+    // Ending the render pass will add an implicit barrier transitioning the frame buffer color attachment to
+    // VK_IMAGE_LAYOUT_PRESENT_SRC_KHR for presenting it to the windowing system (or VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL when running headless)
+    gpuTimer.endFrame(commandBuffer, frameIndex);
+    commandBuffer.end();
+}
+
+void VulkanTriangle::drawObjects(vk::CommandBuffer commandBuffer, uint32_t frameIndex, uint32_t firstObject, uint32_t count)
+{
+    // Dynamic state is not inherited by secondary command buffers, so it's set for every command buffer that draws
 
     // Update dynamic viewport state
     vk::Viewport viewport = {};
-    viewport.width = (float)width;
-    viewport.height = (float)height;
+    viewport.width = (float)renderExtent.width;
+    viewport.height = (float)renderExtent.height;
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     commandBuffer.setViewport(0, 1, &viewport);
 
     // Update dynamic scissor state
     vk::Rect2D scissor = {};
-    scissor.extent.width = width;
-    scissor.extent.height = height;
+    scissor.extent = renderExtent;
     scissor.offset.x = 0;
     scissor.offset.y = 0;
     commandBuffer.setScissor(0, 1, &scissor);
 
-    // Bind descriptor set for the current frame's uniform buffer, so the shader uses the data from that buffer for this draw
-    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &uniformBuffers[currentFrame].descriptorSet, 0, nullptr);
+    if (count == 0) {
+        return;
+    }
 
     // Bind the rendering pipeline
     // The pipeline (state object) contains all states of the rendering pipeline, binding it will set all the states specified at pipeline creation time
     commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
 
+    if (stress.instanceCount > 0) {
+        // The per-instance data is pulled from storage buffers in the vertex shader, so only the mesh is bound as a vertex buffer
+        const vk::DeviceSize vertexOffset = 0;
+        commandBuffer.bindVertexBuffers(0, 1, &vertexBuffer.handle, &vertexOffset);
+        commandBuffer.bindIndexBuffer(indexBuffer.handle, 0, vk::IndexType::eUint32);
+
+        const uint32_t dynamicOffset = (uint32_t)uniformRing.getFrameOffset(frameIndex);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+
+        if (gpuCulling.enabled) {
+            // The culling pass compacted the visible instances and wrote their number as the instance count, so a single instanced draw covers the whole scene
+            commandBuffer.drawIndexedIndirect(gpuCulling.drawCommandBuffer.handle, 0, 1, sizeof(vk::DrawIndexedIndirectCommand));
+            return;
+        }
+
+        // Every draw covers an equally sized range of instances, selected with the first instance (gl_InstanceIndex includes it)
+        for (uint32_t i = firstObject; i < firstObject + count; ++i) {
+            const uint32_t firstInstance = (uint32_t)((uint64_t)stress.instanceCount * i / stress.drawCount);
+            const uint32_t endInstance = (uint32_t)((uint64_t)stress.instanceCount * (i + 1) / stress.drawCount);
+            commandBuffer.drawIndexed(indexCount, endInstance - firstInstance, 0, 0, firstInstance);
+        }
+        return;
+    }
+
     // Bind triangle vertex buffer (contains position and colors)
     vk::DeviceSize offsets[1]{ 0 };
     commandBuffer.bindVertexBuffers(0, 1, &vertexBuffer.handle, offsets);
@@ -125,62 +317,124 @@ void VulkanTriangle::render()
     // Bind triangle index buffer
     commandBuffer.bindIndexBuffer(indexBuffer.handle, 0, vk::IndexType::eUint32);
 
-    // Draw indexed triangle
-    commandBuffer.drawIndexed(indexCount, 1, 0, 0, 0);
-
-    commandBuffer.endRenderPass();
-
-    // Ending the render pass will add an implicit barrier transitioning the frame buffer color attachment to
-    // VK_IMAGE_LAYOUT_PRESENT_SRC_KHR for presenting it to the windowing system
-    commandBuffer.end();
-
-    // Submit the command buffer to the graphics queue
-
-    // Pipeline stage at which the queue submission will wait
-    vk::PipelineStageFlags waitStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-
-    // The submit info structure specifies a command buffer queue submission batch
-    vk::SubmitInfo submitInfo = {};
-    submitInfo.pWaitDstStageMask = &waitStageMask;      // Pointer to the list of pipeline stages that the semaphore waits will occur at
-    submitInfo.pCommandBuffers = &commandBuffer;        // Command buffer(s) to execute in this batch (submission)
-    submitInfo.commandBufferCount = 1;
+    const vk::DeviceSize frameOffset = uniformRing.getFrameOffset(frameIndex);
+    const vk::DeviceSize objectStride = uniformRing.alignedSize(sizeof(ShaderData));
+    for (uint32_t i = firstObject; i < firstObject + count; ++i) {
+        // The object's data is selected with a dynamic offset, so all objects share a single descriptor set
+        const uint32_t dynamicOffset = (uint32_t)(frameOffset + i * objectStride);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+
+        if (mesh.primitives.empty()) {
+            // Draw indexed triangle
+            commandBuffer.drawIndexed(indexCount, 1, 0, 0, 0);
+            continue;
+        }
+        // Draw the mesh's primitives, which share the vertex and index buffer
+        for (const auto& primitive : mesh.primitives) {
+            commandBuffer.drawIndexed(primitive.indexCount, 1, primitive.firstIndex, primitive.vertexOffset, 0);
+        }
+    }
+}
 
-    // Semaphore to wait upon before the submitted command buffer starts executing
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
-    
-    // Semaphore to be signaled when command buffers have completed
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
+void VulkanTriangle::buildCommandBuffers()
+{
+    // Called on resize while frames using the previous command buffers may still be in flight, so they're freed once those have finished
+    if (!prerecordedCommandBuffers.empty()) {
+        vulkanDevice->deletionQueue.push(vulkanDevice->commandPool, prerecordedCommandBuffers);
+        prerecordedCommandBuffers.clear();
+    }
+    prerecordedCommandBuffersValid = false;
 
-    // Submit to the graphics queue passing a wait fence
-    VK_CHECK_RESULT(queue.submit(1, &submitInfo, waitFences[currentFrame]));
+    // If the geometry hasn't been uploaded yet, the command buffers are built from render() once it has
+    if (!settings.prerecordCommandBuffers || !uploadManager.isComplete(geometryUploadTicket)) {
+        return;
+    }
 
-    // Present the current frame buffer to the swap chain
-    // Pass the semaphore signaled by the command buffer submission from the submit info as the wait semaphore for swap chain presentation
-    // This ensures that the image is not presented to the windowing system until all commands have been submitted
-    vk::PresentInfoKHR presentInfo = {};
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &renderCompleteSemaphores[currentFrame];
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = &swapchain.swapchain;
-    presentInfo.pImageIndices = &imageIndex;
-    result = queue.presentKHR(presentInfo);
+    PROFILE_FUNCTION();
+    const auto tStart = std::chrono::high_resolution_clock::now();
 
-    if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
-        windowResize();
-    }
-    else if (result != vk::Result::eSuccess) {
-        throw "Could not present the image to the swap chain!";
+    // Command buffers reference the framebuffer of the image and the timer queries and uniform ring segment of the frame slot, so we need one per combination
+    const uint32_t imageCount = static_cast<uint32_t>(frameBuffers.size());
+    prerecordedCommandBuffers.resize(imageCount * settings.framesInFlight);
+    vk::CommandBufferAllocateInfo cmdBufAllocateInfo = {};
+    cmdBufAllocateInfo.commandPool = vulkanDevice->commandPool;
+    cmdBufAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
+    cmdBufAllocateInfo.commandBufferCount = static_cast<uint32_t>(prerecordedCommandBuffers.size());
+    VK_CHECK_RESULT(device.allocateCommandBuffers(&cmdBufAllocateInfo, prerecordedCommandBuffers.data()));
+
+    for (uint32_t imageIndex = 0; imageIndex < imageCount; ++imageIndex) {
+        for (uint32_t frameIndex = 0; frameIndex < settings.framesInFlight; ++frameIndex) {
+            recordCommandBuffer(prerecordedCommandBuffers[imageIndex * settings.framesInFlight + frameIndex], imageIndex, frameIndex, true, false);
+        }
     }
 
-    // Select the next frame to render to, based on the max. no. of concurrent frames
-    currentFrame = (currentFrame + 1) % MAX_CONCURRENT_FRAMES;
+    // The average recording time of a single command buffer is what every frame saves by replaying instead
+    const double buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    prerecordingTime = buildTime / (double)prerecordedCommandBuffers.size();
+    prerecordedCommandBuffersValid = true;
 }
 
-void VulkanTriangle::buildCommandBuffers()
+void VulkanTriangle::getBenchmarkResults(vks::Benchmark& benchmark)
 {
+    benchmark.addResult("scheduler threads", taskScheduler.getThreadCount());
+    benchmark.addResult("recording tasks", (threadCommandPools.getThreadCount() > 0) ? settings.recordingThreads : 0);
+    benchmark.addResult("prerecorded command buffers", prerecordedCommandBuffersValid ? prerecordedCommandBuffers.size() : 0);
+    benchmark.addResult("command buffer recording (ms/frame)", (recordedFrames > 0) ? recordingTime / (double)recordedFrames : 0.0);
+    benchmark.addResult("command buffer recording saved (ms/frame)", prerecordedCommandBuffersValid ? prerecordingTime : 0.0);
+
+    if (!mesh.filename.empty() && !mesh.gltf) {
+        const auto& statistics = mesh.objStatistics;
+        benchmark.addResult("mesh file size (MB)", (double)statistics.fileSize / (1024.0 * 1024.0));
+        benchmark.addResult("mesh vertices", statistics.vertexCount);
+        benchmark.addResult("mesh triangles", statistics.triangleCount);
+        benchmark.addResult("mesh parse chunks", statistics.chunkCount);
+        benchmark.addResult("mesh parse (MB/s)", statistics.getParseThroughput());
+        benchmark.addResult("mesh dedup (ms)", statistics.dedupTime);
+        benchmark.addResult("mesh vertex write (ms)", statistics.writeTime);
+        benchmark.addResult("mesh load (ms)", statistics.getTotalTime());
+    }
+    if (!mesh.filename.empty() && mesh.gltf) {
+        const auto& statistics = mesh.gltfStatistics;
+        benchmark.addResult("mesh file size (MB)", (double)statistics.fileSize / (1024.0 * 1024.0));
+        benchmark.addResult("mesh vertices", statistics.vertexCount);
+        benchmark.addResult("mesh triangles", statistics.indexCount / 3);
+        benchmark.addResult("mesh primitives", statistics.primitiveCount);
+        benchmark.addResult("mesh json parse (ms)", statistics.parseTime);
+        benchmark.addResult("mesh copied (MB)", (double)statistics.copiedBytes / (1024.0 * 1024.0));
+        benchmark.addResult("mesh converted (MB)", (double)statistics.convertedBytes / (1024.0 * 1024.0));
+        benchmark.addResult("mesh vertex and index write (ms)", statistics.writeTime);
+        benchmark.addResult("mesh load (ms)", statistics.getTotalTime());
+    }
+    if (!mesh.filename.empty()) {
+        // Vertex memory in the mesh's format compared to full floats
+        // Vertex fetch is estimated as every vertex being read once per object, the actual bandwidth saving shows in the GPU frame time
+        vks::VertexFormat floatFormat;
+        vks::VertexFormat::fromName("float", floatFormat);
+        const double vertexCount = mesh.gltf ? mesh.gltfStatistics.vertexCount : mesh.objStatistics.vertexCount;
+        const double vertexBufferSize = vertexCount * vertexFormat.stride / (1024.0 * 1024.0);
+        benchmark.addResult("mesh vertex format", vertexFormat.getName());
+        benchmark.addResult("mesh vertex stride (bytes)", vertexFormat.stride);
+        benchmark.addResult("mesh vertex buffer (MB)", vertexBufferSize);
+        benchmark.addResult("mesh vertex buffer as float (MB)", vertexCount * floatFormat.stride / (1024.0 * 1024.0));
+        benchmark.addResult("mesh vertex memory reduction (x)", (double)floatFormat.stride / (double)vertexFormat.stride);
+        benchmark.addResult("mesh vertex fetch (MB/frame)", vertexBufferSize * objectCount);
+    }
 
+    if (stress.instanceCount > 0) {
+        // Throughput is derived from the average frame time of the measurement, and from the GPU time alone (independent of CPU and present limits)
+        const double trianglesPerFrame = (double)stress.instanceCount * (double)stress.trianglesPerMesh;
+        const double frameTime = benchmark.frameTimes.empty() ? 0.0 : std::accumulate(benchmark.frameTimes.begin(), benchmark.frameTimes.end(), 0.0) / (double)benchmark.frameTimes.size();
+        const double gpuFrameTime = benchmark.gpuFrameTimes.empty() ? 0.0 : std::accumulate(benchmark.gpuFrameTimes.begin(), benchmark.gpuFrameTimes.end(), 0.0) / (double)benchmark.gpuFrameTimes.size();
+        benchmark.addResult("stress instances", stress.instanceCount);
+        benchmark.addResult("stress triangles per mesh", stress.trianglesPerMesh);
+        benchmark.addResult("stress draws", stress.drawCount);
+        benchmark.addResult("triangles per frame", trianglesPerFrame);
+        benchmark.addResult("triangles/sec", (frameTime > 0.0) ? trianglesPerFrame * 1000.0 / frameTime : 0.0);
+        // With GPU culling the CPU only records a single indirect draw per frame
+        benchmark.addResult("gpu culling", gpuCulling.enabled ? "yes" : "no");
+        benchmark.addResult("draws/sec (cpu issued)", (frameTime > 0.0) ? (gpuCulling.enabled ? 1.0 : (double)stress.drawCount) * 1000.0 / frameTime : 0.0);
+        benchmark.addResult("triangles/sec (gpu time)", (gpuFrameTime > 0.0) ? trianglesPerFrame * 1000.0 / gpuFrameTime : 0.0);
+    }
 }
 
 void VulkanTriangle::getEnabledFeatures()
@@ -189,15 +443,44 @@ void VulkanTriangle::getEnabledFeatures()
     if (deviceProperties.apiVersion < VK_API_VERSION_1_3) {
         vks::tools::exitFatal("Selected GPU does not support Vulkan 1.3", vk::Result::eErrorIncompatibleDriver);
     }
+
+    // The stress scene's instance data is read from a storage buffer
+    if ((stress.instanceCount > 0) && ((vk::DeviceSize)stress.instanceCount * sizeof(StressInstance) > deviceProperties.limits.maxStorageBufferRange)) {
+        vks::tools::exitFatal("Too many stress test instances for the selected GPU's storage buffer range", -1);
+    }
+
+    // GPU culling draws all visible instances with a single indirect draw (drawCount 1, firstInstance 0), which needs no optional features
+    // Only the number of culling work groups is limited
+    if (gpuCulling.enabled) {
+        const uint32_t workGroupCount = (stress.instanceCount + 63) / 64;
+        if (workGroupCount <= deviceProperties.limits.maxComputeWorkGroupCount[0]) {
+            // Only a single draw is recorded, so there is nothing to distribute over the recording tasks
+            objectCount = 1;
+        }
+        else {
+            std::cerr << "GPU culling is not supported for this many instances, falling back to CPU issued draws\n";
+            gpuCulling.enabled = false;
+        }
+    }
 }
 
 // Prepare vertex and index buffers for an indexed triangle
 // Also uploads them to device local memory using staging and initializes vertex input and attribute binding to match the vertex shader
 void VulkanTriangle::createVertexBuffer()
 {
+    PROFILE_FUNCTION();
+    if (stress.instanceCount > 0) {
+        createStressScene();
+        return;
+    }
+    if (!mesh.filename.empty()) {
+        loadMesh();
+        return;
+    }
+
     // A note on memory management in Vulkan in general:
-    // This is a complex topic and while it's fine for an example application to small individual memory allocations that is not
-    // what should be done in a real-world application, where you should allocate large chunks of memory at once instead
+    // Allocating device memory for every single resource is slow and the number of allocations is limited (maxMemoryAllocationCount)
+    // So instead of calling allocateMemory per buffer, memory is sub-allocated from large blocks by the device's memory allocator
 
     // Setup vertices
     const std::vector<Vertex> vertices{
@@ -215,140 +498,266 @@ void VulkanTriangle::createVertexBuffer()
 
     // Static data like vertex and index buffer should be stored on the device memory for optimal (and fastest) access by the GPU
     //
-    // To achieve this we use so-called "staging buffers" :
-    // - Create a buffer that's visible to the host (and can be mapped)
-    // - Copy the data to this buffer
-    // - Create another buffer that's local on the device (VRAM) with the same size
-    // - Copy the data from the host to the device using a command buffer
-    // - Delete the host visible (staging) buffer
-    // - Use the device local buffers for rendering
+    // To achieve this the data is uploaded through the base class' upload manager:
+    // - The data is copied into a host visible staging ring
+    // - Device local buffers are created for rendering
+    // - The copies from the staging ring to the device local buffers are recorded and submitted to the transfer queue
+    // - If the transfer queue is from a different queue family, ownership of the buffers is transferred to the graphics queue family
     //
     // Note: On unified memory architectures where host (CPU) and GPU share the same memory, staging is not necessary
     // To keep this sample easy to follow, there is no check for that in place
 
-    // Create the host visible staging buffer that we copy vertices and indices too, and from which we copy to the device
-    VulkanBuffer stagingBuffer;
-    vk::BufferCreateInfo stagingBufferCI = {};
-    stagingBufferCI.size = vertexBufferSize + indexBufferSize;
-    stagingBufferCI.usage = vk::BufferUsageFlagBits::eTransferSrc;
-    // Create a host-visible buffer to copy the vertex data to (staging buffer)
-    VK_CHECK_RESULT(device.createBuffer(&stagingBufferCI, nullptr, &stagingBuffer.handle));
-
-    // Allocate memory
-    vk::MemoryAllocateInfo memAlloc = {};
-    vk::MemoryRequirements memReqs = device.getBufferMemoryRequirements(stagingBuffer.handle);
-    memAlloc.allocationSize = memReqs.size;
-    // Request a host visible memory tpe that can be used to copy our data to
-    // Also request it to be coherent, so that writes are visible to the GPU right after unmapping the buffer
-    memAlloc.memoryTypeIndex = getMemoryTypeIndex(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-    VK_CHECK_RESULT(device.allocateMemory(&memAlloc, nullptr, &stagingBuffer.memory));
-    device.bindBufferMemory(stagingBuffer.handle, stagingBuffer.memory, 0);
-
-    // Map the buffer and copy vertices and indices into it, this way we can use a single buffer as the source for both vertex and index GPU buffers
-    uint8_t* data{ nullptr };
-    VK_CHECK_RESULT(device.mapMemory(stagingBuffer.memory, 0, memAlloc.allocationSize, {}, (void**)&data));
-    memcpy(data, vertices.data(), vertexBufferSize);
-    memcpy(((char*)data) + vertexBufferSize, indices.data(), indexBufferSize);
-
     // Create a device local buffer to which the (host local) vertex data will be copied and which will be used for rendering
     vk::BufferCreateInfo vertexBufferCI = {};
     vertexBufferCI.size = vertexBufferSize;
     vertexBufferCI.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
     VK_CHECK_RESULT(device.createBuffer(&vertexBufferCI, nullptr, &vertexBuffer.handle));
-    memReqs = device.getBufferMemoryRequirements(vertexBuffer.handle);
-    memAlloc.allocationSize = memReqs.size;
-    memAlloc.memoryTypeIndex = getMemoryTypeIndex(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-    VK_CHECK_RESULT(device.allocateMemory(&memAlloc, nullptr, &vertexBuffer.memory));
-    device.bindBufferMemory(vertexBuffer.handle, vertexBuffer.memory, 0);
+    vertexBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(vertexBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
     // Create a device local buffer to which the (host local) index data will be copied and which will be used for rendering
     vk::BufferCreateInfo indexBufferCI = {};
     indexBufferCI.size = indexBufferSize;
     indexBufferCI.usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst;
     VK_CHECK_RESULT(device.createBuffer(&indexBufferCI, nullptr, &indexBuffer.handle));
-    memReqs = device.getBufferMemoryRequirements(indexBuffer.handle);
-    memAlloc.allocationSize = memReqs.size;
-    memAlloc.memoryTypeIndex = getMemoryTypeIndex(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-    VK_CHECK_RESULT(device.allocateMemory(&memAlloc, nullptr, &indexBuffer.memory));
-    device.bindBufferMemory(indexBuffer.handle, indexBuffer.memory, 0);
+    indexBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(indexBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    // Buffer copies have to be submitted to a queue, so we need a command buffer for them
-    vk::CommandBuffer copyCmd;
+    // Both copies are submitted as one batch, we don't wait for it here but check the ticket before drawing
+    uploadManager.uploadBuffer(vertexBuffer.handle, 0, vertices.data(), vertexBufferSize);
+    uploadManager.uploadBuffer(indexBuffer.handle, 0, indices.data(), indexBufferSize);
+    geometryUploadTicket = uploadManager.flush();
+}
 
-    vk::CommandBufferAllocateInfo cmdBufAllocateInfo = {};
-    cmdBufAllocateInfo.commandPool        = vulkanDevice->commandPool;
-    cmdBufAllocateInfo.level              = vk::CommandBufferLevel::ePrimary;
-    cmdBufAllocateInfo.commandBufferCount = 1;
-    VK_CHECK_RESULT(device.allocateCommandBuffers(&cmdBufAllocateInfo, &copyCmd));
+// Generate a sphere mesh and the per-instance data of the stress scene and upload them like the triangle's buffers
+void VulkanTriangle::createStressScene()
+{
+    PROFILE_FUNCTION();
+    // Rings and segments are chosen so the sphere has about the requested number of triangles, every ring of quads adds 2 * segments triangles
+    const uint32_t rings = std::max((uint32_t)std::round(std::sqrt((float)stress.trianglesPerMesh / 4.0f)), 2u);
+    const uint32_t segments = std::max((stress.trianglesPerMesh + rings) / (2 * rings), 3u);
+    stress.trianglesPerMesh = 2 * rings * segments;
+
+    std::vector<Vertex> vertices;
+    vertices.reserve((rings + 1) * (segments + 1));
+    for (uint32_t r = 0; r <= rings; ++r) {
+        const float theta = glm::pi<float>() * (float)r / (float)rings;
+        for (uint32_t s = 0; s <= segments; ++s) {
+            const float phi = glm::two_pi<float>() * (float)s / (float)segments;
+            const glm::vec3 position(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            vertices.push_back({ position, position * 0.5f + 0.5f });
+        }
+    }
 
-    vk::CommandBufferBeginInfo cmdBufInfo = {};
-    VK_CHECK_RESULT(copyCmd.begin(&cmdBufInfo));
-
-    // Copy vertex and index buffers to the device
-    vk::BufferCopy copyRegion = {};
-    copyRegion.size = vertexBufferSize;
-    copyCmd.copyBuffer(stagingBuffer.handle, vertexBuffer.handle, 1, &copyRegion);
-    copyRegion.size = indexBufferSize;
-    copyRegion.srcOffset = vertexBufferSize;
-    copyCmd.copyBuffer(stagingBuffer.handle, indexBuffer.handle, 1, &copyRegion);
-    copyCmd.end();
-
-    // Submit the command buffer to the queue to finish the copy
-    vk::SubmitInfo submitInfo = {};
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &copyCmd;
-
-    // Create fence to ensure that the command buffer has finished executing
-    vk::FenceCreateInfo fenceCI = {};
-    vk::Fence fence = device.createFence(fenceCI);
-
-    // Submit copies to the queue
-    VK_CHECK_RESULT(queue.submit(1, &submitInfo, fence));
-    // Wait for the fence to signal that command buffer has finished executing
-    VK_CHECK_RESULT(device.waitForFences(1, &fence, vk::True, DEFAULT_FENCE_TIMEOUT));
-    
-    device.destroyFence(fence);
-    device.freeCommandBuffers(vulkanDevice->commandPool, 1, &copyCmd);
+    std::vector<uint32_t> indices;
+    indices.reserve(stress.trianglesPerMesh * 3);
+    for (uint32_t r = 0; r < rings; ++r) {
+        for (uint32_t s = 0; s < segments; ++s) {
+            const uint32_t a = r * (segments + 1) + s;
+            const uint32_t b = a + segments + 1;
+            indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+    indexCount = static_cast<uint32_t>(indices.size());
 
-    // The fence made sure copies are finished, so we can safely delete the staging buffer
-    device.destroyBuffer(stagingBuffer.handle);
-    device.freeMemory(stagingBuffer.memory);
+    // Instances are placed on a cubic grid filling the same area as the triangles, with a random scale, rotation and tint per instance
+    // Every instance's values are derived from a hash of its index, so the scene is the same for every run and can be generated in parallel
+    std::vector<StressInstance> instances(stress.instanceCount);
+    const uint32_t gridSize = (uint32_t)std::ceil(std::cbrt((double)stress.instanceCount));
+    const float cellSize = 2.0f / (float)gridSize;
+    taskScheduler.parallelFor(stress.instanceCount, 16384, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            uint32_t hash = i * 0x9E3779B9u;
+            auto random = [&hash]() {
+                hash ^= hash >> 16;
+                hash *= 0x85EBCA6Bu;
+                hash ^= hash >> 13;
+                hash *= 0xC2B2AE35u;
+                hash ^= hash >> 16;
+                return (float)(hash & 0xFFFFFF) / (float)0xFFFFFF;
+            };
+            const glm::vec3 cell((float)(i % gridSize), (float)((i / gridSize) % gridSize), (float)(i / (gridSize * gridSize)));
+            const glm::vec3 position = (cell + 0.5f) * cellSize - 1.0f;
+            instances[i].positionScale = glm::vec4(position, cellSize * (0.25f + 0.2f * random()));
+            instances[i].colorRotation = glm::vec4(0.5f + 0.5f * random(), 0.5f + 0.5f * random(), 0.5f + 0.5f * random(), glm::two_pi<float>() * random());
+        }
+    });
+
+    const vk::DeviceSize vertexBufferSize = vertices.size() * sizeof(Vertex);
+    const vk::DeviceSize indexBufferSize = indices.size() * sizeof(uint32_t);
+    const vk::DeviceSize instanceBufferSize = instances.size() * sizeof(StressInstance);
+
+    vk::BufferCreateInfo bufferCI = {};
+    bufferCI.size = vertexBufferSize;
+    bufferCI.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    VK_CHECK_RESULT(device.createBuffer(&bufferCI, nullptr, &vertexBuffer.handle));
+    vertexBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(vertexBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    bufferCI.size = indexBufferSize;
+    bufferCI.usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    VK_CHECK_RESULT(device.createBuffer(&bufferCI, nullptr, &indexBuffer.handle));
+    indexBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(indexBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // The instance data is pulled by the vertex shader and also read by the culling pass (if enabled)
+    bufferCI.size = instanceBufferSize;
+    bufferCI.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    VK_CHECK_RESULT(device.createBuffer(&bufferCI, nullptr, &stress.instanceBuffer.handle));
+    stress.instanceBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(stress.instanceBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // The vertex shader draws instances[instanceIndices[gl_InstanceIndex]]
+    // Without GPU culling the indices are the identity, with it they are written every frame by the culling pass
+    const vk::DeviceSize instanceIndexBufferSize = (vk::DeviceSize)stress.instanceCount * sizeof(uint32_t);
+    bufferCI.size = instanceIndexBufferSize;
+    bufferCI.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    VK_CHECK_RESULT(device.createBuffer(&bufferCI, nullptr, &stress.instanceIndexBuffer.handle));
+    stress.instanceIndexBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(stress.instanceIndexBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    if (gpuCulling.enabled) {
+        // Written by the culling pass and read as indirect draw parameters, reset with an update at the start of every frame
+        bufferCI.size = sizeof(vk::DrawIndexedIndirectCommand);
+        bufferCI.usage = vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+        VK_CHECK_RESULT(device.createBuffer(&bufferCI, nullptr, &gpuCulling.drawCommandBuffer.handle));
+        gpuCulling.drawCommandBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(gpuCulling.drawCommandBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    }
+
+    // Large instance buffers are split into multiple copies by the upload manager
+    uploadManager.uploadBuffer(vertexBuffer.handle, 0, vertices.data(), vertexBufferSize);
+    uploadManager.uploadBuffer(indexBuffer.handle, 0, indices.data(), indexBufferSize);
+    uploadManager.uploadBuffer(stress.instanceBuffer.handle, 0, instances.data(), instanceBufferSize);
+    if (!gpuCulling.enabled) {
+        uploadManager.uploadBuffer(stress.instanceIndexBuffer.handle, 0, instanceIndexBufferSize, sizeof(uint32_t), [](void* dst, vk::DeviceSize partOffset, vk::DeviceSize partSize) {
+            uint32_t* indices = static_cast<uint32_t*>(dst);
+            const uint32_t first = (uint32_t)(partOffset / sizeof(uint32_t));
+            for (uint32_t i = 0; i < (uint32_t)(partSize / sizeof(uint32_t)); ++i) {
+                indices[i] = first + i;
+            }
+        });
+    }
+    geometryUploadTicket = uploadManager.flush();
+}
+
+void VulkanTriangle::loadMesh()
+{
+    // The format is selected by the file extension, everything that is not a GLB file is parsed as OBJ
+    std::string extension = mesh.filename.substr(std::min(mesh.filename.find_last_of('.'), mesh.filename.size()));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    mesh.gltf = (extension == ".glb");
+    if (mesh.gltf) {
+        loadGltfMesh();
+    } else {
+        loadObjMesh();
+    }
+}
+
+void VulkanTriangle::createMeshBuffers(uint32_t vertexCount, uint32_t meshIndexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+    const MeshWriter& writeVertices, const MeshWriter& writeIndices)
+{
+    // The mesh's vertex format is quantized to its bounds, which are known once the file is parsed
+    vertexFormat = mesh.vertexFormat;
+    vertexFormat.setQuantizationBounds(boundsMin, boundsMax);
+    const vk::DeviceSize vertexBufferSize = (vk::DeviceSize)vertexCount * vertexFormat.stride;
+    const vk::DeviceSize indexBufferSize = (vk::DeviceSize)meshIndexCount * sizeof(uint32_t);
+    indexCount = meshIndexCount;
+
+    vk::BufferCreateInfo bufferCI = {};
+    bufferCI.size = vertexBufferSize;
+    bufferCI.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    VK_CHECK_RESULT(device.createBuffer(&bufferCI, nullptr, &vertexBuffer.handle));
+    vertexBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(vertexBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    bufferCI.size = indexBufferSize;
+    bufferCI.usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    VK_CHECK_RESULT(device.createBuffer(&bufferCI, nullptr, &indexBuffer.handle));
+    indexBuffer.memory = vulkanDevice->memoryAllocator->allocateBufferMemory(indexBuffer.handle, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // Vertices and indices are written by the loader straight into the staging ring, in parts of whole elements if the mesh is larger than the ring
+    const uint32_t stride = vertexFormat.stride;
+    uploadManager.uploadBuffer(vertexBuffer.handle, 0, vertexBufferSize, stride, [&writeVertices, stride](void* dst, vk::DeviceSize partOffset, vk::DeviceSize partSize) {
+        writeVertices(dst, (uint32_t)(partOffset / stride), (uint32_t)(partSize / stride));
+    });
+    uploadManager.uploadBuffer(indexBuffer.handle, 0, indexBufferSize, sizeof(uint32_t), [&writeIndices](void* dst, vk::DeviceSize partOffset, vk::DeviceSize partSize) {
+        writeIndices(dst, (uint32_t)(partOffset / sizeof(uint32_t)), (uint32_t)(partSize / sizeof(uint32_t)));
+    });
+    geometryUploadTicket = uploadManager.flush();
+
+    // Center the mesh and scale its largest axis to [-1, 1], so it covers the same area as the triangle
+    // Quantized positions are dequantized by the same transform
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    const glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+    const float maxExtent = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+    mesh.transform = glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / maxExtent)), -center) * vertexFormat.getDequantizationMatrix();
+}
+
+void VulkanTriangle::loadObjMesh()
+{
+    PROFILE_FUNCTION();
+    vks::ObjLoader loader;
+    if (!loader.load(mesh.filename, taskScheduler)) {
+        vks::tools::exitFatal("Could not load mesh \"" + mesh.filename + "\"", -1);
+    }
+    const std::vector<uint32_t>& indices = loader.getIndices();
+    mesh.primitives = { vks::GltfLoader::Primitive{ 0, static_cast<uint32_t>(indices.size()), 0, loader.getVertexCount() } };
+    // Vertices are assembled from the parsed attributes, the indices have already been resolved by the loader
+    createMeshBuffers(loader.getVertexCount(), static_cast<uint32_t>(indices.size()), loader.getBoundsMin(), loader.getBoundsMax(),
+        [&loader, this](void* dst, uint32_t first, uint32_t count) { loader.writeVertices(dst, first, count, vertexFormat); },
+        [&indices](void* dst, uint32_t first, uint32_t count) { memcpy(dst, indices.data() + first, (size_t)count * sizeof(uint32_t)); });
+
+    mesh.objStatistics = loader.getStatistics();
+    const auto& statistics = mesh.objStatistics;
+    std::cout << "Loaded mesh \"" << mesh.filename << "\": " << statistics.vertexCount << " vertices, " << statistics.triangleCount << " triangles, "
+        << std::fixed << std::setprecision(1) << (double)statistics.fileSize / (1024.0 * 1024.0) << " MB parsed at " << statistics.getParseThroughput() << " MB/s ("
+        << statistics.chunkCount << " chunks), dedup " << statistics.dedupTime << " ms, vertex write " << statistics.writeTime << " ms, "
+        << vertexFormat.getName() << " vertex format (" << vertexFormat.stride << " bytes per vertex)\n";
+}
+
+void VulkanTriangle::loadGltfMesh()
+{
+    PROFILE_FUNCTION();
+    vks::GltfLoader loader;
+    if (!loader.load(mesh.filename, taskScheduler)) {
+        vks::tools::exitFatal("Could not load mesh \"" + mesh.filename + "\"", -1);
+    }
+    mesh.primitives = loader.getPrimitives();
+    // Vertex and index data is read from the mapped file, matching data is copied as is and everything else is converted while writing
+    createMeshBuffers(loader.getVertexCount(), loader.getIndexCount(), loader.getBoundsMin(), loader.getBoundsMax(),
+        [&loader, this](void* dst, uint32_t first, uint32_t count) { loader.writeVertices(dst, first, count, vertexFormat); },
+        [&loader](void* dst, uint32_t first, uint32_t count) { loader.writeIndices(dst, first, count); });
+
+    mesh.gltfStatistics = loader.getStatistics();
+    const auto& statistics = mesh.gltfStatistics;
+    std::cout << "Loaded mesh \"" << mesh.filename << "\": " << statistics.vertexCount << " vertices, " << statistics.indexCount / 3 << " triangles in "
+        << statistics.primitiveCount << " primitives, " << std::fixed << std::setprecision(1) << (double)statistics.copiedBytes / (1024.0 * 1024.0) << " MB copied, "
+        << (double)statistics.convertedBytes / (1024.0 * 1024.0) << " MB converted, load " << statistics.getTotalTime() << " ms, "
+        << vertexFormat.getName() << " vertex format (" << vertexFormat.stride << " bytes per vertex)\n";
 }
 
 void VulkanTriangle::createUniformBuffers()
 {
-    // Prepare and initialize the per-frame uniform buffer blocks containing shader uniforms
+    PROFILE_FUNCTION();
+    // Prepare the uniform ring holding the shader uniforms of all objects for all frames in flight
     // Single uniforms like in OpenGL are no longer present in Vulkan. All shader uniforms are passed via uniform buffer blocks
-    vk::BufferCreateInfo bufferInfo = {};
-    bufferInfo.size = sizeof(ShaderData);
-    bufferInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer;
-
-    // Create the buffers
-    for (uint32_t i = 0; i < MAX_CONCURRENT_FRAMES; ++i) {
-        VK_CHECK_RESULT(device.createBuffer(&bufferInfo, nullptr, &uniformBuffers[i].handle));
-
-        // Get memory requirements including size, alignment and memory type based on the buffer type we request
-        vk::MemoryRequirements memReqs = device.getBufferMemoryRequirements(uniformBuffers[i].handle);
-        vk::MemoryAllocateInfo memAlloc = {};
-        memAlloc.allocationSize = memReqs.size;
-        memAlloc.memoryTypeIndex = getMemoryTypeIndex(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-        VK_CHECK_RESULT(device.allocateMemory(&memAlloc, nullptr, &uniformBuffers[i].memory));
-        device.bindBufferMemory(uniformBuffers[i].handle, uniformBuffers[i].memory, 0);
-        
-        // We map the buffer once, so we can update it without having to map it again
-        VK_CHECK_RESULT(device.mapMemory(uniformBuffers[i].memory, 0, sizeof(ShaderData), {}, (void**)(&uniformBuffers[i].mapped)));
-    }
+    // The stress scene only needs a single set of uniforms per frame
+    const uint32_t uniformCount = (stress.instanceCount > 0) ? 1 : objectCount;
+    uniformRing.create(vulkanDevice, uniformRing.alignedSize(sizeof(ShaderData)) * uniformCount, settings.framesInFlight);
 }
 
 // Descriptors are used to pass data to shaders, for our sample we use a descriptor to pass parameters like matrices to the shader
 void VulkanTriangle::createDescriptors()
 {
+    PROFILE_FUNCTION();
     // Descriptors are allocated from a pool, that tells the implementation how many and what types of descriptors we are going to use (at maximum)
-    vk::DescriptorPoolSize descriptorTypeCounts[1]{};
-    // This example only one descriptor type (uniform buffer)
-    descriptorTypeCounts[0].type = vk::DescriptorType::eUniformBuffer;
-    // We have one buffer (and as such descriotpr) per frame
-    descriptorTypeCounts[0].descriptorCount = MAX_CONCURRENT_FRAMES;
+    vk::DescriptorPoolSize descriptorTypeCounts[2]{};
+    // The graphics pipeline only uses one descriptor type (dynamic uniform buffer)
+    descriptorTypeCounts[0].type = vk::DescriptorType::eUniformBufferDynamic;
+    // All frames and objects share a single descriptor, they only differ in the dynamic offset passed at bind time
+    descriptorTypeCounts[0].descriptorCount = 1;
+    // The stress scene adds the instance and instance index buffers to it
+    // The culling pass (if enabled) has its own set with the uniforms and the instance, instance index and draw command buffers
+    const bool stressScene = stress.instanceCount > 0;
+    descriptorTypeCounts[1].type = vk::DescriptorType::eStorageBuffer;
+    descriptorTypeCounts[1].descriptorCount = 2;
+    if (gpuCulling.enabled) {
+        descriptorTypeCounts[0].descriptorCount += 1;
+        descriptorTypeCounts[1].descriptorCount += 3;
+    }
     // For additional types you need to add new entries in the type count list
     // E.g. for two combined image samplers :
     // typeCounts[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -357,58 +766,65 @@ void VulkanTriangle::createDescriptors()
     // Create the global descriptor pool
     // All descriptors used in this example are allocated from this pool
     vk::DescriptorPoolCreateInfo descriptorPoolCI = {};
-    descriptorPoolCI.poolSizeCount = 1;
+    descriptorPoolCI.poolSizeCount = stressScene ? 2 : 1;
     descriptorPoolCI.pPoolSizes = descriptorTypeCounts;
     // Set the max. number of descriptor sets that can be requested from this pool (requesting beyond this limit will result in an error)
-    // Our sample will create one set per uniform buffer perframe
-    descriptorPoolCI.maxSets = MAX_CONCURRENT_FRAMES;
+    descriptorPoolCI.maxSets = gpuCulling.enabled ? 2 : 1;
     VK_CHECK_RESULT(device.createDescriptorPool(&descriptorPoolCI, nullptr, &descriptorPool));
 
     // Descriptor set layouts define the interface between our application and the shader
     // Basically connects the different shader stages to descriptors for binding uniform buffers, image samplers, etc.
     // So every shader binding should map to one descriptor set layout binding
-    // Binding 0: Uniform buffer (Vertex shader)
-    vk::DescriptorSetLayoutBinding layoutBinding = {};
-    layoutBinding.descriptorType = vk::DescriptorType::eUniformBuffer;
-    layoutBinding.descriptorCount = 1;
-    layoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
+    // Binding 0: Dynamic uniform buffer (Vertex shader)
+    // Binding 1: Stress scene instances (Vertex shader, stress scene only)
+    // Binding 2: Index of the instance drawn for every gl_InstanceIndex (Vertex shader, stress scene only)
+    std::array<vk::DescriptorSetLayoutBinding, 3> layoutBindings{};
+    for (uint32_t i = 0; i < layoutBindings.size(); ++i) {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = (i == 0) ? vk::DescriptorType::eUniformBufferDynamic : vk::DescriptorType::eStorageBuffer;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = vk::ShaderStageFlagBits::eVertex;
+    }
 
     vk::DescriptorSetLayoutCreateInfo descriptorLayoutCI = {};
-    descriptorLayoutCI.bindingCount = 1;
-    descriptorLayoutCI.pBindings = &layoutBinding;
+    descriptorLayoutCI.bindingCount = stressScene ? 3 : 1;
+    descriptorLayoutCI.pBindings = layoutBindings.data();
     VK_CHECK_RESULT(device.createDescriptorSetLayout(&descriptorLayoutCI, nullptr, &descriptorSetLayout));
 
     // Where the descriptor set layout is the interface, the descriptor set points to actual data
-    // Descriptors that are changed per frame need to be multiplied, so we can update descriptor n+1 while n is still used by the GPUs, so we create one per max frame in flights
-    for (uint32_t i = 0; i < MAX_CONCURRENT_FRAMES; ++i) {
-        vk::DescriptorSetAllocateInfo allocInfo = {};
-        allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = &descriptorSetLayout;
-        VK_CHECK_RESULT(device.allocateDescriptorSets(&allocInfo, &uniformBuffers[i].descriptorSet));
-
-        // Update the descriptor set determining the shader binding points
-        // For every binding point used in a shader there needs to be one
-        // descriptor set matching that binding point
-        vk::WriteDescriptorSet writeDescriptorSet = {};
-
-        // The buffer's information is passed using a descriptor info structure
-        vk::DescriptorBufferInfo bufferInfo = {};
-        bufferInfo.buffer = uniformBuffers[i].handle;
-        bufferInfo.range = sizeof(ShaderData);
-
-        // Binding 0 : Uniform buffer
-        writeDescriptorSet.dstSet          = uniformBuffers[i].descriptorSet;
-        writeDescriptorSet.dstBinding      = 0;
-        writeDescriptorSet.descriptorCount = 1;
-        writeDescriptorSet.descriptorType  = vk::DescriptorType::eUniformBuffer;
-        writeDescriptorSet.pBufferInfo     = &bufferInfo;
-        device.updateDescriptorSets(1, &writeDescriptorSet, 0, nullptr);
+    // With a dynamic uniform buffer the set doesn't have to be multiplied per frame in flight, each frame binds it with offsets into its own segment of the ring
+    vk::DescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+    VK_CHECK_RESULT(device.allocateDescriptorSets(&allocInfo, &descriptorSet));
+
+    // Update the descriptor set determining the shader binding points
+    // For every binding point used in a shader there needs to be one
+    // descriptor set matching that binding point
+    std::array<vk::WriteDescriptorSet, 3> writeDescriptorSets{};
+
+    // The buffer's information is passed using a descriptor info structure
+    // The uniform range covers a single object's data, the dynamic offset selects which one
+    std::array<vk::DescriptorBufferInfo, 3> bufferInfos{};
+    bufferInfos[0] = { uniformRing.buffer, 0, sizeof(ShaderData) };
+    bufferInfos[1] = { stress.instanceBuffer.handle, 0, VK_WHOLE_SIZE };
+    bufferInfos[2] = { stress.instanceIndexBuffer.handle, 0, VK_WHOLE_SIZE };
+
+    // Binding 0 : Dynamic uniform buffer, bindings 1 and 2 : Instance and instance index buffers (stress scene only)
+    for (uint32_t i = 0; i < writeDescriptorSets.size(); ++i) {
+        writeDescriptorSets[i].dstSet          = descriptorSet;
+        writeDescriptorSets[i].dstBinding      = i;
+        writeDescriptorSets[i].descriptorCount = 1;
+        writeDescriptorSets[i].descriptorType  = layoutBindings[i].descriptorType;
+        writeDescriptorSets[i].pBufferInfo     = &bufferInfos[i];
     }
+    device.updateDescriptorSets(descriptorLayoutCI.bindingCount, writeDescriptorSets.data(), 0, nullptr);
 }
 
 void VulkanTriangle::createPipeline()
 {
+    PROFILE_FUNCTION();
     // The pipeline layout is the interface telling the pipeline what type of dscriptors will later be bound
     vk::PipelineLayoutCreateInfo pipelineLayoutCI = {};
     pipelineLayoutCI.setLayoutCount = 1;
@@ -488,42 +904,42 @@ void VulkanTriangle::createPipeline()
 
     // Vertex input binding
     // This example uses a single vertex input binding point 0
-    vk::VertexInputBindingDescription vertexInputBinding = {};
-    vertexInputBinding.binding = 0;
-    vertexInputBinding.stride = sizeof(Vertex);
-    vertexInputBinding.inputRate = vk::VertexInputRate::eVertex;
+    // The stress scene's per-instance data is read from storage buffers instead (see createDescriptors)
+    const vk::VertexInputBindingDescription vertexInputBinding = vertexFormat.getBindingDescription(0);
 
     // Input attribute bindings describe shader attribute locations and memory layouts
-    std::array<vk::VertexInputAttributeDescription, 2> vertexInputAttributes{};
-    // These match the following shader layout
+    // The attributes of binding 0 are generated from the vertex format, they match the following shader layout
     // layout (location = 0) in vec3 inPos;
     // layout (location = 1) in vec3 inColor;
-    // Attribute location 0: Position
-    vertexInputAttributes[0].binding = 0;
-    vertexInputAttributes[0].location = 0;
-    // Position attribute is three 32 bit signed (SFLOAT) floats (R32 G32 B32)
-    vertexInputAttributes[0].format = vk::Format::eR32G32B32Sfloat;
-    vertexInputAttributes[0].offset = offsetof(Vertex, position);
-    // Attribute location 1: Color
-    vertexInputAttributes[1].binding = 0;
-    vertexInputAttributes[1].location = 1;
-    // Color attribute is three 32 bit signed (SFLOAT) float3 (R32 G32 B32)
-    vertexInputAttributes[1].format = vk::Format::eR32G32B32Sfloat;
-    vertexInputAttributes[1].offset = offsetof(Vertex, color);
+    // layout (location = 2) in vec3 inNormal; (mesh formats only)
+    // Packed formats (e.g. half float positions or 8 bit colors) are converted to floats by the vertex fetch, so the shaders don't depend on the format
+    const std::vector<vk::VertexInputAttributeDescription> vertexInputAttributes = vertexFormat.getAttributeDescriptions(0);
 
     // Vertex input state used for pipeline creation
     vk::PipelineVertexInputStateCreateInfo vertexInputStateCI = {};
     vertexInputStateCI.vertexBindingDescriptionCount = 1;
     vertexInputStateCI.pVertexBindingDescriptions = &vertexInputBinding;
-    vertexInputStateCI.vertexAttributeDescriptionCount = 2;
+    vertexInputStateCI.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributes.size());
     vertexInputStateCI.pVertexAttributeDescriptions = vertexInputAttributes.data();
 
     // Shaders
     std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = {};
 
     // Vertex shader
+    // Mesh formats have normals, which are read by their own shader, a specialization constant selects how they are decoded
+    const vk::Bool32 octahedralNormals = (vertexFormat.normalEncoding == vks::VertexFormat::NormalEncoding::eOctahedral) ? vk::True : vk::False;
+    const vk::SpecializationMapEntry specializationEntry(0, 0, sizeof(vk::Bool32));
+    const vk::SpecializationInfo specializationInfo(1, &specializationEntry, sizeof(vk::Bool32), &octahedralNormals);
+    const char* vertexShader = "shaders/glsl/triangle.vert.spv";
+    if (stressScene) {
+        vertexShader = "shaders/glsl/stress.vert.spv";
+    }
+    else if (vertexFormat.hasNormals()) {
+        vertexShader = "shaders/glsl/mesh.vert.spv";
+        shaderStages[0].pSpecializationInfo = &specializationInfo;
+    }
     shaderStages[0].stage = vk::ShaderStageFlagBits::eVertex;
-    shaderStages[0].module = loadSpirvShader("shaders/glsl/triangle.vert.spv");
+    shaderStages[0].module = loadSpirvShader(vertexShader);
     shaderStages[0].pName = "main";
     assert(shaderStages[0].module != nullptr);
 
@@ -557,17 +973,96 @@ void VulkanTriangle::createPipeline()
     device.destroyShaderModule(shaderStages[1].module);
 }
 
-uint32_t VulkanTriangle::getMemoryTypeIndex(uint32_t typeBits, vk::MemoryPropertyFlags properties)
+void VulkanTriangle::createCullingPipeline()
 {
-    // Iterate over all memory types available for the device used in this example
-    for (uint32_t i = 0; i < deviceMemoryProperties.memoryTypeCount; ++i) {
-        if ((typeBits & 1) == 1) {
-            if ((deviceMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
-                return i;
-        }
-        typeBits >>= 1;
+    PROFILE_FUNCTION();
+    // Binding 0: Dynamic uniform buffer with the matrices the frustum is extracted from
+    // Binding 1: Instance data (read)
+    // Binding 2: Indices of the visible instances (written)
+    // Binding 3: Indirect draw command, its instance count is atomically incremented
+    std::array<vk::DescriptorSetLayoutBinding, 4> layoutBindings{};
+    for (uint32_t i = 0; i < layoutBindings.size(); ++i) {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = (i == 0) ? vk::DescriptorType::eUniformBufferDynamic : vk::DescriptorType::eStorageBuffer;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo descriptorLayoutCI = {};
+    descriptorLayoutCI.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    descriptorLayoutCI.pBindings = layoutBindings.data();
+    VK_CHECK_RESULT(device.createDescriptorSetLayout(&descriptorLayoutCI, nullptr, &gpuCulling.descriptorSetLayout));
+
+    vk::DescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &gpuCulling.descriptorSetLayout;
+    VK_CHECK_RESULT(device.allocateDescriptorSets(&allocInfo, &gpuCulling.descriptorSet));
+
+    std::array<vk::DescriptorBufferInfo, 4> bufferInfos{};
+    bufferInfos[0] = { uniformRing.buffer, 0, sizeof(ShaderData) };
+    bufferInfos[1] = { stress.instanceBuffer.handle, 0, VK_WHOLE_SIZE };
+    bufferInfos[2] = { stress.instanceIndexBuffer.handle, 0, VK_WHOLE_SIZE };
+    bufferInfos[3] = { gpuCulling.drawCommandBuffer.handle, 0, VK_WHOLE_SIZE };
+    std::array<vk::WriteDescriptorSet, 4> writeDescriptorSets{};
+    for (uint32_t i = 0; i < writeDescriptorSets.size(); ++i) {
+        writeDescriptorSets[i].dstSet = gpuCulling.descriptorSet;
+        writeDescriptorSets[i].dstBinding = i;
+        writeDescriptorSets[i].descriptorCount = 1;
+        writeDescriptorSets[i].descriptorType = layoutBindings[i].descriptorType;
+        writeDescriptorSets[i].pBufferInfo = &bufferInfos[i];
     }
-    throw "Could not find a suitable memory type!";
+    device.updateDescriptorSets(static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+    // The instance count is passed as a push constant
+    vk::PushConstantRange pushConstantRange{ vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t) };
+    vk::PipelineLayoutCreateInfo pipelineLayoutCI = {};
+    pipelineLayoutCI.setLayoutCount = 1;
+    pipelineLayoutCI.pSetLayouts = &gpuCulling.descriptorSetLayout;
+    pipelineLayoutCI.pushConstantRangeCount = 1;
+    pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(device.createPipelineLayout(&pipelineLayoutCI, nullptr, &gpuCulling.pipelineLayout));
+
+    vk::ComputePipelineCreateInfo pipelineCI = {};
+    pipelineCI.layout = gpuCulling.pipelineLayout;
+    pipelineCI.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipelineCI.stage.module = loadSpirvShader("shaders/glsl/cull.comp.spv");
+    pipelineCI.stage.pName = "main";
+    assert(pipelineCI.stage.module != nullptr);
+    auto r = device.createComputePipeline(pipelineCache, pipelineCI);
+    VK_CHECK_RESULT(r.result);
+    gpuCulling.pipeline = r.value;
+
+    device.destroyShaderModule(pipelineCI.stage.module);
+}
+
+void VulkanTriangle::recordCulling(vk::CommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    // Reset the draw command to the whole mesh with zero instances, after the previous frame's indirect draw has consumed it
+    // All frames in flight share the draw command and instance index buffers, so successive frames are serialized by these barriers
+    vk::MemoryBarrier memoryBarrier{};
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect, vk::PipelineStageFlagBits::eTransfer, {}, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+    const vk::DrawIndexedIndirectCommand drawCommand{ indexCount, 0, 0, 0, 0 };
+    commandBuffer.updateBuffer(gpuCulling.drawCommandBuffer.handle, 0, sizeof(drawCommand), &drawCommand);
+
+    // The instance indices are overwritten only after the previous frame's vertex shader has read them
+    // The instance data upload is made visible by the upload manager's own barriers
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eVertexShader, vk::PipelineStageFlagBits::eComputeShader, {}, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    const uint32_t dynamicOffset = (uint32_t)uniformRing.getFrameOffset(frameIndex);
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, gpuCulling.pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, gpuCulling.pipelineLayout, 0, 1, &gpuCulling.descriptorSet, 1, &dynamicOffset);
+    commandBuffer.pushConstants(gpuCulling.pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t), &stress.instanceCount);
+    commandBuffer.dispatch((stress.instanceCount + 63) / 64, 1, 1);
+
+    // Make the draw command visible to the indirect draw and the instance indices to the vertex shader
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader, {}, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
 }
 
 vk::ShaderModule VulkanTriangle::loadSpirvShader(const std::string& filename)
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "base/vulkanexamplebase.h"
+#include "base/ObjLoader.h"
+#include "base/GltfLoader.h"
+#include "base/VertexFormat.h"
 
 class VulkanTriangle : public VulkanExampleBase
 {
@@ -12,26 +15,25 @@ public:
     };
 
     struct VulkanBuffer {
-        vk::DeviceMemory memory{ nullptr };
+        vks::Allocation memory{};
         vk::Buffer handle{ nullptr };
     };
 
-    // Uniform buffer block object
-    struct UniformBuffer : VulkanBuffer {
-        // The descriptor set stores the resources bound to the binding points in a shader
-        // It connects the binding points of the differenct shaders with the buffers and images used for those bindings
-        vk::DescriptorSet descriptorSet{ nullptr };
-        // We keep a pointer to the mapped buffer, so we can easily update its contents via a memcpy
-        uint8_t* mapped{ nullptr };
+    // Per-instance data of the stress scene, pulled from a storage buffer by the vertex shader (and read by the culling pass)
+    struct StressInstance {
+        // xyz = position, w = uniform scale
+        glm::vec4 positionScale;
+        // rgb = color tint, a = rotation around the y axis in radians
+        glm::vec4 colorRotation;
     };
 
     // For simplicity we use the same uniform block layout as in the shader
     // This way we can just memcpy the data to the ubo
     // Note: You should use data types that align with the GPU in order to avoid manual padding (vec4, mat)
     struct ShaderData {
+        glm::mat4 projectionMatrix;
         glm::mat4 modelMatrix;
         glm::mat4 viewMatrix;
-        glm::mat4 projectionMatrix;
     };
 
 public:
@@ -43,18 +45,26 @@ public:
     virtual void buildCommandBuffers() override;
 
     virtual void getEnabledFeatures() override;
+    virtual void getBenchmarkResults(vks::Benchmark& benchmark) override;
 
 private:
     void createVertexBuffer();
     void createUniformBuffers();
     void createDescriptors();
     void createPipeline();
-
-    // This function is used to request a device memory type that supports all the property flags we request (e.g. device local, host visible)
-    // Upon success it will return the index of the memory type that fits our requested memory properties
-    // This is necessary as implementations can offer an arbitrary number of memory types with different memory properties
-    // You can check https://vulkan.gpuinfo.org/ for details on different memory configurations
-    uint32_t getMemoryTypeIndex(uint32_t typeBits, vk::MemoryPropertyFlags properties);
+    void updateUniformBuffers();
+    void recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, uint32_t frameIndex, bool drawGeometry, bool useThreads);
+    void drawObjects(vk::CommandBuffer commandBuffer, uint32_t frameIndex, uint32_t firstObject, uint32_t count);
+    void createStressScene();
+    void loadMesh();
+    void loadObjMesh();
+    void loadGltfMesh();
+    // Writes a range of the mesh's vertices (in vertexFormat) or 32 bit indices to dst
+    using MeshWriter = std::function<void(void* dst, uint32_t first, uint32_t count)>;
+    void createMeshBuffers(uint32_t vertexCount, uint32_t meshIndexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+        const MeshWriter& writeVertices, const MeshWriter& writeIndices);
+    void createCullingPipeline();
+    void recordCulling(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
 
     // Vulkan loads its shaders from an immediate binary representation called SPIR-V
     // Shaders are compiled offline from e.g. GLSL using the reference glslang compiler
@@ -64,9 +74,69 @@ private:
     VulkanBuffer vertexBuffer;
     VulkanBuffer indexBuffer;
     uint32_t indexCount{ 0 };
+    // Upload of the vertex and index buffers, the triangle is only drawn once it has completed
+    vks::UploadManager::Ticket geometryUploadTicket{ 0 };
+
+    // Format of the vertex buffer, the pipeline's vertex input state is generated from it
+    // The triangle and the stress scene use Vertex (float position and color), a loaded mesh the format selected for it
+    vks::VertexFormat vertexFormat{ vks::VertexFormat::create(vks::VertexFormat::PositionEncoding::eFloat, vks::VertexFormat::NormalEncoding::eNone, vks::VertexFormat::ColorEncoding::eFloat) };
+
+    // Number of triangles drawn per frame, each with its own uniform data (can be set with --objects)
+    // In stress mode, this is the number of draws the instances are split into
+    uint32_t objectCount{ 1 };
+
+    // Mesh file drawn instead of the triangle (set with --mesh), every object draws it scaled to the triangle's size
+    struct {
+        std::string filename;
+        bool gltf{ false };
+        vks::ObjLoader::Statistics objStatistics{};
+        vks::GltfLoader::Statistics gltfStatistics{};
+        // Ranges of the mesh's primitives in the vertex and index buffer, drawn one after another (OBJ files have a single one)
+        std::vector<vks::GltfLoader::Primitive> primitives;
+        // Format the mesh's vertices are stored in (selected with --vertexformat), all mesh formats have normals
+        vks::VertexFormat vertexFormat{ vks::VertexFormat::create(vks::VertexFormat::PositionEncoding::eFloat, vks::VertexFormat::NormalEncoding::eFloat, vks::VertexFormat::ColorEncoding::eFloat) };
+        // Centers the mesh and scales it to [-1, 1], including the dequantization of quantized positions
+        glm::mat4 transform{ 1.0f };
+    } mesh;
+
+    // Procedural stress scene (enabled with --stress): a sphere mesh drawn instanced, with per-instance transforms from a storage buffer
+    struct {
+        uint32_t instanceCount{ 0 };
+        uint32_t trianglesPerMesh{ 256 };
+        uint32_t drawCount{ 1 };
+        VulkanBuffer instanceBuffer;
+        // Index of the instance drawn for every gl_InstanceIndex, the identity without GPU culling, written by the culling pass with it
+        VulkanBuffer instanceIndexBuffer;
+    } stress;
+
+    // GPU-driven drawing of the stress scene (enabled with --gpuculling): a compute pass frustum culls the instances, compacts the
+    // indices of the visible ones into the instance index buffer and counts them, all of them are then drawn with a single instanced drawIndexedIndirect
+    // Without it (or if not supported), the CPU-issued instanced draws are used
+    struct {
+        bool enabled{ false };
+        // A single VkDrawIndexedIndirectCommand, its instance count is the number of visible instances
+        VulkanBuffer drawCommandBuffer;
+        vk::DescriptorSetLayout descriptorSetLayout{ nullptr };
+        vk::DescriptorSet descriptorSet{ nullptr };
+        vk::PipelineLayout pipelineLayout{ nullptr };
+        vk::Pipeline pipeline{ nullptr };
+    } gpuCulling;
+
+    // All uniform data is written into a single buffer with one segment per frame in flight, so uniforms aren't updated while still in use
+    // Every object's data is bound through a dynamic offset into that buffer
+    vks::UniformRing uniformRing;
+
+    // Single descriptor set for the dynamic uniform buffer, shared by all frames and objects
+    vk::DescriptorSet descriptorSet{ nullptr };
+
+    // Command buffers recorded once per swapchain image and frame slot (if enabled with --prerecord), indexed by imageIndex * framesInFlight + frameIndex
+    std::vector<vk::CommandBuffer> prerecordedCommandBuffers;
+    bool prerecordedCommandBuffersValid{ false };
 
-    // We use on UBO per frame, so we can have a frame overlap and make sure that uniforms aren't updated while still in use
-    std::array<UniformBuffer, MAX_CONCURRENT_FRAMES> uniformBuffers;
+    // Time spent recording command buffers every frame and the average time it took to record a single prerecorded command buffer (in ms)
+    double recordingTime{ 0.0 };
+    uint32_t recordedFrames{ 0 };
+    double prerecordingTime{ 0.0 };
 
     // Descriptor set pool
     vk::DescriptorPool descriptorPool{ nullptr };